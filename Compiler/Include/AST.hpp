@@ -2,6 +2,9 @@
 
 #include "Compiler.hpp"
 #include "Globals.hpp"
+#include <optional>
+#include <set>
+#include <string_view>
 #include <utility>
 
 //===----------------------------------------------------------------------===//
@@ -11,14 +14,100 @@
 namespace Mare
 {
 
+/// AttributeArg - One argument of an attribute: `8`, `width=8` or `reassoc`.
+struct AttributeArg
+{
+  std::string        Key;   // Empty for positional arguments
+  std::optional<i64> Value; // Empty for bare identifiers
+};
+
+/// Attribute - An `@name` or `@name(args...)` annotation attached to a declaration.
+struct Attribute
+{
+  std::string               Name;
+  std::vector<AttributeArg> Args;
+};
+
+using AttributeList = std::vector<Attribute>;
+
+inline auto findAttribute(const AttributeList& Attrs, std::string_view Name) -> const Attribute*
+{
+  for (const auto& A : Attrs)
+    if (A.Name == Name)
+      return &A;
+  return nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// Side effects of a function body (see Effects.hpp)
+//===----------------------------------------------------------------------===//
+
+enum EffectBits : unsigned
+{
+  Effect_None         = 0,
+  Effect_ReadsMemory  = 1 << 0, // Reads memory that is not a local variable
+  Effect_WritesMemory = 1 << 1, // Writes memory that is not a local variable
+  Effect_MayUnwind    = 1 << 2,
+  Effect_MayNotReturn = 1 << 3, // Loops, recursion
+  Effect_MaySync      = 1 << 4,
+
+  // Anything we cannot see into (unannotated externs)
+  Effect_Unknown = Effect_ReadsMemory | Effect_WritesMemory | Effect_MayUnwind |
+                   Effect_MayNotReturn | Effect_MaySync
+};
+
+struct EffectSummary
+{
+  unsigned              Bits     = Effect_None; // Effects of the body itself
+  unsigned              Asserted = Effect_None; // Effects the user promised are absent
+  std::set<std::string> Callees;
+  bool                  IsExtern = false;
+  bool                  NoAlias  = false;
+
+  void add(unsigned B) { Bits |= B; }
+  void addCall(const std::string& Name) { Callees.insert(Name); }
+};
+
+struct CompilerInstance; // CompilerInstance.hpp
+class Prototype;         // Below
+
+/// Address - The storage an lvalue names, and the type stored there.
+/// An element of a `@layout(soa)` slice has no single address: Ptr is then the
+/// slice data and SoAIndex/SoALen locate the element's fields in it.
+struct Address
+{
+  llvm::Value* Ptr      = nullptr;
+  llvm::Type*  Ty       = nullptr;
+  llvm::Value* SoAIndex = nullptr;
+  llvm::Value* SoALen   = nullptr;
+
+  explicit operator bool() const { return Ptr != nullptr; }
+};
+
 /// Expr - Base class for all expression nodes.
 class Expr
 {
+protected:
+  bool Unsigned = false; // Integers in the value are unsigned (known after codegen)
 
 public:
   virtual ~Expr() = default;
 
-  virtual auto codegen() -> Value* = 0;
+  virtual auto codegen(CompilerInstance& CI) -> Value* = 0;
+
+  /// codegenAddress - Storage of an lvalue (variable, element, field); empty for rvalues.
+  virtual auto codegenAddress(CompilerInstance& /*CI*/) -> Address { return {}; }
+
+  /// isThroughPointer - Whether this lvalue may live outside the function's own
+  /// locals (known after codegen).
+  [[nodiscard]] virtual auto isThroughPointer() const -> bool { return false; }
+
+  /// collectEffects - Accumulate the side effects (and callees) of this node.
+  virtual void collectEffects(EffectSummary& S) const = 0;
+
+  /// isUnsigned - Whether the integers (or integer elements) of the value are
+  /// unsigned. Literals are not; mixed with an unsigned operand they act as one.
+  [[nodiscard]] auto isUnsigned() const -> bool { return Unsigned; }
 };
 
 class BlockExpr : public Expr
@@ -28,7 +117,25 @@ class BlockExpr : public Expr
 public:
   BlockExpr(std::vector<std::unique_ptr<Expr>> Exprs) : Expressions(std::move(Exprs)) {}
 
-  auto codegen() -> llvm::Value* override;
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// FPModeExpr - `@fastmath expr`, `@strictfp { ... }`: expr with the fast-math
+/// flags of its own floating point mode (see FastMath.hpp).
+class FPModeExpr : public Expr
+{
+  llvm::FastMathFlags   Flags;
+  std::unique_ptr<Expr> Body;
+
+public:
+  FPModeExpr(llvm::FastMathFlags Flags, std::unique_ptr<Expr> Body)
+      : Flags(Flags), Body(std::move(Body))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// NumberExpr - Expression class for numeric literals like "1.0".
@@ -41,7 +148,8 @@ private:
 public:
   NumberExpr(Global::ValueVariant Val, llvm::Type* Type) : Val(std::move(Val)), ValType(Type) {}
 
-  auto codegen() -> llvm::Value* override;
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 class StringExpr : public Expr
@@ -51,18 +159,23 @@ class StringExpr : public Expr
 public:
   StringExpr(std::string Val) : Val(std::move(Val)) {}
 
-  auto codegen() -> llvm::Value* override;
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// VariableExpr - Expression class for referencing a variable, like "a".
 class VariableExpr : public Expr
 {
   std::string Name;
-  Type*       VarType; // Store the type
+  Type*       VarType;          // Store the type
+  bool        IsGlobal = false; // Names a top-level `global` (known after codegen)
 public:
   VariableExpr(std::string Name, Type* type = nullptr) : Name(std::move(Name)), VarType(type) {}
 
-  auto               codegen() -> Value* override;
+  auto               codegen(CompilerInstance& CI) -> Value* override;
+  auto               codegenAddress(CompilerInstance& CI) -> Address override;
+  void               collectEffects(EffectSummary& S) const override;
+  [[nodiscard]] auto isThroughPointer() const -> bool override { return IsGlobal; }
   [[nodiscard]] auto getName() const -> const std::string& { return Name; }
   void               setType(Type* type) { VarType = type; }
   [[nodiscard]] auto getType() const -> Type* { return VarType; }
@@ -73,6 +186,7 @@ class UnaryExpr : public Expr
 {
   char                  Opcode;
   std::unique_ptr<Expr> Operand;
+  bool                  CallsOperator = false; // User `unary` function (known after codegen)
 
 public:
   UnaryExpr(char Opcode, std::unique_ptr<Expr> Operand)
@@ -80,22 +194,25 @@ public:
   {
   }
 
-  auto codegen() -> Value* override;
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// BinaryExpr - Expression class for a binary operator.
 class BinaryExpr : public Expr
 {
-  char                  Op;
+  Token__               Op; // An ASCII character or a two-character operator token
   std::unique_ptr<Expr> LHS, RHS;
+  bool                  CallsOperator = false; // User `binary` function (known after codegen)
 
 public:
-  BinaryExpr(char Op, std::unique_ptr<Expr> LHS, std::unique_ptr<Expr> RHS)
+  BinaryExpr(Token__ Op, std::unique_ptr<Expr> LHS, std::unique_ptr<Expr> RHS)
       : Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS))
   {
   }
 
-  auto codegen() -> Value* override;
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// CallExpr - Expression class for function calls.
@@ -104,13 +221,65 @@ class CallExpr : public Expr
   std::string                        Callee;
   std::vector<std::unique_ptr<Expr>> Args;
 
+  // Known after codegen: lowered inline, whether a memory builtin writes
+  // storage outside the function's locals, and what else the builtin does.
+  bool     IsBuiltin            = false;
+  bool     StoresThroughPointer = false;
+  unsigned BuiltinEffects       = Effect_None;
+
 public:
   CallExpr(std::string Callee, std::vector<std::unique_ptr<Expr>> Args)
       : Callee(std::move(Callee)), Args(std::move(Args))
   {
   }
 
-  auto codegen() -> Value* override;
+  auto               codegen(CompilerInstance& CI) -> Value* override;
+  void               collectEffects(EffectSummary& S) const override;
+  [[nodiscard]] auto getCallee() const -> const std::string& { return Callee; }
+  [[nodiscard]] auto getArgs() const -> const std::vector<std::unique_ptr<Expr>>& { return Args; }
+};
+
+/// SpawnExpr - `spawn f(args)` runs the call on a new thread and yields its
+/// handle, an i64 for `join`.
+class SpawnExpr : public Expr
+{
+  std::unique_ptr<CallExpr> Call;
+
+public:
+  SpawnExpr(std::unique_ptr<CallExpr> Call) : Call(std::move(Call)) {}
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// MatchPattern - An integer constant, or the half-open range Lo..Hi.
+struct MatchPattern
+{
+  std::unique_ptr<Expr> Lo, Hi; // Hi is null for a single value
+};
+
+/// MatchArm - `p, q, lo..hi => body`; the `_` arm has no patterns.
+struct MatchArm
+{
+  std::vector<MatchPattern> Patterns;
+  std::unique_ptr<Expr>     Body;
+};
+
+/// MatchExpr - `match x { 0 => a; 1, 2 => b; 3..10 => c; _ => d }`. Values no
+/// arm matches give the zero of the result type.
+class MatchExpr : public Expr
+{
+  std::unique_ptr<Expr> Scrutinee;
+  std::vector<MatchArm> Arms;
+
+public:
+  MatchExpr(std::unique_ptr<Expr> Scrutinee, std::vector<MatchArm> Arms)
+      : Scrutinee(std::move(Scrutinee)), Arms(std::move(Arms))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// IfExpr - Expression class for if/then/else.
@@ -124,7 +293,8 @@ public:
   {
   }
 
-  auto codegen() -> Value* override;
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// ForExpr - Expression class for for/in.
@@ -132,16 +302,136 @@ class ForExpr : public Expr
 {
   std::string           VarName;
   std::unique_ptr<Expr> Start, End, Step, Body;
+  AttributeList         Hints; // See LoopHints.hpp
 
 public:
   ForExpr(std::string VarName, std::unique_ptr<Expr> Start, std::unique_ptr<Expr> End,
-          std::unique_ptr<Expr> Step, std::unique_ptr<Expr> Body)
+          std::unique_ptr<Expr> Step, std::unique_ptr<Expr> Body, AttributeList Hints = {})
       : VarName(std::move(VarName)), Start(std::move(Start)), End(std::move(End)),
-        Step(std::move(Step)), Body(std::move(Body))
+        Step(std::move(Step)), Body(std::move(Body)), Hints(std::move(Hints))
   {
   }
 
-  auto codegen() -> Value* override;
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// RangeForExpr - `for i in start..end step s body`. The bounds and step are
+/// evaluated once, and the integer induction variable is tested before every
+/// iteration, so the loop runs exactly the counted number of times.
+class RangeForExpr : public Expr
+{
+  std::string           VarName;
+  std::unique_ptr<Expr> Start, End, Step, Body;
+  AttributeList         Hints;               // See LoopHints.hpp
+  bool                  ConstantStep = true; // Counted loops with a known step always finish
+
+public:
+  RangeForExpr(std::string VarName, std::unique_ptr<Expr> Start, std::unique_ptr<Expr> End,
+               std::unique_ptr<Expr> Step, std::unique_ptr<Expr> Body, AttributeList Hints = {})
+      : VarName(std::move(VarName)), Start(std::move(Start)), End(std::move(End)),
+        Step(std::move(Step)), Body(std::move(Body)), Hints(std::move(Hints))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// ParallelForExpr - `pfor i in start..end body`. The iterations run on the
+/// thread pool in any order, so they must not depend on each other. The body is
+/// outlined into a function that runs one chunk of the range (see Threads.hpp).
+class ParallelForExpr : public Expr
+{
+  std::string           VarName;
+  std::unique_ptr<Expr> Start, End, Body;
+  AttributeList         Hints; // See LoopHints.hpp; @parallel is implied
+
+  auto codegenChunk(CompilerInstance& CI, llvm::Function* Chunk,
+                    const std::vector<std::pair<std::string, Address>>& Captures,
+                    bool IsUnsigned) -> bool;
+
+public:
+  ParallelForExpr(std::string VarName, std::unique_ptr<Expr> Start, std::unique_ptr<Expr> End,
+                  std::unique_ptr<Expr> Body, AttributeList Hints = {})
+      : VarName(std::move(VarName)), Start(std::move(Start)), End(std::move(End)),
+        Body(std::move(Body)), Hints(std::move(Hints))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// ReduceExpr - `reduce(+, i = start..end, expr)` folds expr over the range
+/// with +, *, &, |, ^, min or max; an empty range gives the identity of the
+/// operation. The accumulator is a loop PHI, so the vectorizer can split it
+/// into vector accumulators. Integer folds and min/max may always be reordered.
+/// Floating point sums and products follow the floating point mode around them
+/// unless marked `ordered` or `reassoc`.
+class ReduceExpr : public Expr
+{
+  char                  Op; // '+', '*', '&', '|', '^', '<' (min) or '>' (max)
+  std::string           VarName;
+  std::unique_ptr<Expr> Start, End, Body;
+  AttributeList         Hints;   // See LoopHints.hpp
+  std::optional<bool>   Reassoc; // Unset: as the floating point mode
+
+public:
+  ReduceExpr(char Op, std::string VarName, std::unique_ptr<Expr> Start, std::unique_ptr<Expr> End,
+             std::unique_ptr<Expr> Body, AttributeList Hints, std::optional<bool> Reassoc)
+      : Op(Op), VarName(std::move(VarName)), Start(std::move(Start)), End(std::move(End)),
+        Body(std::move(Body)), Hints(std::move(Hints)), Reassoc(Reassoc)
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// WhileExpr - `while cond body`; the condition is tested before every iteration.
+class WhileExpr : public Expr
+{
+  std::unique_ptr<Expr> Cond, Body;
+  AttributeList         Hints; // See LoopHints.hpp
+
+public:
+  WhileExpr(std::unique_ptr<Expr> Cond, std::unique_ptr<Expr> Body, AttributeList Hints = {})
+      : Cond(std::move(Cond)), Body(std::move(Body)), Hints(std::move(Hints))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// BreakExpr - `break` leaves the innermost loop.
+class BreakExpr : public Expr
+{
+public:
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// ContinueExpr - `continue` starts the next iteration of the innermost loop.
+class ContinueExpr : public Expr
+{
+public:
+  auto codegen(CompilerInstance& CI) -> Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// YieldExpr - `yield x` hands x to the consumer of the enclosing `gen fn` and
+/// suspends it until the consumer asks for the next value.
+class YieldExpr : public Expr
+{
+  std::unique_ptr<Expr> Operand;
+
+public:
+  YieldExpr(std::unique_ptr<Expr> Operand) : Operand(std::move(Operand)) {}
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// VarExpr - Expression class for var keyword
@@ -156,7 +446,243 @@ public:
   {
   }
 
-  auto codegen() -> llvm::Value* override;
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// DestructureExpr - `var (a, b) = expr`: binds each element of a tuple (or
+/// field of a struct) to its own variable. A `_` name skips the element.
+class DestructureExpr : public Expr
+{
+  std::vector<std::string> VarNames;
+  std::unique_ptr<Expr>    Init;
+
+public:
+  DestructureExpr(std::vector<std::string> Names, std::unique_ptr<Expr> Init)
+      : VarNames(std::move(Names)), Init(std::move(Init))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// TupleExpr - `(a, b, ...)`: a first-class struct of its elements, returned in
+/// registers when a function's return type is a tuple.
+class TupleExpr : public Expr
+{
+  std::vector<std::unique_ptr<Expr>> Elements;
+
+public:
+  TupleExpr(std::vector<std::unique_ptr<Expr>> Elements) : Elements(std::move(Elements)) {}
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// ArrayExpr - Array literal: `[a, b, c]`, or `[x; N]` for N copies of x.
+class ArrayExpr : public Expr
+{
+  std::vector<std::unique_ptr<Expr>> Elements;
+  std::optional<i64>                 RepeatCount;
+
+public:
+  ArrayExpr(std::vector<std::unique_ptr<Expr>> Elements, std::optional<i64> RepeatCount)
+      : Elements(std::move(Elements)), RepeatCount(RepeatCount)
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// IndexExpr - Element of an array or slice: `xs[i]`. Indexing is unchecked.
+class IndexExpr : public Expr
+{
+  std::unique_ptr<Expr> Base, Index;
+  bool                  ThroughPointer = true; // Not in a local alloca (known after codegen)
+
+public:
+  IndexExpr(std::unique_ptr<Expr> Base, std::unique_ptr<Expr> Index)
+      : Base(std::move(Base)), Index(std::move(Index))
+  {
+  }
+
+  auto               codegen(CompilerInstance& CI) -> llvm::Value* override;
+  auto               codegenAddress(CompilerInstance& CI) -> Address override;
+  void               collectEffects(EffectSummary& S) const override;
+  [[nodiscard]] auto isThroughPointer() const -> bool override { return ThroughPointer; }
+};
+
+/// MemberExpr - A struct field `p.x`, or the length `xs.len` of an array or slice.
+class MemberExpr : public Expr
+{
+  std::unique_ptr<Expr> Base;
+  std::string           Member;
+
+public:
+  MemberExpr(std::unique_ptr<Expr> Base, std::string Member)
+      : Base(std::move(Base)), Member(std::move(Member))
+  {
+  }
+
+  auto               codegen(CompilerInstance& CI) -> llvm::Value* override;
+  auto               codegenAddress(CompilerInstance& CI) -> Address override;
+  void               collectEffects(EffectSummary& S) const override;
+  [[nodiscard]] auto isThroughPointer() const -> bool override { return Base->isThroughPointer(); }
+};
+
+/// NewSliceExpr - `new T[n]`, a zeroed heap slice of n elements.
+class NewSliceExpr : public Expr
+{
+  llvm::Type*           ElemType;
+  std::unique_ptr<Expr> Count;
+
+public:
+  NewSliceExpr(llvm::Type* ElemType, std::unique_ptr<Expr> Count, bool UnsignedElems = false)
+      : ElemType(ElemType), Count(std::move(Count))
+  {
+    Unsigned = UnsignedElems;
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// DeleteExpr - `delete xs`, releases the storage of a heap slice.
+class DeleteExpr : public Expr
+{
+  std::unique_ptr<Expr> Operand;
+
+public:
+  DeleteExpr(std::unique_ptr<Expr> Operand) : Operand(std::move(Operand)) {}
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// ForEachExpr - `for x in xs body`, visits every element of an array or slice,
+/// or every value a generator (`for x in g(...)`) yields.
+class ForEachExpr : public Expr
+{
+  std::string           VarName;
+  std::unique_ptr<Expr> Range, Body;
+  AttributeList         Hints;                 // See LoopHints.hpp
+  bool                  ThroughPointer = true; // See IndexExpr
+
+  auto codegenGenerator(CompilerInstance& CI, const Prototype& Gen) -> llvm::Value*;
+
+public:
+  ForEachExpr(std::string VarName, std::unique_ptr<Expr> Range, std::unique_ptr<Expr> Body,
+              AttributeList Hints = {})
+      : VarName(std::move(VarName)), Range(std::move(Range)), Body(std::move(Body)),
+        Hints(std::move(Hints))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// VectorExpr - `vec<f32, 8>(x)` splats x, `vec<i32, 4>(a, b, c, d)` sets each lane.
+class VectorExpr : public Expr
+{
+  llvm::Type*                        VecType;
+  std::vector<std::unique_ptr<Expr>> Lanes;
+
+public:
+  VectorExpr(llvm::Type* VecType, std::vector<std::unique_ptr<Expr>> Lanes,
+             bool UnsignedLanes = false)
+      : VecType(VecType), Lanes(std::move(Lanes))
+  {
+    Unsigned = UnsignedLanes;
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// CastExpr - `u32(x)`, `f64(n)`: converts x to a scalar (or vector) type.
+class CastExpr : public Expr
+{
+  llvm::Type*           DestType;
+  std::unique_ptr<Expr> Operand;
+
+public:
+  CastExpr(llvm::Type* DestType, std::unique_ptr<Expr> Operand, bool UnsignedDest)
+      : DestType(DestType), Operand(std::move(Operand))
+  {
+    Unsigned = UnsignedDest;
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// AsmOperand - `"r"(x)`: an input of an `asm` block. A constraint starting
+/// with '*' ("*m") passes the address of the lvalue x instead of its value.
+struct AsmOperand
+{
+  std::string           Constraint;
+  std::unique_ptr<Expr> Value;
+
+  [[nodiscard]] auto isIndirect() const -> bool { return Constraint.starts_with('*'); }
+};
+
+/// AsmExpr - `asm -> T { "template" : outputs : inputs : clobbers }`: LLVM
+/// inline assembly. Its value is the single output, or a tuple of the outputs.
+class AsmExpr : public Expr
+{
+  std::string              Template;
+  llvm::Type*              ResultType; // void without outputs
+  std::vector<std::string> Outputs;
+  std::vector<AsmOperand>  Inputs;
+  std::vector<std::string> Clobbers;
+  AttributeList            Attrs; // @volatile, @intel
+
+public:
+  AsmExpr(std::string Template, llvm::Type* ResultType, bool UnsignedResult,
+          std::vector<std::string> Outputs, std::vector<AsmOperand> Inputs,
+          std::vector<std::string> Clobbers, AttributeList Attrs)
+      : Template(std::move(Template)), ResultType(ResultType), Outputs(std::move(Outputs)),
+        Inputs(std::move(Inputs)), Clobbers(std::move(Clobbers)), Attrs(std::move(Attrs))
+  {
+    Unsigned = UnsignedResult;
+  }
+
+  /// hasSideEffects - Whether the block does more than compute its outputs from
+  /// its inputs; such a block is never moved, merged or deleted.
+  [[nodiscard]] auto hasSideEffects() const -> bool
+  {
+    if (Outputs.empty() || findAttribute(Attrs, "volatile"))
+      return true;
+    for (const auto& C : Clobbers)
+      if (C == "memory" || C == "~{memory}")
+        return true;
+    for (const auto& In : Inputs)
+      if (In.isIndirect())
+        return true;
+    return false;
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
+};
+
+/// StructExpr - `Point(x, y)` sets each field in order, `Point()` zeroes them.
+class StructExpr : public Expr
+{
+  llvm::StructType*                  Ty;
+  std::vector<std::unique_ptr<Expr>> Fields;
+
+public:
+  StructExpr(llvm::StructType* Ty, std::vector<std::unique_ptr<Expr>> Fields)
+      : Ty(Ty), Fields(std::move(Fields))
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 class ReturnExpr : public Expr
@@ -166,7 +692,8 @@ class ReturnExpr : public Expr
 public:
   ReturnExpr(std::unique_ptr<Expr> Exp) : Exp(std::move(Exp)) {}
 
-  auto codegen() -> llvm::Value* override;
+  auto codegen(CompilerInstance& CI) -> llvm::Value* override;
+  void collectEffects(EffectSummary& S) const override;
 };
 
 /// PrototypeAST - This class represents the "prototype" for a function,
@@ -180,6 +707,10 @@ class Prototype
   bool                     IsOperator;
   unsigned                 Precedence; // Precedence if a binary op.
   llvm::Type*              RetType;
+  AttributeList            Attrs;        // `@pure`, `@nounwind`, ... given before `fn`/`extern`
+  std::vector<bool>        UnsignedArgs; // Per argument: declared u8..u64 (or of them)
+  bool                     UnsignedRet = false;
+  bool                     Generator   = false; // `gen fn`: RetType is what it yields
 
 public:
   Prototype(std::string Name, std::vector<std::string> Args, std::vector<llvm::Type*> ArgTypes,
@@ -190,7 +721,7 @@ public:
     assert(Args.size() == ArgTypes.size() && "Argument names and types must match in count");
   }
 
-  auto               codegen() -> Function*;
+  auto               codegen(CompilerInstance& CI) -> Function*;
   [[nodiscard]] auto getName() const -> const std::string& { return Name; }
   [[nodiscard]] auto getArgs() const -> const std::vector<std::string>& { return Args; }
   [[nodiscard]] auto getArgTypes() const -> const std::vector<llvm::Type*>& { return ArgTypes; }
@@ -210,6 +741,41 @@ public:
   {
     return RetType;
   } // Getter for return type
+
+  void setUnsigned(std::vector<bool> ArgsUnsigned, bool RetUnsigned)
+  {
+    UnsignedArgs = std::move(ArgsUnsigned);
+    UnsignedRet  = RetUnsigned;
+  }
+
+  /// A generator returns a coroutine handle; the declared type is that of the
+  /// values it yields.
+  void               setGenerator() { Generator = true; }
+  [[nodiscard]] auto isGenerator() const -> bool { return Generator; }
+
+  void               setAttributes(AttributeList A) { Attrs = std::move(A); }
+  [[nodiscard]] auto getAttributes() const -> const AttributeList& { return Attrs; }
+  [[nodiscard]] auto hasAttribute(std::string_view AttrName) const -> bool
+  {
+    return findAttribute(Attrs, AttrName) != nullptr;
+  }
+};
+
+/// GlobalVarAST - A top-level `const name = expr` (read-only data) or
+/// `global name = expr` (mutable data). The initializer must be constant.
+class GlobalVarAST
+{
+  std::string           Name;
+  std::unique_ptr<Expr> Init;
+  bool                  IsConst;
+
+public:
+  GlobalVarAST(std::string Name, std::unique_ptr<Expr> Init, bool IsConst)
+      : Name(std::move(Name)), Init(std::move(Init)), IsConst(IsConst)
+  {
+  }
+
+  auto codegen(CompilerInstance& CI) -> llvm::GlobalVariable*;
 };
 
 /// FunctionAST - This class represents a function definition itself.
@@ -224,7 +790,7 @@ public:
   {
   }
 
-  auto               codegen() -> Function*;
+  auto               codegen(CompilerInstance& CI) -> Function*;
   [[nodiscard]] auto getName() const -> const std::string&
   {
     if (!Proto)
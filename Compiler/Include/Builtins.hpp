@@ -0,0 +1,1027 @@
+#pragma once
+
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "GenHelper.hpp"
+#include "PrimitiveTypes.hpp"
+#include "Threads.hpp"
+#include "Types.hpp"
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/MDBuilder.h>
+
+//===----------------------------------------------------------------------===//
+// Builtin Functions
+//
+// A call to one of these names is lowered straight to LLVM IR, unless the
+// program declares a function of the same name. Builtins only compute values,
+// so they add no effects (and no callee) to the function using them; the
+// exceptions are nt_store, which writes the storage its first argument names,
+// the atomics and join, which synchronize with other threads, and print.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Builtins
+{
+
+/// Unsigned is set if any argument holds unsigned integers (see Expr::isUnsigned).
+using Handler = llvm::Value* (*)(CompilerInstance& CI, std::vector<llvm::Value*>& Args,
+                                 bool Unsigned);
+
+/// AddressHandler - For builtins on memory: Target is the storage named by the
+/// first argument (a variable, element or field), Args the remaining arguments.
+using AddressHandler = llvm::Value* (*)(CompilerInstance& CI, const Address& Target,
+                                        std::vector<llvm::Value*>& Args, bool Unsigned);
+
+/// ArgsHandler - For builtins that treat every argument by its own type:
+/// Unsigned[i] tells whether Args[i] holds unsigned integers.
+using ArgsHandler = llvm::Value* (*)(CompilerInstance& CI, std::vector<llvm::Value*>& Args,
+                                     const std::vector<bool>& Unsigned);
+
+struct Builtin
+{
+  unsigned       MinArgs;
+  unsigned       MaxArgs;
+  Handler        Emit;
+  AddressHandler EmitAt       = nullptr; // Replaces Emit when set
+  bool           WritesTarget = false;
+  unsigned       Effects      = Effect_None; // Besides writing the target
+  ArgsHandler    EmitArgs     = nullptr;     // Replaces Emit when set
+};
+
+/// Atomics read and write memory other threads see, and order other accesses.
+constexpr unsigned AtomicEffects = Effect_ReadsMemory | Effect_WritesMemory | Effect_MaySync;
+
+inline auto ConstantInteger(llvm::Value* V) -> std::optional<i64>
+{
+  if (auto* C = llvm::dyn_cast<llvm::ConstantInt>(V))
+    return C->getSExtValue();
+  return std::nullopt;
+}
+
+//===----------------------------------------------------------------------===//
+// SIMD vectors
+//===----------------------------------------------------------------------===//
+
+/// splat(x, N) - vector of N copies of x
+inline auto EmitSplat(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  auto Lanes = ConstantInteger(Args[1]);
+  if (!Lanes || *Lanes <= 0)
+    return LogErrorV(CI, "splat: the lane count must be a positive constant");
+  if (!isScalarType(Args[0]->getType()))
+    return LogErrorV(CI, "splat: expects an integer or floating point value");
+
+  return CI.Builder->CreateVectorSplat(*Lanes, Args[0], "splat");
+}
+
+/// extract(v, i) - lane i of v
+inline auto EmitExtract(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  if (!Args[0]->getType()->isVectorTy())
+    return LogErrorV(CI, "extract: expects a vector");
+  if (!Args[1]->getType()->isIntegerTy())
+    return LogErrorV(CI, "extract: the lane must be an integer");
+
+  return CI.Builder->CreateExtractElement(Args[0], Args[1], "lane");
+}
+
+/// insert(v, x, i) - v with lane i replaced by x
+inline auto EmitInsert(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  auto* VT = llvm::dyn_cast<llvm::VectorType>(Args[0]->getType());
+  if (!VT)
+    return LogErrorV(CI, "insert: expects a vector");
+  if (!Args[2]->getType()->isIntegerTy())
+    return LogErrorV(CI, "insert: the lane must be an integer");
+
+  llvm::Value* X = promoteValue(CI, Args[1], Args[1]->getType(), VT->getElementType(), Unsigned);
+  if (!X)
+    return nullptr;
+
+  return CI.Builder->CreateInsertElement(Args[0], X, Args[2], "insert");
+}
+
+/// shuffle(a, mask), shuffle(a, b, mask) - mask is a constant list of lane numbers;
+/// with two vectors, the lanes of b are numbered after the lanes of a.
+inline auto EmitShuffle(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  auto* VT = llvm::dyn_cast<llvm::FixedVectorType>(Args[0]->getType());
+  if (!VT)
+    return LogErrorV(CI, "shuffle: expects a vector");
+
+  llvm::Value* B = Args.size() == 3 ? Args[1] : llvm::PoisonValue::get(VT);
+  if (B->getType() != VT)
+    return LogErrorV(CI, "shuffle: both vectors must have the same type");
+
+  auto*       Mask   = llvm::dyn_cast<llvm::Constant>(Args.back());
+  llvm::Type* MaskTy = Args.back()->getType();
+  if (!Mask || !(MaskTy->isArrayTy() || MaskTy->isVectorTy()))
+    return LogErrorV(CI, "shuffle: the mask must be a constant list like [0, 2, 4, 6]");
+
+  const unsigned MaskLen = MaskTy->isArrayTy()
+                             ? MaskTy->getArrayNumElements()
+                             : llvm::cast<llvm::FixedVectorType>(MaskTy)->getNumElements();
+  const i64      Limit   = VT->getNumElements() * (Args.size() == 3 ? 2 : 1);
+
+  llvm::SmallVector<int, 16> Indices;
+  for (unsigned i = 0; i != MaskLen; ++i)
+  {
+    auto Lane = ConstantInteger(Mask->getAggregateElement(i));
+    if (!Lane || *Lane < 0 || *Lane >= Limit)
+      return LogErrorV(CI, "shuffle: mask lanes must be constants within the input vectors");
+    Indices.push_back(static_cast<int>(*Lane));
+  }
+
+  return CI.Builder->CreateShuffleVector(Args[0], B, Indices, "shuffle");
+}
+
+/// reduce_add/mul/min/max/and/or/xor(v) - horizontal reduction of all lanes.
+/// Floating point sums and products may be reassociated into a tree.
+inline auto EmitReduce(CompilerInstance& CI, llvm::Value* V, char Op, bool Unsigned)
+  -> llvm::Value*
+{
+  auto* VT = llvm::dyn_cast<llvm::VectorType>(V->getType());
+  if (!VT)
+    return LogErrorV(CI, "reduce: expects a vector");
+
+  llvm::Type* Elem = VT->getElementType();
+  const bool  FP   = Elem->isFloatingPointTy();
+
+  llvm::Value* R = nullptr;
+  switch (Op)
+  {
+    case '+':
+      R = FP ? CI.Builder->CreateFAddReduce(llvm::ConstantFP::getNegativeZero(Elem), V)
+             : CI.Builder->CreateAddReduce(V);
+      break;
+    case '*':
+      R = FP ? CI.Builder->CreateFMulReduce(llvm::ConstantFP::get(Elem, 1.0), V)
+             : CI.Builder->CreateMulReduce(V);
+      break;
+    case '<':
+      R = FP ? CI.Builder->CreateFPMinReduce(V) : CI.Builder->CreateIntMinReduce(V, !Unsigned);
+      break;
+    case '>':
+      R = FP ? CI.Builder->CreateFPMaxReduce(V) : CI.Builder->CreateIntMaxReduce(V, !Unsigned);
+      break;
+    case '&':
+    case '|':
+    case '^':
+      if (FP)
+        return LogErrorV(CI, "reduce: bitwise reductions need an integer vector");
+      R = Op == '&'   ? CI.Builder->CreateAndReduce(V)
+          : Op == '|' ? CI.Builder->CreateOrReduce(V)
+                      : CI.Builder->CreateXorReduce(V);
+      break;
+  }
+
+  if (FP && (Op == '+' || Op == '*'))
+    llvm::cast<llvm::Instruction>(R)->setHasAllowReassoc(true);
+  return R;
+}
+
+template <char Op>
+inline auto EmitReduceOp(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  return EmitReduce(CI, Args[0], Op, Unsigned);
+}
+
+/// select(mask, a, b) - lane-wise `mask ? a : b`; scalars are broadcast.
+inline auto EmitSelect(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Value* Mask = Args[0];
+  llvm::Value* A    = Args[1];
+  llvm::Value* B    = Args[2];
+
+  // A non-boolean mask selects where it is non-zero.
+  llvm::Type* MaskElem = Mask->getType()->getScalarType();
+  if (!MaskElem->isIntegerTy())
+    return LogErrorV(CI, "select: the mask must be a comparison or an integer vector");
+  if (!MaskElem->isIntegerTy(1))
+    Mask = CI.Builder->CreateICmpNE(Mask, llvm::Constant::getNullValue(Mask->getType()), "mask");
+
+  if (auto* VT = llvm::dyn_cast<llvm::VectorType>(Mask->getType()))
+  {
+    llvm::Type* LaneTy = A->getType()->isVectorTy() ? A->getType() : B->getType();
+    if (!LaneTy->isVectorTy())
+      LaneTy = llvm::VectorType::get(getCommonType(A->getType(), B->getType()), VT);
+    A = splatToVector(CI, A, LaneTy, Unsigned);
+    B = splatToVector(CI, B, LaneTy, Unsigned);
+  }
+  else if (A->getType() != B->getType())
+  {
+    llvm::Type* Common = getCommonType(A->getType(), B->getType());
+    A                  = promoteValue(CI, A, A->getType(), Common, Unsigned);
+    B                  = promoteValue(CI, B, B->getType(), Common, Unsigned);
+  }
+
+  if (!A || !B)
+    return nullptr;
+  if (A->getType() != B->getType())
+    return LogErrorV(CI, "select: both choices must have the same type");
+
+  return CI.Builder->CreateSelect(Mask, A, B, "select");
+}
+
+//===----------------------------------------------------------------------===//
+// Bit manipulation and arithmetic
+//
+// Each of these is one LLVM intrinsic and works lane-wise on vectors.
+//===----------------------------------------------------------------------===//
+
+/// UnifyOperands - Convert Args to one type: the vector one of them is, or else
+/// the widest of their scalar types. Returns that type, null on error.
+inline auto UnifyOperands(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Type*
+{
+  llvm::Type* T = nullptr;
+  for (llvm::Value* A : Args)
+    if (A->getType()->isVectorTy())
+      T = A->getType();
+  if (!T)
+  {
+    T = Args.front()->getType();
+    for (llvm::Value* A : Args)
+      T = getCommonType(T, A->getType());
+  }
+
+  for (llvm::Value*& A : Args)
+    if (!(A = convertValue(CI, A, Unsigned, T, Unsigned)))
+      return nullptr;
+  return T;
+}
+
+/// Call the intrinsic ID overloaded on the type of the first argument.
+inline auto EmitIntrinsic(CompilerInstance& CI, llvm::Intrinsic::ID ID,
+                          llvm::ArrayRef<llvm::Value*> Args, const char* Name) -> llvm::Value*
+{
+  return CI.Builder->CreateIntrinsic(ID, {Args.front()->getType()}, Args, nullptr, Name);
+}
+
+/// popcount(x), clz(x), ctz(x) - set bits, leading zeros, trailing zeros. clz
+/// and ctz of 0 are the bit width.
+template <llvm::Intrinsic::ID ID>
+inline auto EmitBitCount(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Value* X = Args[0];
+  if (!X->getType()->isIntOrIntVectorTy())
+    return LogErrorV(CI, "popcount/clz/ctz: expects an integer");
+
+  if (ID == llvm::Intrinsic::ctpop)
+    return EmitIntrinsic(CI, ID, {X}, "popcount");
+  return EmitIntrinsic(CI, ID, {X, CI.Builder->getFalse()}, "bitcount"); // 0 is defined
+}
+
+/// bswap(x) - x with its bytes in reverse order.
+inline auto EmitByteSwap(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Type* Elem = Args[0]->getType()->getScalarType();
+  if (!Elem->isIntegerTy() || Elem->getIntegerBitWidth() % 16 != 0)
+    return LogErrorV(CI, "bswap: expects an integer of 16, 32 or 64 bits");
+
+  return EmitIntrinsic(CI, llvm::Intrinsic::bswap, {Args[0]}, "bswap");
+}
+
+/// rotl(x, n) / rotr(x, n) - x rotated left / right by n bits (modulo its width).
+template <llvm::Intrinsic::ID ID>
+inline auto EmitRotate(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Value* X = Args[0];
+  if (!X->getType()->isIntOrIntVectorTy() || !Args[1]->getType()->isIntOrIntVectorTy())
+    return LogErrorV(CI, "rotl/rotr: expects integers");
+
+  // The amount is a bit count, never negative.
+  llvm::Value* N = convertValue(CI, Args[1], /*FromUnsigned=*/true, X->getType(), true);
+  if (!N)
+    return nullptr;
+  return EmitIntrinsic(CI, ID, {X, X, N}, "rot"); // A funnel shift of x with itself
+}
+
+/// fma(a, b, c) - a * b + c, rounded once.
+inline auto EmitFma(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* T = UnifyOperands(CI, Args, Unsigned);
+  if (!T)
+    return nullptr;
+  if (!T->isFPOrFPVectorTy())
+    return LogErrorV(CI, "fma: expects floating point operands");
+
+  return EmitIntrinsic(CI, llvm::Intrinsic::fma, Args, "fma");
+}
+
+/// min(a, b) / max(a, b) - the smaller / larger operand. Floating point
+/// operands follow IEEE minNum/maxNum: a NaN loses against a number.
+template <bool IsMax>
+inline auto EmitMinMax(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* T = UnifyOperands(CI, Args, Unsigned);
+  if (!T)
+    return nullptr;
+
+  llvm::Intrinsic::ID ID;
+  if (T->isFPOrFPVectorTy())
+    ID = IsMax ? llvm::Intrinsic::maxnum : llvm::Intrinsic::minnum;
+  else if (T->isIntOrIntVectorTy())
+    ID = IsMax ? (Unsigned ? llvm::Intrinsic::umax : llvm::Intrinsic::smax)
+               : (Unsigned ? llvm::Intrinsic::umin : llvm::Intrinsic::smin);
+  else
+    return LogErrorV(CI, "min/max: expects numbers");
+
+  return EmitIntrinsic(CI, ID, Args, IsMax ? "max" : "min");
+}
+
+/// abs(x) - the magnitude of x. The most negative integer stays as it is.
+inline auto EmitAbs(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Value* X = Args[0];
+  if (X->getType()->isFPOrFPVectorTy())
+    return EmitIntrinsic(CI, llvm::Intrinsic::fabs, {X}, "abs");
+  if (!X->getType()->isIntOrIntVectorTy())
+    return LogErrorV(CI, "abs: expects a number");
+  if (Unsigned)
+    return X;
+
+  return EmitIntrinsic(CI, llvm::Intrinsic::abs, {X, CI.Builder->getFalse()}, "abs");
+}
+
+/// copysign(a, b) - the magnitude of a with the sign of b.
+inline auto EmitCopySign(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* T = UnifyOperands(CI, Args, Unsigned);
+  if (!T)
+    return nullptr;
+  if (!T->isFPOrFPVectorTy())
+    return LogErrorV(CI, "copysign: expects floating point operands");
+
+  return EmitIntrinsic(CI, llvm::Intrinsic::copysign, Args, "copysign");
+}
+
+//===----------------------------------------------------------------------===//
+// Checked and saturating arithmetic
+//===----------------------------------------------------------------------===//
+
+/// EmitTrappingArith - L Op R for integers ('+', '-' or '*'), trapping if the
+/// result overflows. The check is the overflow flag of the operation and one
+/// branch that is predicted not taken. Used by checked_* and --trap-overflow.
+inline auto EmitTrappingArith(CompilerInstance& CI, char Op, llvm::Value* L, llvm::Value* R,
+                              bool Unsigned) -> llvm::Value*
+{
+  namespace In = llvm::Intrinsic;
+  const In::ID Opcode =
+    Op == '+'   ? (Unsigned ? In::uadd_with_overflow : In::sadd_with_overflow)
+    : Op == '-' ? (Unsigned ? In::usub_with_overflow : In::ssub_with_overflow)
+                : (Unsigned ? In::umul_with_overflow : In::smul_with_overflow);
+
+  llvm::Value* Pair     = EmitIntrinsic(CI, Opcode, {L, R}, "checked");
+  llvm::Value* Result   = CI.Builder->CreateExtractValue(Pair, 0, "result");
+  llvm::Value* Overflow = CI.Builder->CreateExtractValue(Pair, 1, "overflow");
+  if (Overflow->getType()->isVectorTy())
+    Overflow = CI.Builder->CreateOrReduce(Overflow);
+
+  llvm::Function*   F      = CI.Builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock* TrapBB = llvm::BasicBlock::Create(*CI.TheContext, "overflow.trap", F);
+  llvm::BasicBlock* ContBB = llvm::BasicBlock::Create(*CI.TheContext, "overflow.cont", F);
+
+  llvm::MDBuilder MDB(*CI.TheContext);
+  CI.Builder->CreateCondBr(Overflow, TrapBB, ContBB, MDB.createBranchWeights(1, 1 << 20));
+
+  CI.Builder->SetInsertPoint(TrapBB);
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+  CI.Builder->CreateUnreachable();
+
+  CI.Builder->SetInsertPoint(ContBB);
+  return Result;
+}
+
+/// checked_add(a, b), checked_sub(a, b), checked_mul(a, b) - integer
+/// arithmetic that traps on overflow.
+template <char Op>
+inline auto EmitChecked(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* T = UnifyOperands(CI, Args, Unsigned);
+  if (!T)
+    return nullptr;
+  if (!T->isIntOrIntVectorTy())
+    return LogErrorV(CI, "checked_add/sub/mul: expects integers");
+
+  return EmitTrappingArith(CI, Op, Args[0], Args[1], Unsigned);
+}
+
+/// sat_add(a, b), sat_sub(a, b), sat_mul(a, b) - integer arithmetic that
+/// clamps to the range of the type instead of wrapping.
+template <char Op>
+inline auto EmitSaturating(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* T = UnifyOperands(CI, Args, Unsigned);
+  if (!T)
+    return nullptr;
+  if (!T->isIntOrIntVectorTy())
+    return LogErrorV(CI, "sat_add/sub/mul: expects integers");
+
+  if (Op == '+')
+    return EmitIntrinsic(CI, Unsigned ? llvm::Intrinsic::uadd_sat : llvm::Intrinsic::sadd_sat,
+                         Args, "sat");
+  if (Op == '-')
+    return EmitIntrinsic(CI, Unsigned ? llvm::Intrinsic::usub_sat : llvm::Intrinsic::ssub_sat,
+                         Args, "sat");
+
+  // A fixed point multiply with no fraction bits is a plain saturating multiply.
+  return EmitIntrinsic(CI,
+                       Unsigned ? llvm::Intrinsic::umul_fix_sat : llvm::Intrinsic::smul_fix_sat,
+                       {Args[0], Args[1], CI.Builder->getInt32(0)}, "sat");
+}
+
+//===----------------------------------------------------------------------===//
+// Optimizer hints
+//===----------------------------------------------------------------------===//
+
+/// likely(c) / unlikely(c) - c as an i1, expected to be true / false. The
+/// expectation becomes branch weights on the branches c feeds.
+template <bool Expected>
+inline auto EmitExpect(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Value* Cond = CreateCondition(CI, Args[0], "cond");
+  if (!Cond)
+    return LogErrorV(CI, "likely/unlikely: expects a scalar condition");
+
+  return CI.Builder->CreateIntrinsic(llvm::Intrinsic::expect, {Cond->getType()},
+                                     {Cond, CI.Builder->getInt1(Expected)}, nullptr, "expect");
+}
+
+/// assume(c) - let the optimizer rely on c being true; if it is not, the
+/// behavior is undefined. Yields true.
+inline auto EmitAssume(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Value* Cond = CreateCondition(CI, Args[0], "cond");
+  if (!Cond)
+    return LogErrorV(CI, "assume: expects a scalar condition");
+
+  CI.Builder->CreateAssumption(Cond);
+  return CI.Builder->getTrue();
+}
+
+//===----------------------------------------------------------------------===//
+// Memory hints
+//===----------------------------------------------------------------------===//
+
+/// SingleAddress - Target as one pointer; an element of a `@layout(soa)` slice
+/// is spread over its field arrays and has none.
+inline auto SingleAddress(CompilerInstance& CI, const Address& Target, const char* Builtin)
+  -> llvm::Value*
+{
+  if (!Target.SoAIndex)
+    return Target.Ptr;
+
+  const std::string errMsg = std::string(Builtin) +
+                             ": an element of a '@layout(soa)' slice has no single address; "
+                             "name one of its fields";
+  return LogErrorV(CI, errMsg.c_str());
+}
+
+/// prefetch(x, rw = 0, locality = 3) - hint that x will soon be read (rw = 0) or
+/// written (rw = 1); locality runs from 0 (no reuse) to 3 (keep in all caches).
+inline auto EmitPrefetch(CompilerInstance& CI, const Address& Target,
+                         std::vector<llvm::Value*>& Args, bool /*Unsigned*/) -> llvm::Value*
+{
+  llvm::Value* Ptr = SingleAddress(CI, Target, "prefetch");
+  if (!Ptr)
+    return nullptr;
+
+  auto RW       = Args.size() > 0 ? ConstantInteger(Args[0]) : 0;
+  auto Locality = Args.size() > 1 ? ConstantInteger(Args[1]) : 3;
+  if (!RW || *RW < 0 || *RW > 1)
+    return LogErrorV(CI, "prefetch: rw must be the constant 0 (read) or 1 (write)");
+  if (!Locality || *Locality < 0 || *Locality > 3)
+    return LogErrorV(CI, "prefetch: locality must be a constant from 0 to 3");
+
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::prefetch, {Ptr->getType()},
+                              {Ptr, CI.Builder->getInt32(*RW), CI.Builder->getInt32(*Locality),
+                               CI.Builder->getInt32(1)}); // Data, not instruction, cache
+  return CI.Builder->getTrue();
+}
+
+/// NonTemporal - Mark I as not worth keeping in the cache.
+inline void NonTemporal(CompilerInstance& CI, llvm::Instruction* I)
+{
+  llvm::MDNode* One = llvm::MDNode::get(
+    *CI.TheContext, {llvm::ConstantAsMetadata::get(CI.Builder->getInt32(1))});
+  I->setMetadata(llvm::LLVMContext::MD_nontemporal, One);
+}
+
+/// nt_load(x) - x, read without pulling its cache line in.
+inline auto EmitNonTemporalLoad(CompilerInstance& CI, const Address& Target,
+                                std::vector<llvm::Value*>& /*Args*/, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  llvm::Value* Ptr = SingleAddress(CI, Target, "nt_load");
+  if (!Ptr)
+    return nullptr;
+
+  llvm::LoadInst* Load = CI.Builder->CreateLoad(Target.Ty, Ptr, "ntload");
+  NonTemporal(CI, Load);
+  return Load;
+}
+
+/// nt_store(x, v) - x = v, written around the cache. Yields v.
+inline auto EmitNonTemporalStore(CompilerInstance& CI, const Address& Target,
+                                 std::vector<llvm::Value*>& Args, bool Unsigned) -> llvm::Value*
+{
+  llvm::Value* Ptr = SingleAddress(CI, Target, "nt_store");
+  if (!Ptr)
+    return nullptr;
+
+  llvm::Value* Val = Args[0];
+  if (Val->getType() != Target.Ty)
+    Val = convertValue(CI, Val, Unsigned, Target.Ty, Unsigned);
+  if (!Val)
+    return nullptr;
+
+  NonTemporal(CI, CI.Builder->CreateStore(Val, Ptr));
+  return Val;
+}
+
+/// assume_aligned(xs, N) - let the optimizer rely on the data of the array or
+/// slice xs starting at an N-byte boundary. Yields true.
+inline auto EmitAssumeAligned(CompilerInstance& CI, const Address& Target,
+                              std::vector<llvm::Value*>& Args, bool /*Unsigned*/) -> llvm::Value*
+{
+  auto Align = ConstantInteger(Args[0]);
+  if (!Align || *Align <= 0 || (*Align & (*Align - 1)) != 0)
+    return LogErrorV(CI, "assume_aligned: the alignment must be a constant power of two");
+
+  llvm::Value* Data = nullptr;
+  if (Target.Ty->isArrayTy())
+    Data = Target.Ptr;
+  else if (Types::SliceElementType(CI, Target.Ty))
+    Data = CI.Builder->CreateLoad(
+      MARE_PTR_TYPE, CI.Builder->CreateStructGEP(Target.Ty, Target.Ptr, 0), "data");
+  else
+    return LogErrorV(CI, "assume_aligned: expects an array or a slice");
+
+  CI.Builder->CreateAlignmentAssumption(CI.TheModule->getDataLayout(), Data, *Align);
+  return CI.Builder->getTrue();
+}
+
+//===----------------------------------------------------------------------===//
+// Atomics
+//
+// atomic_* access an integer variable, element or field as one indivisible
+// operation. The optional last argument names the memory ordering: "relaxed",
+// "acquire", "release", "acq_rel" or "seq_cst" (the default).
+//===----------------------------------------------------------------------===//
+
+/// MemoryOrder - The ordering named by Args[Index], seq_cst when it is absent.
+/// Orderings the operation does not allow are reported as errors.
+inline auto MemoryOrder(CompilerInstance& CI, const std::vector<llvm::Value*>& Args,
+                        size_t Index, const char* Builtin, bool CanAcquire = true,
+                        bool CanRelease = true) -> std::optional<llvm::AtomicOrdering>
+{
+  using llvm::AtomicOrdering;
+  if (Index >= Args.size())
+    return AtomicOrdering::SequentiallyConsistent;
+
+  llvm::StringRef Name;
+  llvm::getConstantStringInfo(Args[Index], Name);
+
+  std::optional<AtomicOrdering> Order;
+  if (Name == "relaxed")
+    Order = AtomicOrdering::Monotonic;
+  else if (Name == "acquire" && CanAcquire)
+    Order = AtomicOrdering::Acquire;
+  else if (Name == "release" && CanRelease)
+    Order = AtomicOrdering::Release;
+  else if (Name == "acq_rel" && CanAcquire && CanRelease)
+    Order = AtomicOrdering::AcquireRelease;
+  else if (Name == "seq_cst")
+    Order = AtomicOrdering::SequentiallyConsistent;
+
+  if (!Order)
+  {
+    const std::string errMsg =
+      std::string(Builtin) + ": the memory order must be \"relaxed\"" +
+      (CanAcquire ? ", \"acquire\"" : "") + (CanRelease ? ", \"release\"" : "") +
+      (CanAcquire && CanRelease ? ", \"acq_rel\"" : "") + " or \"seq_cst\"";
+    LogErrorV(CI, errMsg.c_str());
+  }
+  return Order;
+}
+
+/// AtomicAddress - Target as the address of an integer of a power of two bytes;
+/// atomics on other widths (a bool, say) are not lowered by every target.
+inline auto AtomicAddress(CompilerInstance& CI, const Address& Target, const char* Builtin)
+  -> llvm::Value*
+{
+  llvm::Value* Ptr = SingleAddress(CI, Target, Builtin);
+  if (!Ptr)
+    return nullptr;
+  if (!Target.Ty->isIntegerTy())
+    return LogErrorV(CI, (std::string(Builtin) + ": expects an integer").c_str());
+
+  const unsigned Bits = Target.Ty->getIntegerBitWidth();
+  if (Bits < 8 || !llvm::isPowerOf2_32(Bits))
+    return LogErrorV(
+      CI, (std::string(Builtin) + ": expects an integer of 8, 16, 32 or 64 bits").c_str());
+  return Ptr;
+}
+
+/// NaturalAlign - Atomics need their operand aligned to its size.
+inline auto NaturalAlign(CompilerInstance& CI, llvm::Type* Ty) -> llvm::Align
+{
+  return llvm::Align(CI.TheModule->getDataLayout().getTypeStoreSize(Ty));
+}
+
+/// atomic_load(x, order) - x, read atomically.
+inline auto EmitAtomicLoad(CompilerInstance& CI, const Address& Target,
+                           std::vector<llvm::Value*>& Args, bool /*Unsigned*/) -> llvm::Value*
+{
+  llvm::Value* Ptr   = AtomicAddress(CI, Target, "atomic_load");
+  auto         Order = MemoryOrder(CI, Args, 0, "atomic_load", true, /*CanRelease=*/false);
+  if (!Ptr || !Order)
+    return nullptr;
+
+  llvm::LoadInst* Load = CI.Builder->CreateAlignedLoad(
+    Target.Ty, Ptr, NaturalAlign(CI, Target.Ty), "atomic.load");
+  Load->setAtomic(*Order);
+  return Load;
+}
+
+/// atomic_store(x, v, order) - x = v, written atomically. Yields v.
+inline auto EmitAtomicStore(CompilerInstance& CI, const Address& Target,
+                            std::vector<llvm::Value*>& Args, bool Unsigned) -> llvm::Value*
+{
+  llvm::Value* Ptr   = AtomicAddress(CI, Target, "atomic_store");
+  auto         Order = MemoryOrder(CI, Args, 1, "atomic_store", /*CanAcquire=*/false);
+  if (!Ptr || !Order)
+    return nullptr;
+
+  llvm::Value* Val = convertValue(CI, Args[0], Unsigned, Target.Ty, Unsigned);
+  if (!Val)
+    return nullptr;
+
+  CI.Builder->CreateAlignedStore(Val, Ptr, NaturalAlign(CI, Target.Ty))->setAtomic(*Order);
+  return Val;
+}
+
+/// atomic_add/sub/and/or/xor/min/max/xchg(x, v, order) - update x with v in
+/// one step (xchg replaces it). Yields the value x had before.
+template <llvm::AtomicRMWInst::BinOp Op>
+inline auto EmitAtomicRMW(CompilerInstance& CI, const Address& Target,
+                          std::vector<llvm::Value*>& Args, bool Unsigned) -> llvm::Value*
+{
+  llvm::Value* Ptr   = AtomicAddress(CI, Target, "atomic_add/sub/and/or/xor/min/max/xchg");
+  auto         Order = MemoryOrder(CI, Args, 1, "atomic_add/sub/and/or/xor/min/max/xchg");
+  if (!Ptr || !Order)
+    return nullptr;
+
+  llvm::Value* Val = convertValue(CI, Args[0], Unsigned, Target.Ty, Unsigned);
+  if (!Val)
+    return nullptr;
+
+  llvm::AtomicRMWInst::BinOp BinOp = Op;
+  if (Unsigned && Op == llvm::AtomicRMWInst::Min)
+    BinOp = llvm::AtomicRMWInst::UMin;
+  else if (Unsigned && Op == llvm::AtomicRMWInst::Max)
+    BinOp = llvm::AtomicRMWInst::UMax;
+
+  return CI.Builder->CreateAtomicRMW(BinOp, Ptr, Val, NaturalAlign(CI, Target.Ty), *Order);
+}
+
+/// atomic_cas(x, expected, desired, order) - x = desired if x == expected, in
+/// one step. Yields the value x had before; equal to expected on success.
+inline auto EmitAtomicCompareExchange(CompilerInstance& CI, const Address& Target,
+                                      std::vector<llvm::Value*>& Args, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Value* Ptr   = AtomicAddress(CI, Target, "atomic_cas");
+  auto         Order = MemoryOrder(CI, Args, 2, "atomic_cas");
+  if (!Ptr || !Order)
+    return nullptr;
+
+  llvm::Value* Expected = convertValue(CI, Args[0], Unsigned, Target.Ty, Unsigned);
+  llvm::Value* Desired  = convertValue(CI, Args[1], Unsigned, Target.Ty, Unsigned);
+  if (!Expected || !Desired)
+    return nullptr;
+
+  // A failed exchange only reads x, so it orders as much as a load can.
+  llvm::AtomicCmpXchgInst* CAS = CI.Builder->CreateAtomicCmpXchg(
+    Ptr, Expected, Desired, NaturalAlign(CI, Target.Ty), *Order,
+    llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(*Order));
+  return CI.Builder->CreateExtractValue(CAS, 0, "cas.old");
+}
+
+/// fence(order) - orders the memory accesses around it; relaxed is no order.
+inline auto EmitFence(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  auto Order = MemoryOrder(CI, Args, 0, "fence");
+  if (!Order)
+    return nullptr;
+
+  if (*Order != llvm::AtomicOrdering::Monotonic)
+    CI.Builder->CreateFence(*Order);
+  return CI.Builder->getTrue();
+}
+
+//===----------------------------------------------------------------------===//
+// Threads (see Threads.hpp)
+//===----------------------------------------------------------------------===//
+
+/// join(t) - wait for the thread t and yield its result.
+inline auto EmitJoin(CompilerInstance& CI, std::vector<llvm::Value*>& Args, bool /*Unsigned*/)
+  -> llvm::Value*
+{
+  if (!Args[0]->getType()->isIntegerTy(64))
+    return LogErrorV(CI, "join: expects the handle 'spawn' returned");
+
+  return CI.Builder->CreateCall(Threads::GetJoinFunction(CI), {Args[0]}, "joined");
+}
+
+/// cpu_count() - hardware threads of the machine, at least 1.
+inline auto EmitCpuCount(CompilerInstance& CI, std::vector<llvm::Value*>& /*Args*/,
+                         bool /*Unsigned*/) -> llvm::Value*
+{
+  return CI.Builder->CreateCall(Threads::GetCpuCountFunction(CI), {}, "cpus");
+}
+
+//===----------------------------------------------------------------------===//
+// Formatted printing
+//===----------------------------------------------------------------------===//
+
+/// PrintStep - Text, or a placeholder: `{}`, `{x}` (hex) or `{.N}` (N digits
+/// after the point). See MarePrintStep in Runtime/Runtime.h.
+struct PrintStep
+{
+  bool        Placeholder = false;
+  int         Kind        = __MARE_PRINT_TEXT__; // Of a placeholder, known once its value is
+  int         Arg         = -1;                  // Length of the text, or digits of a double
+  char        Spec        = 0;                   // 0, 'x' or '.'
+  std::string Text;
+};
+
+/// ParseFormat - Split Fmt into its steps; `{{` and `}}` stand for braces.
+inline auto ParseFormat(CompilerInstance& CI, llvm::StringRef Fmt)
+  -> std::optional<std::vector<PrintStep>>
+{
+  std::vector<PrintStep> Steps;
+  PrintStep              Text;
+  auto                   EndText = [&]
+  {
+    if (Text.Text.empty())
+      return;
+    Text.Arg = Text.Text.size();
+    Steps.push_back(std::move(Text));
+    Text = {};
+  };
+
+  for (size_t i = 0; i != Fmt.size(); ++i)
+  {
+    const char C = Fmt[i];
+    if ((C == '{' || C == '}') && i + 1 != Fmt.size() && Fmt[i + 1] == C)
+    {
+      Text.Text += C;
+      ++i;
+      continue;
+    }
+    if (C == '}')
+      return LogErrorV(CI, "print: unmatched '}' in the format; write '}}' for a brace"),
+             std::nullopt;
+    if (C != '{')
+    {
+      Text.Text += C;
+      continue;
+    }
+
+    const size_t Close = Fmt.find('}', i);
+    if (Close == llvm::StringRef::npos)
+      return LogErrorV(CI, "print: unterminated '{' in the format; write '{{' for a brace"),
+             std::nullopt;
+
+    PrintStep Value;
+    Value.Placeholder = true;
+    llvm::StringRef Spec = Fmt.slice(i + 1, Close);
+    unsigned        Digits;
+    if (Spec == "x")
+      Value.Spec = 'x';
+    else if (Spec.consume_front(".") && !Spec.getAsInteger(10, Digits) &&
+             Digits <= __MARE_PRINT_PRECISION__)
+    {
+      Value.Spec = '.';
+      Value.Arg  = Digits;
+    }
+    else if (!Spec.empty())
+    {
+      const std::string errMsg = "print: unknown placeholder '" + Fmt.slice(i, Close + 1).str() +
+                                 "'; use {}, {x} or {.N} with N up to " +
+                                 std::to_string(__MARE_PRINT_PRECISION__);
+      return LogErrorV(CI, errMsg.c_str()), std::nullopt;
+    }
+
+    EndText();
+    Steps.push_back(std::move(Value));
+    i = Close;
+  }
+  EndText();
+  return Steps;
+}
+
+/// PrintSlot - V widened to the 64 bits the runtime reads; sets the kind of S.
+inline auto PrintSlot(CompilerInstance& CI, PrintStep& S, llvm::Value* V, bool Unsigned)
+  -> llvm::Value*
+{
+  llvm::Type* Ty = V->getType();
+  if (Ty->isIntegerTy(1) && !S.Spec)
+  {
+    S.Kind = __MARE_PRINT_BOOL__;
+    return CI.Builder->CreateZExt(V, MARE_INT64_TYPE);
+  }
+  if (Ty->isIntegerTy() && S.Spec != '.')
+  {
+    S.Kind = S.Spec == 'x' ? __MARE_PRINT_HEX__
+             : Unsigned    ? __MARE_PRINT_U64__
+                           : __MARE_PRINT_I64__;
+    return (Unsigned || S.Spec == 'x') ? CI.Builder->CreateZExt(V, MARE_INT64_TYPE)
+                                       : CI.Builder->CreateSExt(V, MARE_INT64_TYPE);
+  }
+  if (Ty->isFloatingPointTy() && S.Spec != 'x')
+  {
+    // A float keeps its own shortest spelling; other widths print as doubles.
+    if (Ty->isFloatTy())
+    {
+      S.Kind = __MARE_PRINT_F32__;
+      return CI.Builder->CreateZExt(CI.Builder->CreateBitCast(V, MARE_INT32_TYPE), MARE_INT64_TYPE);
+    }
+    S.Kind = __MARE_PRINT_F64__;
+    return CI.Builder->CreateBitCast(CI.Builder->CreateFPCast(V, MARE_DOUBLE_TYPE),
+                                     MARE_INT64_TYPE);
+  }
+  if (Ty->isPointerTy() && !S.Spec)
+  {
+    S.Kind = __MARE_PRINT_STR__;
+    return CI.Builder->CreatePtrToInt(V, MARE_INT64_TYPE);
+  }
+
+  return LogErrorV(CI, "print: {} takes an integer, a floating point value, a bool or a string; "
+                       "{x} an integer and {.N} a floating point value");
+}
+
+/// __mare_print(plan, steps, args) - write the text of a plan to stderr.
+inline auto GetPrintFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  auto* FT = llvm::FunctionType::get(MARE_VOID_TYPE,
+                                     {MARE_PTR_TYPE, MARE_INT64_TYPE, MARE_PTR_TYPE}, false);
+  auto* F  = llvm::cast<llvm::Function>(
+    CI.TheModule->getOrInsertFunction(__MARE_PRINT_FN__, FT).getCallee());
+
+  F->setDoesNotThrow();
+  return F;
+}
+
+/// print("b = {} c = {}\n", b, c) - write the text to stderr in one runtime call.
+/// The format is split here into a constant plan; each value travels as 64 bits
+/// and its step says how to spell it, so the runtime parses nothing.
+inline auto EmitPrint(CompilerInstance& CI, std::vector<llvm::Value*>& Args,
+                      const std::vector<bool>& Unsigned) -> llvm::Value*
+{
+  llvm::StringRef Fmt;
+  if (!llvm::getConstantStringInfo(Args[0], Fmt))
+    return LogErrorV(CI, "print: the format must be a string literal");
+
+  auto Steps = ParseFormat(CI, Fmt);
+  if (!Steps)
+    return nullptr;
+
+  const size_t NumValues = std::count_if(Steps->begin(), Steps->end(),
+                                         [](const PrintStep& S) { return S.Placeholder; });
+  if (NumValues != Args.size() - 1)
+  {
+    const std::string errMsg = "print: the format has " + std::to_string(NumValues) +
+                               " placeholders for " + std::to_string(Args.size() - 1) + " values";
+    return LogErrorV(CI, errMsg.c_str());
+  }
+
+  // The values are spilled to a frame slot the runtime reads in plan order.
+  llvm::Value* Values = llvm::ConstantPointerNull::get(MARE_PTR_TYPE);
+  if (NumValues)
+  {
+    llvm::Function*   F = CI.Builder->GetInsertBlock()->getParent();
+    llvm::IRBuilder<> Entry(&F->getEntryBlock(), F->getEntryBlock().begin());
+    Values = Entry.CreateAlloca(MARE_ARRAY_TYPE(MARE_INT64_TYPE, NumValues), nullptr, "print.args");
+  }
+
+  llvm::StructType* StepTy =
+    llvm::StructType::get(*CI.TheContext, {MARE_INT32_TYPE, MARE_INT32_TYPE, MARE_PTR_TYPE});
+  std::vector<llvm::Constant*> Plan;
+  unsigned                     Next = 1;
+  for (PrintStep& S : *Steps)
+  {
+    llvm::Constant* Text = llvm::ConstantPointerNull::get(MARE_PTR_TYPE);
+    if (!S.Placeholder)
+      Text = CI.Builder->CreateGlobalStringPtr(S.Text, ".print.text");
+    else
+    {
+      llvm::Value* Slot = PrintSlot(CI, S, Args[Next], Unsigned[Next]);
+      if (!Slot)
+        return nullptr;
+      CI.Builder->CreateStore(
+        Slot, CI.Builder->CreateConstInBoundsGEP1_64(MARE_INT64_TYPE, Values, Next - 1));
+      ++Next;
+    }
+    Plan.push_back(llvm::ConstantStruct::get(
+      StepTy, {CI.Builder->getInt32(S.Kind), CI.Builder->getInt32(S.Arg), Text}));
+  }
+
+  auto* PlanTy = llvm::ArrayType::get(StepTy, Plan.size());
+  auto* PlanGV = new llvm::GlobalVariable(*CI.TheModule, PlanTy, true,
+                                          llvm::GlobalValue::PrivateLinkage,
+                                          llvm::ConstantArray::get(PlanTy, Plan), ".print.plan");
+  PlanGV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+  return CI.Builder->CreateCall(GetPrintFunction(CI),
+                                {PlanGV, CI.Builder->getInt64(Plan.size()), Values});
+}
+
+//===----------------------------------------------------------------------===//
+// Lookup
+//===----------------------------------------------------------------------===//
+
+inline auto Table() -> const std::map<std::string, Builtin>&
+{
+  static const std::map<std::string, Builtin> Builtins = {
+    {"splat", {2, 2, EmitSplat}},
+    {"extract", {2, 2, EmitExtract}},
+    {"insert", {3, 3, EmitInsert}},
+    {"shuffle", {2, 3, EmitShuffle}},
+    {"select", {3, 3, EmitSelect}},
+    {"reduce_add", {1, 1, EmitReduceOp<'+'>}},
+    {"reduce_mul", {1, 1, EmitReduceOp<'*'>}},
+    {"reduce_min", {1, 1, EmitReduceOp<'<'>}},
+    {"reduce_max", {1, 1, EmitReduceOp<'>'>}},
+    {"reduce_and", {1, 1, EmitReduceOp<'&'>}},
+    {"reduce_or", {1, 1, EmitReduceOp<'|'>}},
+    {"reduce_xor", {1, 1, EmitReduceOp<'^'>}},
+    {"popcount", {1, 1, EmitBitCount<llvm::Intrinsic::ctpop>}},
+    {"clz", {1, 1, EmitBitCount<llvm::Intrinsic::ctlz>}},
+    {"ctz", {1, 1, EmitBitCount<llvm::Intrinsic::cttz>}},
+    {"bswap", {1, 1, EmitByteSwap}},
+    {"rotl", {2, 2, EmitRotate<llvm::Intrinsic::fshl>}},
+    {"rotr", {2, 2, EmitRotate<llvm::Intrinsic::fshr>}},
+    {"fma", {3, 3, EmitFma}},
+    {"min", {2, 2, EmitMinMax<false>}},
+    {"max", {2, 2, EmitMinMax<true>}},
+    {"abs", {1, 1, EmitAbs}},
+    {"copysign", {2, 2, EmitCopySign}},
+    {"checked_add", {2, 2, EmitChecked<'+'>}},
+    {"checked_sub", {2, 2, EmitChecked<'-'>}},
+    {"checked_mul", {2, 2, EmitChecked<'*'>}},
+    {"sat_add", {2, 2, EmitSaturating<'+'>}},
+    {"sat_sub", {2, 2, EmitSaturating<'-'>}},
+    {"sat_mul", {2, 2, EmitSaturating<'*'>}},
+    {"likely", {1, 1, EmitExpect<true>}},
+    {"unlikely", {1, 1, EmitExpect<false>}},
+    {"assume", {1, 1, EmitAssume}},
+    {"prefetch", {1, 3, nullptr, EmitPrefetch}},
+    {"nt_load", {1, 1, nullptr, EmitNonTemporalLoad}},
+    {"nt_store", {2, 2, nullptr, EmitNonTemporalStore, /*WritesTarget=*/true}},
+    {"assume_aligned", {2, 2, nullptr, EmitAssumeAligned}},
+    {"atomic_load", {1, 2, nullptr, EmitAtomicLoad, false, AtomicEffects}},
+    {"atomic_store", {2, 3, nullptr, EmitAtomicStore, true, AtomicEffects}},
+    {"atomic_add", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Add>, true, AtomicEffects}},
+    {"atomic_sub", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Sub>, true, AtomicEffects}},
+    {"atomic_and", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::And>, true, AtomicEffects}},
+    {"atomic_or", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Or>, true, AtomicEffects}},
+    {"atomic_xor", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Xor>, true, AtomicEffects}},
+    {"atomic_min", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Min>, true, AtomicEffects}},
+    {"atomic_max", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Max>, true, AtomicEffects}},
+    {"atomic_xchg", {2, 3, nullptr, EmitAtomicRMW<llvm::AtomicRMWInst::Xchg>, true, AtomicEffects}},
+    {"atomic_cas", {3, 4, nullptr, EmitAtomicCompareExchange, true, AtomicEffects}},
+    {"fence", {0, 1, EmitFence, nullptr, false, AtomicEffects}},
+    {"join", {1, 1, EmitJoin, nullptr, false, Effect_Unknown}},
+    {"cpu_count", {0, 0, EmitCpuCount}},
+    {"print", {1, ~0u, nullptr, nullptr, false, Effect_Unknown, EmitPrint}},
+  };
+  return Builtins;
+}
+
+inline auto Find(const std::string& Name) -> const Builtin*
+{
+  auto It = Table().find(Name);
+  return It != Table().end() ? &It->second : nullptr;
+}
+
+} // namespace Mare::Builtins
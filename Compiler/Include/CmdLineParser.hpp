@@ -3,7 +3,7 @@
 #include "Colors.h"
 #include "Compiler.hpp"
 #include "Config.hpp"
-#include "Utils.hpp"
+#include "Globals.hpp"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -32,7 +32,10 @@ struct ArgParser
   StdFilePath__ inputPath       = std::filesystem::current_path();
   FilePath__    linkerPath      = "/usr/bin/clang++";
   FilePath__    outputFile      = "a.out";
+  FilePath__    objectFile      = __MARE_OBJECT_FILE_NAME__;
   bool          showCPUFeatures = false;
+  bool          trapOverflow    = false;
+  std::string   fpModel         = "fast"; // Floating point mode, see FastMath.hpp
   std::ifstream inputFileStream;
 
   void printUsage()
@@ -42,8 +45,11 @@ struct ArgParser
     const std::vector<Entry> options = {
       {"-o <file>", "Set output binary filename (default: a.out)"},
       {"--output=<file>", "Same as -o"},
+      {"--object=<file>", "Object file to emit (default: " __MARE_OBJECT_FILE_NAME__ ")"},
       {"--linker=<path>", "Path to linker (default: /usr/bin/clang++)"},
       {"--show-cpu-features", "Show the current target's CPU features (LLVM API)"},
+      {"--trap-overflow", "Trap when integer +, - or * overflows"},
+      {"--fp-model=<mode>", "Floating point outside @fastmath/@strictfp: fast, precise or strict"},
       {"-h, --help", "Show this help message"}};
 
     // Header
@@ -113,10 +119,28 @@ struct ArgParser
       {
         outputFile = arg.substr(9);
       }
+      else if (arg.starts_with("--object="))
+      {
+        objectFile = arg.substr(9);
+      }
       else if (arg.starts_with("--show-cpu-features"))
       {
         showCPUFeatures = true;
       }
+      else if (arg == "--trap-overflow")
+      {
+        trapOverflow = true;
+      }
+      else if (arg.starts_with("--fp-model="))
+      {
+        fpModel = arg.substr(11);
+        if (fpModel != "fast" && fpModel != "precise" && fpModel != "strict")
+        {
+          printError("unknown floating point model: '" + fpModel + "'");
+          printHint("Use --fp-model=fast, --fp-model=precise or --fp-model=strict.");
+          return false;
+        }
+      }
       else if (!arg.starts_with("-") && inputFile.empty())
       {
         inputFile = arg; // Tentatively accept as source file
@@ -154,5 +178,3 @@ struct ArgParser
     return true;
   }
 };
-
-static ArgParser mareArgs;
@@ -63,26 +63,68 @@
 #define __MARE_UNARY_FUNC_DECL__  "_mare_std_unary"
 #define __MARE_BINARY_FUNC_DECL__ "_mare_std_binary"
 
+//===----------------------------------------------------------------------===//
+// Memoization runtime (@memo) - must match MARE_MEMO_* in Runtime/Runtime.h
+//===----------------------------------------------------------------------===//
+
+#define __MARE_MEMO_MAX_TABLES__  64
+#define __MARE_MEMO_MAX_ARITY__   8
+#define __MARE_MEMO_LOOKUP_FN__   "__mare_memo_lookup"
+#define __MARE_MEMO_STORE_FN__    "__mare_memo_store"
+#define __MARE_MEMO_IMPL_SUFFIX__ ".memo.impl"
+
+//===----------------------------------------------------------------------===//
+// Arrays and slices - must match MARE_ALLOC_* in Runtime/Runtime.h
+//===----------------------------------------------------------------------===//
+
+#define __MARE_ALLOC_FN__          "__mare_alloc"
+#define __MARE_FREE_FN__           "__mare_free"
+#define __MARE_ALLOC_ALIGN__       64
+#define __MARE_SLICE_TYPE_PREFIX__ "mare.slice."
+
+//===----------------------------------------------------------------------===//
+// Generator frames (`gen fn`) - see __mare_coro_alloc in Runtime/Runtime.h
+//===----------------------------------------------------------------------===//
+
+#define __MARE_CORO_ALLOC_FN__ "__mare_coro_alloc"
+#define __MARE_CORO_FREE_FN__  "__mare_coro_free"
+
+//===----------------------------------------------------------------------===//
+// Threads (`spawn`, `join`, `pfor`) - see __mare_spawn in Runtime/Runtime.h
+//===----------------------------------------------------------------------===//
+
+#define __MARE_SPAWN_FN__     "__mare_spawn"
+#define __MARE_JOIN_FN__      "__mare_join"
+#define __MARE_CPU_COUNT_FN__ "__mare_cpu_count"
+#define __MARE_SPAWN_SUFFIX__ ".spawn"
+#define __MARE_PFOR_FN__      "__mare_parallel_for"
+#define __MARE_PFOR_SUFFIX__  ".pfor"
+
+//===----------------------------------------------------------------------===//
+// Formatted printing (`print`) - must match MARE_PRINT_* in Runtime/Runtime.h
+//===----------------------------------------------------------------------===//
+
+#define __MARE_PRINT_FN__        "__mare_print"
+#define __MARE_PRINT_TEXT__      0
+#define __MARE_PRINT_I64__       1
+#define __MARE_PRINT_U64__       2
+#define __MARE_PRINT_HEX__       3
+#define __MARE_PRINT_F64__       4
+#define __MARE_PRINT_STR__       5
+#define __MARE_PRINT_BOOL__      6
+#define __MARE_PRINT_F32__       7
+#define __MARE_PRINT_PRECISION__ 100 // Most digits `{.N}` may ask for
+
 using namespace llvm;
 using namespace llvm::sys;
 
 //===----------------------------------------------------------------------===//
 // Code Generation
+//
+// All per-compilation state (LLVM context, module, builder, symbol tables)
+// lives in Mare::CompilerInstance (CompilerInstance.hpp).
 //===----------------------------------------------------------------------===//
 
-static std::unique_ptr<LLVMContext>                  TheContext;
-static std::unique_ptr<Module>                       TheModule;
-static std::unique_ptr<IRBuilder<>>                  Builder;
-static std::map<std::string, AllocaInst*>            NamedValues;
-static std::unique_ptr<FunctionPassManager>          TheFPM;
-static std::unique_ptr<LoopAnalysisManager>          TheLAM;
-static std::unique_ptr<FunctionAnalysisManager>      TheFAM;
-static std::unique_ptr<CGSCCAnalysisManager>         TheCGAM;
-static std::unique_ptr<ModuleAnalysisManager>        TheMAM;
-static std::unique_ptr<PassInstrumentationCallbacks> ThePIC;
-static std::unique_ptr<StandardInstrumentations>     TheSI;
-static ExitOnError                                   ExitOnErr;
-
 //===----------------------------------------------------------------------===//
 // Lexer
 //===----------------------------------------------------------------------===//
@@ -125,5 +167,62 @@ enum Token
   tok_int16  = -20,
   tok_int32  = -21,
   tok_int64  = -22,
-  tok_arrow  = -23
+  tok_arrow  = -23,
+
+  // annotations
+  tok_attribute = -25,
+
+  // slices
+  tok_new    = -26,
+  tok_delete = -27,
+
+  // SIMD vectors
+  tok_vec = -28,
+
+  // records
+  tok_struct = -29,
+
+  // unsigned integers
+  tok_uint8  = -30,
+  tok_uint16 = -31,
+  tok_uint32 = -32,
+  tok_uint64 = -33,
+
+  // two-character operators
+  tok_shl = -34, // <<
+  tok_shr = -35, // >>
+  tok_le  = -39, // <=
+  tok_ge  = -40, // >=
+  tok_eq  = -41, // ==
+  tok_ne  = -42, // !=
+  tok_and = -43, // &&
+  tok_or  = -44, // ||
+
+  // comparison results
+  tok_bool = -45,
+
+  // loops
+  tok_while    = -36,
+  tok_break    = -37,
+  tok_continue = -38,
+  tok_dotdot   = -46, // ..
+
+  // multi-way dispatch
+  tok_match    = -47,
+  tok_fatarrow = -48, // =>
+
+  // module-level data
+  tok_const  = -49,
+  tok_global = -50,
+
+  // generators
+  tok_gen   = -51,
+  tok_yield = -52,
+
+  // threads
+  tok_spawn = -53,
+  tok_pfor  = -54,
+
+  // inline assembly
+  tok_asm = -55
 };
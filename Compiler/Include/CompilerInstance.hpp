@@ -0,0 +1,101 @@
+#pragma once
+
+#include "AST.hpp"
+#include "CmdLineParser.hpp"
+#include "Compiler.hpp"
+#include "Globals.hpp"
+
+namespace Mare
+{
+
+/// StructInfo - A declared `struct`. With `@layout(soa)` the elements of a slice
+/// are stored one field array after another, largest fields first; SoAOffsets[i]
+/// is the number of bytes per element stored before the array of field i.
+struct StructInfo
+{
+  llvm::StructType*        Ty = nullptr;
+  std::vector<std::string> Fields;
+  std::vector<bool>        UnsignedFields;
+  bool                     SoA = false;
+  std::vector<unsigned>    SoAOffsets;
+  unsigned                 SoAStride = 0; // Bytes per element over all field arrays
+};
+
+/// LoopTargets - Where `break` and `continue` jump to in the innermost loop.
+struct LoopTargets
+{
+  llvm::BasicBlock* Break;               // The loop's exit block; null in a `pfor`
+  llvm::BasicBlock* Continue;            // The loop's single latch
+  llvm::Value*      Generator = nullptr; // The generator a for-each drives; `ret` destroys it
+};
+
+/// GeneratorFrame - The `gen fn` being generated: where `yield` leaves its value
+/// and the blocks every suspend point branches to (see Coroutines.hpp).
+struct GeneratorFrame
+{
+  llvm::Value*      Id;       // The llvm.coro.id token
+  llvm::Value*      Handle;   // The llvm.coro.begin result
+  llvm::AllocaInst* Promise;  // Holds the value last yielded
+  bool              Unsigned; // The yielded integers are unsigned
+  llvm::BasicBlock* Final;    // Reached from `ret` and the end of the body
+  llvm::BasicBlock* Cleanup;  // Frees the frame when the generator is destroyed
+  llvm::BasicBlock* Suspend;  // Returns to the caller, leaving the generator suspended
+};
+
+//===----------------------------------------------------------------------===//
+// CompilerInstance - Everything a single compilation owns.
+//
+// The lexer cursor, parser tables, LLVM context/module/builder and codegen
+// symbol tables all live here and are passed explicitly through the lexer,
+// parser and codegen. Instances share no state, so independent programs can
+// be compiled concurrently, one instance per thread.
+//===----------------------------------------------------------------------===//
+
+struct CompilerInstance
+{
+  //===--- Driver ---===//
+  ArgParser Args;
+  bool      FoundMain = false;
+
+  //===--- Lexer ---===//
+  Global::FileCoords   fileCoords;
+  Token__              CurTok   = 0;   // Token the parser is looking at
+  Token__              LastChar = ' '; // Lookahead character of the lexer
+  std::string          IdentifierStr;  // Filled in if tok_identifier
+  Token__              NumTok = 0;
+  Global::ValueVariant NumVal;
+  std::string          StringVal;
+
+  //===--- Parser ---===//
+  std::map<Token__, int> BinopPrecedence; // Precedence for each declared binary operator
+
+  //===--- Codegen ---===//
+  // Declaration order matters: the module and builder must die before their context.
+  std::unique_ptr<LLVMContext>                      TheContext;
+  std::unique_ptr<Module>                           TheModule;
+  std::unique_ptr<IRBuilder<>>                      Builder;
+  std::map<std::string, AllocaInst*>                NamedValues;
+  std::map<std::string, Address>                    SharedLocals; // Outer locals in a `pfor` chunk
+  std::map<std::string, llvm::GlobalVariable*>      GlobalValues; // Top-level const/global
+  std::map<std::string, std::unique_ptr<Prototype>> FunctionProtos;
+  std::map<std::string, EffectSummary>              FunctionEffects;
+  std::vector<std::string>                          MemoFunctions;
+  std::map<llvm::Type*, llvm::Type*>                SliceElementTypes; // Slice struct -> element
+  std::map<std::string, StructInfo>                 Structs;           // Declared structs by name
+  std::set<const llvm::Value*>                      UnsignedValues;    // Unsigned allocas/args/fns
+  std::vector<LoopTargets>                          Loops;             // Innermost loop last
+  std::optional<GeneratorFrame>                     Generator;         // Set inside a `gen fn`
+  bool                                              InParallelBody = false; // In a `pfor` body
+
+  CompilerInstance()
+      : TheContext(std::make_unique<LLVMContext>()),
+        TheModule(std::make_unique<Module>("Mare", *TheContext)),
+        Builder(std::make_unique<IRBuilder<>>(*TheContext))
+  {
+  }
+
+  CompilerInstance(const CompilerInstance&)                    = delete;
+  auto operator=(const CompilerInstance&) -> CompilerInstance& = delete;
+};
+
+} // namespace Mare
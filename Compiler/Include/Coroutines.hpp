@@ -0,0 +1,201 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "PrimitiveTypes.hpp"
+
+//===----------------------------------------------------------------------===//
+// Generators (`gen fn`)
+//
+// A generator is a switched-resume LLVM coroutine. Calling it only creates the
+// frame and returns its handle; every resume runs the body up to the next
+// `yield`, which leaves the value in the promise:
+//
+//   gen fn squares(i64 n) -> i64 { for i in 0..n yield i * i; }
+//   for x in squares(i64(10)) __mare_printi64(x);
+//
+// The consumer loop resumes the handle, stops once llvm.coro.done reports the
+// final suspend point, and destroys the frame when it leaves the loop (through
+// `break` too). Frames come from __mare_coro_alloc, but only when CoroElide
+// cannot place them in the consumer's frame: once the generator is inlined into
+// a loop that always destroys it, the whole pipeline runs in registers.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Coro
+{
+
+/// PromiseAlign - Alignment of the promise. The consumer hands the same value to
+/// llvm.coro.promise to find the promise in the frame.
+inline auto PromiseAlign(const CompilerInstance& CI, llvm::Type* YieldTy) -> llvm::Align
+{
+  return CI.TheModule->getDataLayout().getPrefTypeAlign(YieldTy);
+}
+
+inline auto GetFrameAllocFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  auto* FT = llvm::FunctionType::get(MARE_PTR_TYPE, {MARE_INT64_TYPE}, false);
+  auto* F  = llvm::cast<llvm::Function>(
+    CI.TheModule->getOrInsertFunction(__MARE_CORO_ALLOC_FN__, FT).getCallee());
+
+  F->setDoesNotThrow();
+  F->setReturnDoesNotAlias();
+  return F;
+}
+
+inline auto GetFrameFreeFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  auto* FT = llvm::FunctionType::get(MARE_VOID_TYPE, {MARE_PTR_TYPE}, false);
+  auto* F  = llvm::cast<llvm::Function>(
+    CI.TheModule->getOrInsertFunction(__MARE_CORO_FREE_FN__, FT).getCallee());
+
+  F->setDoesNotThrow();
+  return F;
+}
+
+/// CreateSuspend - Suspend the generator. Resuming continues at Resume, and
+/// destroying it runs the cleanup.
+inline void CreateSuspend(CompilerInstance& CI, llvm::BasicBlock* Resume, bool Final)
+{
+  const GeneratorFrame& G = *CI.Generator;
+
+  llvm::Value*      Save   = llvm::ConstantTokenNone::get(*CI.TheContext);
+  llvm::Value*      Result = CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_suspend, {},
+                                                         {Save, CI.Builder->getInt1(Final)});
+  llvm::SwitchInst* SI     = CI.Builder->CreateSwitch(Result, G.Suspend, 2);
+  SI->addCase(CI.Builder->getInt8(0), Resume);
+  SI->addCase(CI.Builder->getInt8(1), G.Cleanup);
+}
+
+/// Begin - Make F a generator yielding into Promise, and leave the builder where
+/// the body starts. The generator starts suspended, so creating it runs nothing.
+inline void Begin(CompilerInstance& CI, llvm::Function* F, llvm::AllocaInst* Promise,
+                  bool Unsigned)
+{
+  llvm::LLVMContext& Ctx = *CI.TheContext;
+  F->addFnAttr(llvm::Attribute::PresplitCoroutine);
+  Promise->setAlignment(PromiseAlign(CI, Promise->getAllocatedType()));
+
+  llvm::BasicBlock* AllocBB = llvm::BasicBlock::Create(Ctx, "coro.alloc", F);
+  llvm::BasicBlock* BeginBB = llvm::BasicBlock::Create(Ctx, "coro.begin", F);
+  llvm::BasicBlock* EntryBB = CI.Builder->GetInsertBlock();
+
+  llvm::Value* Null      = llvm::ConstantPointerNull::get(MARE_PTR_TYPE);
+  llvm::Value* Align     = CI.Builder->getInt32(0); // Frames are aligned to two pointers
+  llvm::Value* Id        = CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_id, {},
+                                                       {Align, Promise, Null, Null});
+  llvm::Value* NeedAlloc = CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_alloc, {}, {Id});
+  CI.Builder->CreateCondBr(NeedAlloc, AllocBB, BeginBB);
+
+  CI.Builder->SetInsertPoint(AllocBB);
+  llvm::Value* Size =
+    CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_size, {MARE_INT64_TYPE}, {}, nullptr, "size");
+  llvm::Value* Mem = CI.Builder->CreateCall(GetFrameAllocFunction(CI), {Size}, "frame");
+  CI.Builder->CreateBr(BeginBB);
+
+  CI.Builder->SetInsertPoint(BeginBB);
+  llvm::PHINode* Frame = CI.Builder->CreatePHI(MARE_PTR_TYPE, 2, "frame.mem");
+  Frame->addIncoming(Null, EntryBB);
+  Frame->addIncoming(Mem, AllocBB);
+  llvm::Value* Handle =
+    CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_begin, {}, {Id, Frame}, nullptr, "hdl");
+
+  CI.Generator = GeneratorFrame{Id,
+                                Handle,
+                                Promise,
+                                Unsigned,
+                                llvm::BasicBlock::Create(Ctx, "coro.final"),
+                                llvm::BasicBlock::Create(Ctx, "coro.cleanup"),
+                                llvm::BasicBlock::Create(Ctx, "coro.suspend")};
+
+  llvm::BasicBlock* BodyBB = llvm::BasicBlock::Create(Ctx, "coro.body", F);
+  CreateSuspend(CI, BodyBB, /*Final=*/false);
+  CI.Builder->SetInsertPoint(BodyBB);
+}
+
+/// Yield - Hand V (already of the yielded type) to the consumer and suspend.
+inline void Yield(CompilerInstance& CI, llvm::Value* V)
+{
+  llvm::Function* F = CI.Builder->GetInsertBlock()->getParent();
+  CI.Builder->CreateStore(V, CI.Generator->Promise);
+
+  llvm::BasicBlock* ResumeBB = llvm::BasicBlock::Create(*CI.TheContext, "yield.resume", F);
+  CreateSuspend(CI, ResumeBB, /*Final=*/false);
+  CI.Builder->SetInsertPoint(ResumeBB);
+}
+
+/// End - Emit the final suspend point, the cleanup and the return of the handle
+/// once the body is complete. Ends the generator state.
+inline void End(CompilerInstance& CI)
+{
+  llvm::Function*       F   = CI.Builder->GetInsertBlock()->getParent();
+  const GeneratorFrame& G   = *CI.Generator;
+  llvm::LLVMContext&    Ctx = *CI.TheContext;
+
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(G.Final);
+
+  // Resuming a finished generator is a bug in the consumer.
+  llvm::BasicBlock* TrapBB = llvm::BasicBlock::Create(Ctx, "coro.resumed.final");
+
+  G.Final->insertInto(F);
+  CI.Builder->SetInsertPoint(G.Final);
+  CreateSuspend(CI, TrapBB, /*Final=*/true);
+
+  TrapBB->insertInto(F);
+  CI.Builder->SetInsertPoint(TrapBB);
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+  CI.Builder->CreateUnreachable();
+
+  llvm::BasicBlock* FreeBB = llvm::BasicBlock::Create(Ctx, "coro.free");
+
+  G.Cleanup->insertInto(F);
+  CI.Builder->SetInsertPoint(G.Cleanup);
+  llvm::Value* Mem =
+    CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_free, {}, {G.Id, G.Handle}, nullptr, "mem");
+  CI.Builder->CreateCondBr(CI.Builder->CreateIsNotNull(Mem), FreeBB, G.Suspend);
+
+  FreeBB->insertInto(F);
+  CI.Builder->SetInsertPoint(FreeBB);
+  CI.Builder->CreateCall(GetFrameFreeFunction(CI), {Mem});
+  CI.Builder->CreateBr(G.Suspend);
+
+  G.Suspend->insertInto(F);
+  CI.Builder->SetInsertPoint(G.Suspend);
+  llvm::Value* NoResult = llvm::ConstantTokenNone::get(Ctx);
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_end, {},
+                              {G.Handle, CI.Builder->getFalse(), NoResult});
+  CI.Builder->CreateRet(G.Handle);
+
+  CI.Generator.reset();
+}
+
+//===--- Consumer side ---===//
+
+inline void Resume(CompilerInstance& CI, llvm::Value* Handle)
+{
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_resume, {}, {Handle});
+}
+
+inline auto Done(CompilerInstance& CI, llvm::Value* Handle) -> llvm::Value*
+{
+  return CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_done, {}, {Handle}, nullptr, "done");
+}
+
+/// LoadYielded - The value the generator yielded last.
+inline auto LoadYielded(CompilerInstance& CI, llvm::Value* Handle, llvm::Type* YieldTy)
+  -> llvm::Value*
+{
+  const llvm::Align A       = PromiseAlign(CI, YieldTy);
+  llvm::Value*      Promise = CI.Builder->CreateIntrinsic(
+    llvm::Intrinsic::coro_promise, {},
+    {Handle, CI.Builder->getInt32(A.value()), CI.Builder->getFalse()});
+  return CI.Builder->CreateAlignedLoad(YieldTy, Promise, A, "yielded");
+}
+
+inline void Destroy(CompilerInstance& CI, llvm::Value* Handle)
+{
+  CI.Builder->CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {Handle});
+}
+
+} // namespace Mare::Coro
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "Colors.h"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "Effects.hpp"
+#include "ErrorHandling.hpp"
+#include "Gen.hpp"
+#include "LoopHints.hpp"
+#include "Memo.hpp"
+#include "Parser.hpp"
+#include "PrimitiveTypes.hpp"
+#include <iostream>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/TargetParser/Host.h>
+#include <mutex>
+
+//===----------------------------------------------------------------------===//
+// Top-Level parsing and compilation driver
+//
+// Everything here works on the CompilerInstance it is handed, so a host process
+// can run Driver::Compile on many instances at once (one per thread).
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Driver
+{
+
+static void HandleDefinition(CompilerInstance& CI, Mare::AttributeList Attrs = {})
+{
+  if (auto FnAST = Parser::ParseDefinition(CI, std::move(Attrs)))
+  {
+    if (FnAST->getName() == "main" && FnAST->getReturnType() == MARE_VOID_TYPE)
+    {
+      CI.FoundMain = true;
+    }
+    if (auto* FnIR = FnAST->codegen(CI))
+    {
+      std::cout << COLOR_UNDERL << COLOR_BLUE << "-- Function decl:" << COLOR_RESET << std::endl;
+      FnIR->print(errs());
+      fprintf(stderr, "\n");
+    }
+  }
+  else
+  {
+    // Skip token for error recovery.
+    Tokenizer::getNextToken(CI);
+  }
+}
+
+static void HandleExtern(CompilerInstance& CI, Mare::AttributeList Attrs = {})
+{
+  if (auto ProtoAST = Parser::ParseExtern(CI, std::move(Attrs)))
+  {
+    if (auto* FnIR = ProtoAST->codegen(CI))
+    {
+      fprintf(stderr, "Read extern: ");
+      FnIR->print(errs());
+      Effects::RecordExtern(CI, *ProtoAST);
+      CI.FunctionProtos[ProtoAST->getName()] = std::move(ProtoAST);
+    }
+  }
+  else
+  {
+    // Skip token for error recovery.
+    Tokenizer::getNextToken(CI);
+  }
+}
+
+static void HandleTopLevelExpression(CompilerInstance& CI)
+{
+  // Evaluate a top-level expression into an anonymous function.
+  if (auto FnAST = Parser::ParseTopLevelExpr(CI))
+  {
+    FnAST->codegen(CI);
+  }
+  else
+  {
+    // Skip token for error recovery.
+    Tokenizer::getNextToken(CI);
+  }
+}
+
+static void HandleStruct(CompilerInstance& CI, const Mare::AttributeList& Attrs = {})
+{
+  if (!Parser::ParseStruct(CI, Attrs))
+  {
+    // Skip token for error recovery.
+    Tokenizer::getNextToken(CI);
+  }
+}
+
+static void HandleGlobal(CompilerInstance& CI)
+{
+  if (auto GlobalAST = Parser::ParseGlobal(CI))
+  {
+    if (auto* GV = GlobalAST->codegen(CI))
+    {
+      fprintf(stderr, "Read global: ");
+      GV->print(errs());
+      fprintf(stderr, "\n");
+    }
+  }
+  else
+  {
+    // Skip token for error recovery.
+    Tokenizer::getNextToken(CI);
+  }
+}
+
+/// attributed ::= attributes (definition | external | structdecl)
+static void HandleAttributedDecl(CompilerInstance& CI)
+{
+  Mare::AttributeList Attrs = Parser::ParseAttributes(CI);
+
+  switch (CI.CurTok)
+  {
+    case tok_def:
+    case tok_gen:
+      HandleDefinition(CI, std::move(Attrs));
+      break;
+    case tok_extern:
+      HandleExtern(CI, std::move(Attrs));
+      break;
+    case tok_struct:
+      HandleStruct(CI, Attrs);
+      break;
+    default:
+      Err::LogError(CI, "Expected 'fn', 'extern' or 'struct' after attributes");
+  }
+}
+
+/// top ::= definition | external | structdecl | globaldecl | attributed | expression | ';'
+static void MainLoop(CompilerInstance& CI)
+{
+  while (true)
+  {
+    switch (CI.CurTok)
+    {
+      case tok_eof:
+        return;
+      case STATEMENT_DELIM: // ignore top-level semicolons.
+        Tokenizer::getNextToken(CI);
+        break;
+      case tok_def:
+      case tok_gen:
+        HandleDefinition(CI);
+        break;
+      case tok_extern:
+        HandleExtern(CI);
+        break;
+      case tok_struct:
+        HandleStruct(CI);
+        break;
+      case tok_const:
+      case tok_global:
+        HandleGlobal(CI);
+        break;
+      case tok_attribute:
+        HandleAttributedDecl(CI);
+        break;
+      default:
+        HandleTopLevelExpression(CI);
+        break;
+    }
+  }
+}
+
+inline void SetPrecedence(CompilerInstance& CI)
+{
+  // Install standard binary operators.
+  // 1 is lowest precedence.
+  CI.BinopPrecedence['=']     = 2;
+  CI.BinopPrecedence[tok_or]  = 3;
+  CI.BinopPrecedence[tok_and] = 4;
+  CI.BinopPrecedence['|']     = 5;
+  CI.BinopPrecedence['^']     = 6;
+  CI.BinopPrecedence['&']     = 7;
+  CI.BinopPrecedence[tok_eq]  = 9;
+  CI.BinopPrecedence[tok_ne]  = 9;
+  CI.BinopPrecedence['<']     = 10;
+  CI.BinopPrecedence['>']     = 10;
+  CI.BinopPrecedence[tok_le]  = 10;
+  CI.BinopPrecedence[tok_ge]  = 10;
+  CI.BinopPrecedence[tok_shl] = 15;
+  CI.BinopPrecedence[tok_shr] = 15;
+  CI.BinopPrecedence['+']     = 20;
+  CI.BinopPrecedence['-']     = 20;
+  CI.BinopPrecedence['*']     = 40; // highest.
+  CI.BinopPrecedence['/']     = 50;
+}
+
+/// InitializeTargets - LLVM's target registry is process wide; fill it exactly once.
+inline void InitializeTargets()
+{
+  static std::once_flag Once;
+  std::call_once(Once,
+                 []
+                 {
+                   llvm::InitializeAllTargetInfos();
+                   llvm::InitializeAllTargets();
+                   llvm::InitializeAllTargetMCs();
+                   llvm::InitializeAllAsmParsers();
+                   llvm::InitializeAllAsmPrinters();
+                 });
+}
+
+inline auto CreateHostTargetMachine(CompilerInstance& CI) -> std::unique_ptr<llvm::TargetMachine>
+{
+  InitializeTargets();
+
+  std::string targetTriple = llvm::sys::getDefaultTargetTriple();
+  CI.TheModule->setTargetTriple(targetTriple);
+  std::cout << "[*] Detected target triple: " << targetTriple << "\n";
+
+  std::string         error;
+  const llvm::Target* target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
+  if (!target)
+  {
+    llvm::errs() << "[!] Failed to lookup target: " << error << "\n";
+    return nullptr;
+  }
+
+  std::string cpu = llvm::sys::getHostCPUName().str();
+  if (cpu.empty())
+    cpu = __MARE_CPU_STANDARD__;
+
+  std::cout << "[*] Host CPU: " << cpu << "\n";
+
+  if (CI.Args.showCPUFeatures)
+  {
+    // Feature detection
+    llvm::StringMap<bool> hostFeatures = llvm::sys::getHostCPUFeatures();
+    std::string           features;
+    for (const auto& f : hostFeatures)
+    {
+      if (f.second)
+        features += f.first().str() + ",";
+    }
+    if (!features.empty())
+      features.pop_back(); // Remove trailing comma
+
+    std::cout << "[*] CPU features: " << features << "\n";
+  }
+
+  // Floating point semantics travel on each instruction (see FastMath.hpp), so
+  // the backend only fuses operations that allow contraction.
+  llvm::TargetOptions opt;
+  opt.AllowFPOpFusion      = llvm::FPOpFusion::Standard;
+  opt.MCOptions.AsmVerbose = true;
+  opt.EnableFastISel       = true;
+
+  std::unique_ptr<llvm::TargetMachine> targetMachine(
+    target->createTargetMachine(targetTriple, cpu, "", opt, Reloc::PIC_));
+
+  if (!targetMachine)
+  {
+    llvm::errs() << "[!] Failed to create TargetMachine\n";
+    return nullptr;
+  }
+
+  CI.TheModule->setDataLayout(targetMachine->createDataLayout());
+  std::cout << "[*] DataLayout: " << CI.TheModule->getDataLayout().getStringRepresentation()
+            << "\n";
+
+  return targetMachine;
+}
+
+static auto AddOptimizationsAndEmitObjectFile(CompilerInstance& CI) -> bool
+{
+  auto TargetMachine = CreateHostTargetMachine(CI);
+  if (!TargetMachine)
+    return false;
+
+  std::error_code EC;
+  raw_fd_ostream  dest(CI.Args.objectFile, EC, sys::fs::OF_None);
+
+  if (EC)
+  {
+    llvm::errs() << "[!] Could not open output file: " << EC.message() << "\n";
+    return false;
+  }
+
+  // --- Set up the new pass manager ---
+  llvm::LoopAnalysisManager     loopAM;
+  llvm::FunctionAnalysisManager functionAM;
+  llvm::CGSCCAnalysisManager    cgsccAM;
+  llvm::ModuleAnalysisManager   moduleAM;
+
+  llvm::PassBuilder PB(TargetMachine.get());
+
+  // Register required analyses
+  PB.registerModuleAnalyses(moduleAM);
+  PB.registerCGSCCAnalyses(cgsccAM);
+  PB.registerFunctionAnalyses(functionAM);
+  PB.registerLoopAnalyses(loopAM);
+  PB.crossRegisterProxies(loopAM, functionAM, cgsccAM, moduleAM);
+
+  // Create the optimization pipeline at -O3
+  llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+
+  // Run the pass pipeline; loop hints it could not honor come back as warnings
+  CI.TheContext->setDiagnosticHandler(std::make_unique<LoopHints::MissedHintHandler>());
+  MPM.run(*CI.TheModule, moduleAM);
+
+  // Emit object file
+  llvm::legacy::PassManager codeGenPass;
+  if (TargetMachine->addPassesToEmitFile(codeGenPass, dest, nullptr, CodeGenFileType::ObjectFile))
+  {
+    llvm::errs() << "[!] TargetMachine can't emit file of this type\n";
+    return false;
+  }
+
+  codeGenPass.run(*CI.TheModule);
+  dest.flush();
+
+  return true;
+}
+
+/// Compile - Parse, generate and emit the program named by CI.Args.
+/// Returns false (instead of exiting) if compilation fails.
+inline auto Compile(CompilerInstance& CI) -> bool
+{
+  try
+  {
+    SetPrecedence(CI);
+
+    // Prime the first token.
+    Tokenizer::getNextToken(CI);
+
+    // Run the main "interpreter loop" now.
+    MainLoop(CI);
+
+    fprintf(stderr, "%s%s%s%s: \n", COLOR_BOLD, COLOR_UNDERL, CI.Args.inputFile.c_str(),
+            COLOR_RESET);
+
+    if (!CI.FoundMain)
+    {
+      PRINT_ERROR("Missing required 'main' function entry point.");
+      PRINT_HINT("Define a top-level function: fn main() -> void");
+      return false;
+    }
+
+    Effects::InferFunctionAttributes(CI);
+    Memo::EmitMemoWrappers(CI);
+
+    return AddOptimizationsAndEmitObjectFile(CI);
+  }
+  catch (const Err::CompileError&)
+  {
+    return false;
+  }
+}
+
+} // namespace Mare::Driver
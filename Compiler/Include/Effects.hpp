@@ -0,0 +1,379 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include <set>
+
+//===----------------------------------------------------------------------===//
+// Function Attribute Inference
+//
+// Every function body is summarised into the effects it has by itself plus the
+// set of functions it calls. Once the whole module is known, the summaries are
+// propagated across the call graph and turned into LLVM function attributes
+// (memory(none)/memory(read), nounwind, willreturn, nosync, noalias).
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Effects
+{
+
+/// AttributeEffects - Effects that a user annotation asserts to be absent.
+inline auto AttributeEffects(const AttributeList& Attrs) -> unsigned
+{
+  unsigned Asserted = Effect_None;
+  for (const auto& A : Attrs)
+  {
+    if (A.Name == "pure")
+      Asserted |= Effect_Unknown;
+    else if (A.Name == "readnone")
+      Asserted |= Effect_ReadsMemory | Effect_WritesMemory;
+    else if (A.Name == "readonly")
+      Asserted |= Effect_WritesMemory;
+    else if (A.Name == "nounwind")
+      Asserted |= Effect_MayUnwind;
+    else if (A.Name == "willreturn")
+      Asserted |= Effect_MayNotReturn;
+    else if (A.Name == "nosync")
+      Asserted |= Effect_MaySync;
+  }
+  return Asserted;
+}
+
+/// RecordFunction - Summarise a function body right after it has been generated.
+inline void RecordFunction(CompilerInstance& CI, const Prototype& P, const Expr& Body)
+{
+  EffectSummary S;
+  Body.collectEffects(S);
+  S.Asserted = AttributeEffects(P.getAttributes());
+  S.NoAlias  = P.hasAttribute("noalias");
+
+  // A generator allocates its frame when it is created and frees it when destroyed.
+  if (P.isGenerator())
+  {
+    S.addCall(__MARE_CORO_ALLOC_FN__);
+    S.addCall(__MARE_CORO_FREE_FN__);
+  }
+
+  CI.FunctionEffects[P.getName()] = std::move(S);
+}
+
+/// RecordExtern - Externs are opaque; only what the user asserts is known about them.
+inline void RecordExtern(CompilerInstance& CI, const Prototype& P)
+{
+  EffectSummary S;
+  S.Bits     = Effect_Unknown;
+  S.Asserted = AttributeEffects(P.getAttributes());
+  S.NoAlias  = P.hasAttribute("noalias");
+  S.IsExtern = true;
+
+  CI.FunctionEffects[P.getName()] = std::move(S);
+}
+
+/// Resolve - Propagate effects over the call graph until nothing changes.
+/// Functions that can reach themselves may recurse forever, so they lose willreturn.
+inline auto Resolve(const CompilerInstance& CI) -> std::map<std::string, unsigned>
+{
+  const auto& FunctionEffects = CI.FunctionEffects;
+
+  std::map<std::string, unsigned> Resolved;
+  for (const auto& [Name, S] : FunctionEffects)
+    Resolved[Name] = S.Bits & ~S.Asserted;
+
+  // Transitive reachability for recursion detection
+  auto reaches = [&](const std::string& From, const std::string& To) -> bool
+  {
+    std::set<std::string>    Seen;
+    std::vector<std::string> Work{From};
+    while (!Work.empty())
+    {
+      std::string Cur = Work.back();
+      Work.pop_back();
+      auto It = FunctionEffects.find(Cur);
+      if (It == FunctionEffects.end())
+        continue;
+      for (const auto& Callee : It->second.Callees)
+      {
+        if (Callee == To)
+          return true;
+        if (Seen.insert(Callee).second)
+          Work.push_back(Callee);
+      }
+    }
+    return false;
+  };
+
+  for (const auto& [Name, S] : FunctionEffects)
+    if (!S.IsExtern && reaches(Name, Name))
+      Resolved[Name] |= Effect_MayNotReturn & ~S.Asserted;
+
+  bool Changed = true;
+  while (Changed)
+  {
+    Changed = false;
+    for (const auto& [Name, S] : FunctionEffects)
+    {
+      unsigned Bits = Resolved[Name];
+      for (const auto& Callee : S.Callees)
+      {
+        auto It = Resolved.find(Callee);
+        Bits |= (It != Resolved.end()) ? It->second : Effect_Unknown;
+      }
+      Bits &= ~S.Asserted;
+
+      if (Bits != Resolved[Name])
+      {
+        Resolved[Name] = Bits;
+        Changed        = true;
+      }
+    }
+  }
+
+  return Resolved;
+}
+
+/// InferFunctionAttributes - Attach the resolved effects to the module's functions.
+inline void InferFunctionAttributes(CompilerInstance& CI)
+{
+  for (const auto& [Name, Bits] : Resolve(CI))
+  {
+    llvm::Function* F = CI.TheModule->getFunction(Name);
+    if (!F)
+      continue;
+
+    if (!(Bits & (Effect_ReadsMemory | Effect_WritesMemory)))
+      F->setDoesNotAccessMemory();
+    else if (!(Bits & Effect_WritesMemory))
+      F->setOnlyReadsMemory();
+
+    if (!(Bits & Effect_MayUnwind))
+      F->setDoesNotThrow();
+    if (!(Bits & Effect_MayNotReturn))
+      F->addFnAttr(llvm::Attribute::WillReturn);
+    if (!(Bits & Effect_MaySync))
+      F->addFnAttr(llvm::Attribute::NoSync);
+
+    if (CI.FunctionEffects[Name].NoAlias)
+    {
+      if (F->getReturnType()->isPointerTy())
+        F->addRetAttr(llvm::Attribute::NoAlias);
+      for (auto& Arg : F->args())
+        if (Arg.getType()->isPointerTy())
+          Arg.addAttr(llvm::Attribute::NoAlias);
+    }
+  }
+}
+
+} // namespace Mare::Effects
+
+namespace Mare
+{
+
+//===----------------------------------------------------------------------===//
+// Per-node effect collection
+//===----------------------------------------------------------------------===//
+
+inline void BlockExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& E : Expressions)
+    E->collectEffects(S);
+}
+
+inline void FPModeExpr::collectEffects(EffectSummary& S) const { Body->collectEffects(S); }
+
+inline void NumberExpr::collectEffects(EffectSummary& /*S*/) const {}
+
+// String literals are private constants; taking their address touches nothing.
+inline void StringExpr::collectEffects(EffectSummary& /*S*/) const {}
+
+// Variables live in allocas private to the function.
+inline void VariableExpr::collectEffects(EffectSummary& S) const
+{
+  if (IsGlobal)
+    S.add(Effect_ReadsMemory);
+}
+
+inline void UnaryExpr::collectEffects(EffectSummary& S) const
+{
+  Operand->collectEffects(S);
+  if (CallsOperator)
+    S.addCall(std::string(__MARE_UNARY_FUNC_DECL__) + Opcode);
+}
+
+inline void BinaryExpr::collectEffects(EffectSummary& S) const
+{
+  LHS->collectEffects(S);
+  RHS->collectEffects(S);
+
+  if (Op == '=' && LHS->isThroughPointer())
+    S.add(Effect_WritesMemory);
+
+  if (CallsOperator)
+    S.addCall(std::string(__MARE_BINARY_FUNC_DECL__) + static_cast<char>(Op));
+}
+
+inline void CallExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& Arg : Args)
+    Arg->collectEffects(S);
+  if (!IsBuiltin)
+    S.addCall(Callee);
+  if (StoresThroughPointer)
+    S.add(Effect_WritesMemory);
+  S.add(BuiltinEffects);
+}
+
+// The thread runs the callee and shares memory with the spawning one.
+inline void SpawnExpr::collectEffects(EffectSummary& S) const
+{
+  Call->collectEffects(S);
+  S.addCall(__MARE_SPAWN_FN__);
+}
+
+// Without side effects a block only computes its outputs from its inputs.
+inline void AsmExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& In : Inputs)
+    In.Value->collectEffects(S);
+  if (hasSideEffects())
+    S.add(Effect_Unknown);
+}
+
+inline void MatchExpr::collectEffects(EffectSummary& S) const
+{
+  Scrutinee->collectEffects(S);
+  for (const auto& Arm : Arms)
+    Arm.Body->collectEffects(S);
+}
+
+inline void IfExpr::collectEffects(EffectSummary& S) const
+{
+  Cond->collectEffects(S);
+  Then->collectEffects(S);
+  Else->collectEffects(S);
+}
+
+// Termination of a loop is not proven, so it may not return.
+inline void ForExpr::collectEffects(EffectSummary& S) const
+{
+  Start->collectEffects(S);
+  End->collectEffects(S);
+  if (Step)
+    Step->collectEffects(S);
+  Body->collectEffects(S);
+  S.add(Effect_MayNotReturn);
+}
+
+inline void RangeForExpr::collectEffects(EffectSummary& S) const
+{
+  Start->collectEffects(S);
+  End->collectEffects(S);
+  if (Step)
+    Step->collectEffects(S);
+  Body->collectEffects(S);
+  if (!ConstantStep)
+    S.add(Effect_MayNotReturn); // A zero step never reaches the end
+}
+
+inline void ReduceExpr::collectEffects(EffectSummary& S) const
+{
+  Start->collectEffects(S);
+  End->collectEffects(S);
+  Body->collectEffects(S);
+}
+
+// The body runs on the pool's threads, which the runtime call stands for.
+inline void ParallelForExpr::collectEffects(EffectSummary& S) const
+{
+  Start->collectEffects(S);
+  End->collectEffects(S);
+  Body->collectEffects(S);
+  S.addCall(__MARE_PFOR_FN__);
+}
+
+inline void WhileExpr::collectEffects(EffectSummary& S) const
+{
+  Cond->collectEffects(S);
+  Body->collectEffects(S);
+  S.add(Effect_MayNotReturn);
+}
+
+inline void BreakExpr::collectEffects(EffectSummary& /*S*/) const {}
+
+inline void ContinueExpr::collectEffects(EffectSummary& /*S*/) const {}
+
+inline void YieldExpr::collectEffects(EffectSummary& S) const { Operand->collectEffects(S); }
+
+inline void VarExpr::collectEffects(EffectSummary& S) const
+{
+  if (Init)
+    Init->collectEffects(S);
+}
+
+inline void DestructureExpr::collectEffects(EffectSummary& S) const { Init->collectEffects(S); }
+
+inline void TupleExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& E : Elements)
+    E->collectEffects(S);
+}
+
+inline void ArrayExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& E : Elements)
+    E->collectEffects(S);
+}
+
+inline void VectorExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& E : Lanes)
+    E->collectEffects(S);
+}
+
+inline void CastExpr::collectEffects(EffectSummary& S) const { Operand->collectEffects(S); }
+
+inline void StructExpr::collectEffects(EffectSummary& S) const
+{
+  for (const auto& E : Fields)
+    E->collectEffects(S);
+}
+
+// Elements of local arrays are locals; anything reached through a slice is not.
+inline void IndexExpr::collectEffects(EffectSummary& S) const
+{
+  Base->collectEffects(S);
+  Index->collectEffects(S);
+  if (ThroughPointer)
+    S.add(Effect_ReadsMemory);
+}
+
+inline void MemberExpr::collectEffects(EffectSummary& S) const { Base->collectEffects(S); }
+
+inline void NewSliceExpr::collectEffects(EffectSummary& S) const
+{
+  Count->collectEffects(S);
+  S.addCall(__MARE_ALLOC_FN__);
+}
+
+inline void DeleteExpr::collectEffects(EffectSummary& S) const
+{
+  Operand->collectEffects(S);
+  S.addCall(__MARE_FREE_FN__);
+}
+
+// Runs exactly once per element, so unlike ForExpr it always terminates. Driving a
+// generator brings in the generator's effects, which include its frame allocation.
+inline void ForEachExpr::collectEffects(EffectSummary& S) const
+{
+  Range->collectEffects(S);
+  Body->collectEffects(S);
+  if (ThroughPointer)
+    S.add(Effect_ReadsMemory);
+}
+
+inline void ReturnExpr::collectEffects(EffectSummary& S) const
+{
+  if (Exp)
+    Exp->collectEffects(S);
+}
+
+} // namespace Mare
@@ -2,48 +2,64 @@
 
 #include "AST.hpp"
 #include "Colors.h"
+#include "CompilerInstance.hpp"
 #include "Diagnostics.hpp"
 #include "Globals.hpp"
+#include <stdexcept>
 
 namespace Mare::Err
 {
 
+/// CompileError - Thrown by FatalError; aborts the compilation it was raised in
+/// without taking the rest of the process down.
+struct CompileError : std::runtime_error
+{
+  using std::runtime_error::runtime_error;
+};
+
 //===----------------------------------------------------------------------===//
 // FatalError - Will print the current codegen coords and parsing coords
-// This function will always exit in failure!!
+// This function will always abort the current compilation!!
 //===----------------------------------------------------------------------===//
-[[noreturn]] void FatalError(const char* message)
+[[noreturn]] void FatalError(const CompilerInstance& CI, const char* message)
 {
   fprintf(stderr,
           "-- %s Reading Cursor stopped at line %d, column %d\n-- %s Codegen cursor stopped at "
           "line %d, column %d\n",
-          HINT_LABEL, Global::fileCoords.line, Global::fileCoords.col, HINT_LABEL,
-          Global::fileCoords.codegenCoords.line, Global::fileCoords.codegenCoords.col);
-  std::exit(EXIT_FAILURE);
+          HINT_LABEL, CI.fileCoords.line, CI.fileCoords.col, HINT_LABEL,
+          CI.fileCoords.codegenCoords.line, CI.fileCoords.codegenCoords.col);
+  throw CompileError(message);
 }
 
 /// LogError* - These are little helper functions for error handling.
-auto LogError(const char* msg) -> std::unique_ptr<Expr>
+auto LogError(const CompilerInstance& CI, const char* msg) -> std::unique_ptr<Expr>
 {
   // If you have current location tracking:
-  printDiagnostic(DiagnosticLevel::Error, msg, mareArgs.inputFile,
-                  Global::fileCoords.codegenCoords.line, Global::fileCoords.codegenCoords.col,
+  printDiagnostic(DiagnosticLevel::Error, msg, CI.Args.inputFile,
+                  CI.fileCoords.codegenCoords.line, CI.fileCoords.codegenCoords.col,
                   "Check syntax near the cursor!");
 
-  FatalError("Exiting compilation.");
+  FatalError(CI, "Exiting compilation.");
   return nullptr;
 }
 
-auto LogErrorP(const char* Str) -> std::unique_ptr<Prototype>
+/// LogWarning - Report a problem that does not stop compilation.
+void LogWarning(const CompilerInstance& CI, const char* msg, const std::string& hint = "")
+{
+  printDiagnostic(DiagnosticLevel::Warning, msg, CI.Args.inputFile,
+                  CI.fileCoords.codegenCoords.line, CI.fileCoords.codegenCoords.col, hint);
+}
+
+auto LogErrorP(const CompilerInstance& CI, const char* Str) -> std::unique_ptr<Prototype>
 {
   printDiagnostic(
     DiagnosticLevel::Error, Str,
-    mareArgs.inputFile,                    // Optionally provide current filename
-    Global::fileCoords.codegenCoords.line, // Line number, if known
-    Global::fileCoords.codegenCoords.col,  // Column number, if known
+    CI.Args.inputFile,                // Optionally provide current filename
+    CI.fileCoords.codegenCoords.line, // Line number, if known
+    CI.fileCoords.codegenCoords.col,  // Column number, if known
     "Ensure function prototypes are declared as: fn name(type name, ...) -> return_type");
 
-  FatalError("Exiting compilation due to prototyping errors.");
+  FatalError(CI, "Exiting compilation due to prototyping errors.");
 
   return nullptr;
 }
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include <llvm/IR/IRBuilder.h>
+
+//===----------------------------------------------------------------------===//
+// Floating Point Modes
+//
+// Every floating point operation, call and compare carries the fast-math flags
+// of the innermost mode around it. Functions and expressions choose a mode:
+//
+//   @fastmath fn dot([double] xs, [double] ys) -> double { ... }
+//   @strictfp { total = total + x; }
+//
+//   @fastmath             -> every flag (`fast`)
+//   @fastmath(nnan, nsz)  -> only the flags named: reassoc, contract, nnan, ninf,
+//                            nsz, arcp, afn
+//   @strictfp             -> none: each operation rounds as written
+//
+// Code outside any mode follows --fp-model: fast (the default), precise (only
+// contraction into fma) or strict. The flags live on the IRBuilder, so a mode
+// covers exactly the instructions emitted inside it. Strict code still assumes
+// the default rounding mode and ignores floating point exceptions.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::FastMath
+{
+
+/// SetFlag - Add the flag spelled Name to FMF; false if there is no such flag.
+inline auto SetFlag(llvm::FastMathFlags& FMF, std::string_view Name) -> bool
+{
+  if (Name == "reassoc")
+    FMF.setAllowReassoc();
+  else if (Name == "contract")
+    FMF.setAllowContract();
+  else if (Name == "nnan")
+    FMF.setNoNaNs();
+  else if (Name == "ninf")
+    FMF.setNoInfs();
+  else if (Name == "nsz")
+    FMF.setNoSignedZeros();
+  else if (Name == "arcp")
+    FMF.setAllowReciprocal();
+  else if (Name == "afn")
+    FMF.setApproxFunc();
+  else
+    return false;
+  return true;
+}
+
+/// ModelFlags - The flags of an --fp-model, or nullopt for an unknown model.
+inline auto ModelFlags(std::string_view Model) -> std::optional<llvm::FastMathFlags>
+{
+  llvm::FastMathFlags FMF;
+  if (Model == "fast")
+    FMF.setFast();
+  else if (Model == "precise")
+    FMF.setAllowContract();
+  else if (Model != "strict")
+    return std::nullopt;
+  return FMF;
+}
+
+inline auto IsMode(const Attribute& A) -> bool
+{
+  return A.Name == "fastmath" || A.Name == "strictfp";
+}
+
+/// IsValidMode - Whether A is a mode with well-formed arguments.
+inline auto IsValidMode(const Attribute& A) -> bool
+{
+  if (A.Name == "strictfp")
+    return A.Args.empty();
+
+  llvm::FastMathFlags FMF;
+  for (const auto& Arg : A.Args)
+    if (Arg.Value || !SetFlag(FMF, Arg.Key))
+      return false;
+  return A.Name == "fastmath";
+}
+
+/// Mode - The flags Attrs ask for, if they name a mode; the last valid one wins.
+inline auto Mode(const AttributeList& Attrs) -> std::optional<llvm::FastMathFlags>
+{
+  std::optional<llvm::FastMathFlags> FMF;
+  for (const auto& A : Attrs)
+  {
+    if (!IsMode(A) || !IsValidMode(A))
+      continue;
+
+    FMF.emplace();
+    if (A.Name == "fastmath" && A.Args.empty())
+      FMF->setFast();
+    for (const auto& Arg : A.Args)
+      SetFlag(*FMF, Arg.Key);
+  }
+  return FMF;
+}
+
+/// Default - The flags of code outside any mode.
+inline auto Default(const CompilerInstance& CI) -> llvm::FastMathFlags
+{
+  return ModelFlags(CI.Args.fpModel).value_or(llvm::FastMathFlags::getFast());
+}
+
+} // namespace Mare::FastMath
@@ -1,26 +1,34 @@
 #pragma once
 
+#include "Builtins.hpp"
 #include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "Coroutines.hpp"
+#include "Effects.hpp"
+#include "FastMath.hpp"
 #include "GenHelper.hpp"
 #include "Globals.hpp"
+#include "LoopHints.hpp"
+#include "Memo.hpp"
 #include "PrimitiveTypes.hpp"
+#include "Threads.hpp"
+#include "Types.hpp"
+#include <llvm/IR/InlineAsm.h>
 
 namespace Mare
 {
 
-static std::map<std::string, std::unique_ptr<Prototype>> FunctionProtos;
-
-inline auto getFunction(std::string Name) -> llvm::Function*
+inline auto getFunction(CompilerInstance& CI, std::string Name) -> llvm::Function*
 {
   // First, see if the function has already been added to the current module.
-  if (auto* F = TheModule->getFunction(Name))
+  if (auto* F = CI.TheModule->getFunction(Name))
     return F;
 
   // If not, check whether we can codegen the declaration from some existing
   // prototype.
-  auto FI = FunctionProtos.find(Name);
-  if (FI != FunctionProtos.end())
-    return FI->second->codegen();
+  auto FI = CI.FunctionProtos.find(Name);
+  if (FI != CI.FunctionProtos.end())
+    return FI->second->codegen(CI);
 
   // If no existing prototype exists, return null.
   return nullptr;
@@ -35,83 +43,427 @@ static auto CreateEntryBlockAlloca(llvm::Function* TheFunction, llvm::Type* Allo
   return TmpB.CreateAlloca(AllocType, nullptr, VarName);
 }
 
-inline auto NumberExpr::codegen() -> llvm::Value*
+/// MaterializeAddress - Storage of E; an rvalue is spilled to a temporary first.
+static auto MaterializeAddress(CompilerInstance& CI, Expr& E) -> Address
+{
+  if (Address A = E.codegenAddress(CI))
+    return A;
+
+  llvm::Value* V = E.codegen(CI);
+  if (!V)
+    return {};
+
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+  AllocaInst*     Tmp         = CreateEntryBlockAlloca(TheFunction, V->getType(), "tmp");
+  CI.Builder->CreateStore(V, Tmp);
+  return {Tmp, V->getType()};
+}
+
+/// ElementView - First element, length and element type of an array or slice.
+struct ElementView
+{
+  llvm::Value* Data;
+  llvm::Value* Len;
+  llvm::Type*  Elem;
+  bool         SoA = false; // Data holds one array per field, see Types.hpp
+};
+
+static auto ViewElements(CompilerInstance& CI, const Address& Storage) -> std::optional<ElementView>
+{
+  if (auto* AT = llvm::dyn_cast<llvm::ArrayType>(Storage.Ty))
+    return ElementView{Storage.Ptr, ConstantInt::get(MARE_INT64_TYPE, AT->getNumElements()),
+                       AT->getElementType()};
+
+  if (llvm::Type* Elem = Types::SliceElementType(CI, Storage.Ty))
+  {
+    llvm::Value* DataPtr = CI.Builder->CreateStructGEP(Storage.Ty, Storage.Ptr, 0);
+    llvm::Value* LenPtr  = CI.Builder->CreateStructGEP(Storage.Ty, Storage.Ptr, 1);
+    return ElementView{CI.Builder->CreateLoad(MARE_PTR_TYPE, DataPtr, "data"),
+                       CI.Builder->CreateLoad(MARE_INT64_TYPE, LenPtr, "len"), Elem,
+                       Types::IsSoAType(CI, Elem)};
+  }
+
+  return std::nullopt;
+}
+
+/// IsConstantStorage - Whether Ptr points into a top-level `const`.
+static auto IsConstantStorage(llvm::Value* Ptr) -> bool
+{
+  auto* GV = llvm::dyn_cast<llvm::GlobalVariable>(Ptr->stripInBoundsOffsets());
+  return GV && GV->isConstant();
+}
+
+/// IsLocalStorage - Whether Ptr points into one of the function's own allocas,
+/// or into constant data; accessing either is not a memory effect.
+static auto IsLocalStorage(llvm::Value* Ptr) -> bool
+{
+  return llvm::isa<llvm::AllocaInst>(Ptr->stripInBoundsOffsets()) || IsConstantStorage(Ptr);
+}
+
+/// MakeSlice - Build a `[T]` value from a data pointer and a length.
+static auto MakeSlice(CompilerInstance& CI, llvm::Type* SliceTy, llvm::Value* Data,
+                      llvm::Value* Len) -> llvm::Value*
+{
+  llvm::Value* Slice = llvm::PoisonValue::get(SliceTy);
+  Slice              = CI.Builder->CreateInsertValue(Slice, Data, 0);
+  return CI.Builder->CreateInsertValue(Slice, Len, 1, "slice");
+}
+
+/// ElementAddress - Address of element Idx of an array or slice.
+static auto ElementAddress(CompilerInstance& CI, const ElementView& View, llvm::Value* Idx)
+  -> Address
+{
+  if (View.SoA)
+    return {View.Data, View.Elem, Idx, View.Len};
+  return {CI.Builder->CreateInBoundsGEP(View.Elem, View.Data, Idx, "elemptr"), View.Elem};
+}
+
+/// SoAFieldAddress - Address of field Field of an element of a `@layout(soa)` slice.
+static auto SoAFieldAddress(CompilerInstance& CI, const Address& Elem, unsigned Field) -> Address
+{
+  const StructInfo* S       = Types::FindStruct(CI, Elem.Ty);
+  llvm::Type*       FieldTy = S->Ty->getElementType(Field);
+
+  llvm::Value* Offset = CI.Builder->getInt64(S->SoAOffsets[Field]);
+  llvm::Value* Skip   = CI.Builder->CreateMul(Elem.SoALen, Offset, "skip", /*HasNUW=*/true,
+                                              /*HasNSW=*/true);
+  llvm::Value* Column = CI.Builder->CreateInBoundsGEP(MARE_INT8_TYPE, Elem.Ptr, Skip,
+                                                      S->Fields[Field] + ".col");
+  return {CI.Builder->CreateInBoundsGEP(FieldTy, Column, Elem.SoAIndex, S->Fields[Field] + ".ptr"),
+          FieldTy};
+}
+
+/// FieldAddress - Address of the field Name of the struct stored at Storage.
+static auto FieldAddress(CompilerInstance& CI, const Address& Storage, const std::string& Name)
+  -> Address
+{
+  const StructInfo* S = Types::FindStruct(CI, Storage.Ty);
+  if (!S)
+  {
+    const std::string errMsg = "Unknown member '" + Name + "'";
+    return LogErrorV(CI, errMsg.c_str()), Address{};
+  }
+
+  auto It = std::find(S->Fields.begin(), S->Fields.end(), Name);
+  if (It == S->Fields.end())
+  {
+    const std::string errMsg =
+      "Struct '" + S->Ty->getName().str() + "' has no field '" + Name + "'";
+    return LogErrorV(CI, errMsg.c_str()), Address{};
+  }
+
+  const unsigned Field = It - S->Fields.begin();
+  if (Storage.SoAIndex)
+    return SoAFieldAddress(CI, Storage, Field);
+  return {CI.Builder->CreateStructGEP(S->Ty, Storage.Ptr, Field, Name + ".ptr"),
+          S->Ty->getElementType(Field)};
+}
+
+/// LoadAddress/StoreAddress - Access an lvalue; SoA elements are gathered from
+/// (scattered to) their field arrays.
+static auto LoadAddress(CompilerInstance& CI, const Address& A, const llvm::Twine& Name = "")
+  -> llvm::Value*
+{
+  if (!A.SoAIndex)
+    return CI.Builder->CreateLoad(A.Ty, A.Ptr, Name);
+
+  llvm::Value* Agg = llvm::PoisonValue::get(A.Ty);
+  for (unsigned i = 0; i != A.Ty->getStructNumElements(); ++i)
+  {
+    Address      Field = SoAFieldAddress(CI, A, i);
+    llvm::Value* Val   = CI.Builder->CreateLoad(Field.Ty, Field.Ptr, "field");
+    Agg                = CI.Builder->CreateInsertValue(Agg, Val, i);
+  }
+  return Agg;
+}
+
+static void StoreAddress(CompilerInstance& CI, const Address& A, llvm::Value* Val)
+{
+  if (!A.SoAIndex)
+  {
+    CI.Builder->CreateStore(Val, A.Ptr);
+    return;
+  }
+
+  for (unsigned i = 0; i != A.Ty->getStructNumElements(); ++i)
+    CI.Builder->CreateStore(CI.Builder->CreateExtractValue(Val, i), SoAFieldAddress(CI, A, i).Ptr);
+}
+
+/// Runtime storage behind `new`/`delete`, see __mare_alloc in Runtime/Runtime.h.
+static auto GetAllocFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  auto* FT = llvm::FunctionType::get(MARE_PTR_TYPE, {MARE_INT64_TYPE}, false);
+  auto* F  = llvm::cast<llvm::Function>(
+    CI.TheModule->getOrInsertFunction(__MARE_ALLOC_FN__, FT).getCallee());
+
+  F->setDoesNotThrow();
+  F->setReturnDoesNotAlias();
+  F->addRetAttr(
+    llvm::Attribute::getWithAlignment(*CI.TheContext, llvm::Align(__MARE_ALLOC_ALIGN__)));
+  return F;
+}
+
+static auto GetFreeFunction(CompilerInstance& CI) -> llvm::Function*
 {
-  llvm::Constant* constVal = Util::GetConstantFromValue(Val, ValType, *TheContext);
+  auto* FT = llvm::FunctionType::get(MARE_VOID_TYPE, {MARE_PTR_TYPE}, false);
+  auto* F  = llvm::cast<llvm::Function>(
+    CI.TheModule->getOrInsertFunction(__MARE_FREE_FN__, FT).getCallee());
+
+  F->setDoesNotThrow();
+  return F;
+}
+
+inline auto NumberExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Constant* constVal = Util::GetConstantFromValue(Val, ValType, *CI.TheContext);
   return constVal;
 }
 
-inline auto VariableExpr::codegen() -> Value*
+inline auto VariableExpr::codegen(CompilerInstance& CI) -> Value*
 {
   // Look this variable up in the function.
-  AllocaInst* V = NamedValues[Name];
+  AllocaInst* V = CI.NamedValues[Name];
   if (!V)
-    return LogErrorV("(Var) Unknown variable name");
+  {
+    // A `pfor` chunk reaches the locals of the enclosing function in its frame.
+    if (auto SI = CI.SharedLocals.find(Name); SI != CI.SharedLocals.end())
+    {
+      Unsigned = CI.UnsignedValues.contains(SI->second.Ptr);
+      CI.fileCoords.UpdateCodegenCoords();
+      return CI.Builder->CreateLoad(VarType ? VarType : SI->second.Ty, SI->second.Ptr,
+                                    Name.c_str());
+    }
+
+    // Not a local: a top-level `const` folds to its value, a `global` is loaded.
+    auto It = CI.GlobalValues.find(Name);
+    if (It == CI.GlobalValues.end())
+      return LogErrorV(CI, "(Var) Unknown variable name");
+
+    llvm::GlobalVariable* GV = It->second;
+    Unsigned                 = CI.UnsignedValues.contains(GV);
+    IsGlobal                 = !GV->isConstant();
+    CI.fileCoords.UpdateCodegenCoords();
+    if (GV->isConstant())
+      return GV->getInitializer();
+    return CI.Builder->CreateLoad(GV->getValueType(), GV, Name.c_str());
+  }
 
   // Use stored type or infer from alloca
   Type* loadType = VarType ? VarType : V->getAllocatedType();
+  Unsigned       = CI.UnsignedValues.contains(V);
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return CI.Builder->CreateLoad(loadType, V, Name.c_str());
+}
 
-  Global::UpdateCodegenCoords();
+inline auto VariableExpr::codegenAddress(CompilerInstance& CI) -> Address
+{
+  auto It = CI.NamedValues.find(Name);
+  if (It == CI.NamedValues.end() || !It->second)
+  {
+    if (auto SI = CI.SharedLocals.find(Name); SI != CI.SharedLocals.end())
+    {
+      Unsigned = CI.UnsignedValues.contains(SI->second.Ptr);
+      return SI->second;
+    }
 
-  return Builder->CreateLoad(loadType, V, Name.c_str());
+    auto GI = CI.GlobalValues.find(Name);
+    if (GI == CI.GlobalValues.end())
+      return {};
+    Unsigned = CI.UnsignedValues.contains(GI->second);
+    IsGlobal = !GI->second->isConstant();
+    return {GI->second, GI->second->getValueType()};
+  }
+  Unsigned = CI.UnsignedValues.contains(It->second);
+  return {It->second, It->second->getAllocatedType()};
 }
 
-inline auto UnaryExpr::codegen() -> Value*
+inline auto UnaryExpr::codegen(CompilerInstance& CI) -> Value*
 {
-  Value* OperandV = Operand->codegen();
+  Value* OperandV = Operand->codegen(CI);
   if (!OperandV)
     return nullptr;
 
-  llvm::Function* F = getFunction(std::string(__MARE_UNARY_FUNC_DECL__) + Opcode);
+  CI.fileCoords.UpdateCodegenCoords();
+
+  llvm::Function* F = getFunction(CI, std::string(__MARE_UNARY_FUNC_DECL__) + Opcode);
+
+  // `~x` flips every bit, unless the program defines its own `unary~`.
+  if (!F && Opcode == '~')
+  {
+    if (!OperandV->getType()->isIntOrIntVectorTy())
+      return LogErrorV(CI, "'~' expects an integer operand");
+    Unsigned = Operand->isUnsigned();
+    return CI.Builder->CreateNot(OperandV, "nottmp");
+  }
+
+  // `!x` is true when x is zero, unless the program defines its own `unary!`.
+  if (!F && Opcode == '!')
+  {
+    Value* CondV = CreateCondition(CI, OperandV, "cond");
+    if (!CondV)
+      return LogErrorV(CI, "'!' expects a number or a comparison");
+    return CI.Builder->CreateNot(CondV, "lnottmp");
+  }
+
   if (!F)
-    return LogErrorV("Unknown unary operator found during codegen!");
+    return LogErrorV(CI, "Unknown unary operator found during codegen!");
+
+  CallsOperator = true;
+  return CI.Builder->CreateCall(F, OperandV, "unop");
+}
+
+/// EmitShortCircuit - `a && b` / `a || b` as branches meeting in an i1 PHI. The
+/// right operand only runs if the left one does not decide the result.
+static auto EmitShortCircuit(CompilerInstance& CI, bool IsAnd, Expr& LHS, Expr& RHS) -> Value*
+{
+  const char* Scalar = "'&&' and '||' expect scalar conditions; use '&' or '|' on vector masks";
+
+  Value* L = LHS.codegen(CI);
+  if (!L)
+    return nullptr;
+  if (!(L = CreateCondition(CI, L, "lhscond")))
+    return LogErrorV(CI, Scalar);
 
-  Global::UpdateCodegenCoords();
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+  BasicBlock*     LhsBB       = CI.Builder->GetInsertBlock();
+  BasicBlock* RhsBB = BasicBlock::Create(*CI.TheContext, IsAnd ? "and.rhs" : "or.rhs", TheFunction);
+  BasicBlock* EndBB = BasicBlock::Create(*CI.TheContext, IsAnd ? "and.end" : "or.end");
 
-  return Builder->CreateCall(F, OperandV, "unop");
+  if (IsAnd)
+    CI.Builder->CreateCondBr(L, RhsBB, EndBB);
+  else
+    CI.Builder->CreateCondBr(L, EndBB, RhsBB);
+
+  CI.Builder->SetInsertPoint(RhsBB);
+  Value* R = RHS.codegen(CI);
+  if (!R)
+    return nullptr;
+  if (!(R = CreateCondition(CI, R, "rhscond")))
+    return LogErrorV(CI, Scalar);
+  // Codegen of the right operand can change the current block.
+  RhsBB = CI.Builder->GetInsertBlock();
+  CI.Builder->CreateBr(EndBB);
+
+  TheFunction->insert(TheFunction->end(), EndBB);
+  CI.Builder->SetInsertPoint(EndBB);
+  CI.fileCoords.UpdateCodegenCoords();
+
+  PHINode* PN = CI.Builder->CreatePHI(MARE_INT1_TYPE, 2, IsAnd ? "andtmp" : "ortmp");
+  PN->addIncoming(CI.Builder->getInt1(!IsAnd), LhsBB);
+  PN->addIncoming(R, RhsBB);
+  return PN;
 }
 
-inline auto BinaryExpr::codegen() -> llvm::Value*
+/// IsComparison - Whether Op yields an i1 (or a mask of them).
+inline auto IsComparison(Token__ Op) -> bool
 {
+  return Op == '<' || Op == '>' || Op == tok_le || Op == tok_ge || Op == tok_eq || Op == tok_ne;
+}
+
+inline auto BinaryExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  // Handle element and field assignment
+  if (Op == '=' && (dynamic_cast<IndexExpr*>(LHS.get()) || dynamic_cast<MemberExpr*>(LHS.get())))
+  {
+    llvm::Value* Val = RHS->codegen(CI);
+    if (!Val)
+      return nullptr;
+
+    Address Dest = LHS->codegenAddress(CI);
+    if (!Dest)
+      return nullptr;
+    if (IsConstantStorage(Dest.Ptr))
+      return LogErrorV(CI, "Cannot assign to an element of a 'const'");
+
+    if (Val->getType() != Dest.Ty &&
+        !(Val = promoteValue(CI, Val, Val->getType(), Dest.Ty, RHS->isUnsigned())))
+      return nullptr;
+    Unsigned = LHS->isUnsigned();
+
+    StoreAddress(CI, Dest, Val);
+    CI.fileCoords.UpdateCodegenCoords();
+    return Val;
+  }
+
   // Handle assignment
   if (Op == '=')
   {
     auto* LHSE = dynamic_cast<VariableExpr*>(LHS.get());
     if (!LHSE)
-      return LogErrorV("destination of '=' must be a variable");
+      return LogErrorV(CI, "destination of '=' must be a variable");
 
-    llvm::Value* Val = RHS->codegen();
+    llvm::Value* Val = RHS->codegen(CI);
     if (!Val)
       return nullptr;
 
-    llvm::Value* Variable = NamedValues[LHSE->getName()];
+    llvm::Value* Variable = CI.NamedValues[LHSE->getName()];
+    if (auto SI = CI.SharedLocals.find(LHSE->getName()); !Variable && SI != CI.SharedLocals.end())
+      Variable = SI->second.Ptr;
     if (!Variable)
-      return LogErrorV("Unknown variable name");
+    {
+      // A top-level `global` takes values of its own type.
+      Address Global = LHSE->codegenAddress(CI);
+      if (!Global)
+        return LogErrorV(CI, "Unknown variable name");
+      if (IsConstantStorage(Global.Ptr))
+        return LogErrorV(CI, "Cannot assign to a 'const'");
+      if (Val->getType() != Global.Ty &&
+          !(Val = promoteValue(CI, Val, Val->getType(), Global.Ty, RHS->isUnsigned())))
+        return nullptr;
+      Variable = Global.Ptr;
+    }
+    Unsigned = CI.UnsignedValues.contains(Variable);
 
-    Builder->CreateStore(Val, Variable);
-    Global::UpdateCodegenCoords();
+    CI.Builder->CreateStore(Val, Variable);
+    CI.fileCoords.UpdateCodegenCoords();
     return Val;
   }
 
-  llvm::Value* L = LHS->codegen();
-  llvm::Value* R = RHS->codegen();
+  // `&&` and `||` decide whether the right operand runs at all.
+  if (Op == tok_and || Op == tok_or)
+    return EmitShortCircuit(CI, Op == tok_and, *LHS, *RHS);
+
+  llvm::Value* L = LHS->codegen(CI);
+  llvm::Value* R = RHS->codegen(CI);
   if (!L || !R)
     return nullptr;
 
   llvm::Type* LT = L->getType();
   llvm::Type* RT = R->getType();
 
+  // Integers are signless in LLVM: an unsigned operand is zero-extended, and makes
+  // the division, comparison or right shift unsigned. A bool extends to 0 or 1.
+  const bool LU = LHS->isUnsigned();
+  const bool RU = RHS->isUnsigned();
+  const bool LZ = LU || LT->isIntOrIntVectorTy(1);
+  const bool RZ = RU || RT->isIntOrIntVectorTy(1);
+
+  // Vector operators work lane-wise; a scalar operand is broadcast to every lane.
+  if (LT != RT && (LT->isVectorTy() || RT->isVectorTy()))
+  {
+    if (LT->isVectorTy() && RT->isVectorTy())
+      return LogErrorV(CI, "Vector operands of a binary expression must have the same type");
+    if (!(L = splatToVector(CI, L, RT->isVectorTy() ? RT : LT, LZ)) ||
+        !(R = splatToVector(CI, R, L->getType(), RZ)))
+      return nullptr;
+    RT = LT = L->getType();
+  }
+
   // Promote operands to compatible types
   if (LT != RT)
   {
     if (LT->isFloatingPointTy() && RT->isIntegerTy())
     {
-      R  = Builder->CreateSIToFP(R, LT, "cast_rhs");
+      R  = RZ ? CI.Builder->CreateUIToFP(R, LT, "cast_rhs")
+              : CI.Builder->CreateSIToFP(R, LT, "cast_rhs");
       RT = LT;
     }
     else if (RT->isFloatingPointTy() && LT->isIntegerTy())
     {
-      L  = Builder->CreateSIToFP(L, RT, "cast_lhs");
+      L  = LZ ? CI.Builder->CreateUIToFP(L, RT, "cast_lhs")
+              : CI.Builder->CreateSIToFP(L, RT, "cast_lhs");
       LT = RT;
     }
     else if (LT->isIntegerTy() && RT->isIntegerTy())
@@ -119,9 +471,9 @@ inline auto BinaryExpr::codegen() -> llvm::Value*
       unsigned LBits = LT->getIntegerBitWidth();
       unsigned RBits = RT->getIntegerBitWidth();
       if (LBits > RBits)
-        R = Builder->CreateSExt(R, LT, "cast_rhs");
+        R = CI.Builder->CreateIntCast(R, LT, !RZ, "cast_rhs");
       else if (RBits > LBits)
-        L = Builder->CreateSExt(L, RT, "cast_lhs");
+        L = CI.Builder->CreateIntCast(L, RT, !LZ, "cast_lhs");
       // else same bits: nothing needed
     }
     else
@@ -131,183 +483,405 @@ inline auto BinaryExpr::codegen() -> llvm::Value*
       llvm::errs() << " vs ";
       RT->print(llvm::errs());
       llvm::errs() << "\n";
-      return LogErrorV("Type mismatch in binary expression");
+      return LogErrorV(CI, "Type mismatch in binary expression");
     }
   }
 
   // Refresh common type
   LT = L->getType();
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
+
+  // A shift keeps the signedness of the shifted value; comparisons give i1.
+  const bool IsFP  = LT->isFPOrFPVectorTy();
+  const bool Shift = Op == tok_shl || Op == tok_shr;
+  const bool U     = Shift ? LU : LU || RU;
+  Unsigned         = U && !IsComparison(Op);
+
+  // Built with --trap-overflow, integer arithmetic traps instead of wrapping.
+  if (!IsFP && CI.Args.trapOverflow && (Op == '+' || Op == '-' || Op == '*'))
+    return Builtins::EmitTrappingArith(CI, static_cast<char>(Op), L, R, U);
 
   switch (Op)
   {
     case '+':
-      return LT->isFloatingPointTy() ? Builder->CreateFAdd(L, R, "addtmp")
-                                     : Builder->CreateAdd(L, R, "addtmp");
+      return IsFP ? CI.Builder->CreateFAdd(L, R, "addtmp") : CI.Builder->CreateAdd(L, R, "addtmp");
     case '-':
-      return LT->isFloatingPointTy() ? Builder->CreateFSub(L, R, "subtmp")
-                                     : Builder->CreateSub(L, R, "subtmp");
+      return IsFP ? CI.Builder->CreateFSub(L, R, "subtmp") : CI.Builder->CreateSub(L, R, "subtmp");
     case '*':
-      return LT->isFloatingPointTy() ? Builder->CreateFMul(L, R, "multmp")
-                                     : Builder->CreateMul(L, R, "multmp");
+      return IsFP ? CI.Builder->CreateFMul(L, R, "multmp") : CI.Builder->CreateMul(L, R, "multmp");
     case '/':
-      return LT->isFloatingPointTy() ? Builder->CreateFDiv(L, R, "divtmp")
-                                     : Builder->CreateSDiv(L, R, "divtmp");
+      return IsFP ? CI.Builder->CreateFDiv(L, R, "divtmp")
+             : U  ? CI.Builder->CreateUDiv(L, R, "divtmp")
+                  : CI.Builder->CreateSDiv(L, R, "divtmp");
     case '<':
-      return LT->isFloatingPointTy() ? Builder->CreateFCmpULT(L, R, "lt")
-                                     : Builder->CreateICmpSLT(L, R, "lt");
+      return IsFP ? CI.Builder->CreateFCmpULT(L, R, "lt")
+             : U  ? CI.Builder->CreateICmpULT(L, R, "lt")
+                  : CI.Builder->CreateICmpSLT(L, R, "lt");
     case '>':
-      return LT->isFloatingPointTy() ? Builder->CreateFCmpUGT(L, R, "gt")
-                                     : Builder->CreateICmpSGT(L, R, "gt");
+      return IsFP ? CI.Builder->CreateFCmpUGT(L, R, "gt")
+             : U  ? CI.Builder->CreateICmpUGT(L, R, "gt")
+                  : CI.Builder->CreateICmpSGT(L, R, "gt");
+    case tok_le:
+      return IsFP ? CI.Builder->CreateFCmpULE(L, R, "le")
+             : U  ? CI.Builder->CreateICmpULE(L, R, "le")
+                  : CI.Builder->CreateICmpSLE(L, R, "le");
+    case tok_ge:
+      return IsFP ? CI.Builder->CreateFCmpUGE(L, R, "ge")
+             : U  ? CI.Builder->CreateICmpUGE(L, R, "ge")
+                  : CI.Builder->CreateICmpSGE(L, R, "ge");
+    case tok_eq:
+      return IsFP ? CI.Builder->CreateFCmpOEQ(L, R, "eq") : CI.Builder->CreateICmpEQ(L, R, "eq");
+    case tok_ne:
+      return IsFP ? CI.Builder->CreateFCmpUNE(L, R, "ne") : CI.Builder->CreateICmpNE(L, R, "ne");
+    case '&':
+    case '|':
+    case '^':
+      // A user-defined `binary&` (`|`, `^`) shadows the builtin operator.
+      if (getFunction(CI, __MARE_BINARY_FUNC_DECL__ + std::string(1, static_cast<char>(Op))))
+        break;
+      if (IsFP)
+        return LogErrorV(CI, "Bitwise operators expect integer operands");
+      return Op == '&'   ? CI.Builder->CreateAnd(L, R, "andtmp")
+             : Op == '|' ? CI.Builder->CreateOr(L, R, "ortmp")
+                         : CI.Builder->CreateXor(L, R, "xortmp");
+    case tok_shl:
+    case tok_shr:
+      if (IsFP)
+        return LogErrorV(CI, "Shifts expect integer operands");
+      return Op == tok_shl ? CI.Builder->CreateShl(L, R, "shltmp")
+             : U           ? CI.Builder->CreateLShr(L, R, "shrtmp")
+                           : CI.Builder->CreateAShr(L, R, "shrtmp");
     default:
       break;
   }
 
   // User-defined operator fallback
   std::string FnName = __MARE_BINARY_FUNC_DECL__;
-  FnName += Op;
-  if (llvm::Function* F = getFunction(FnName))
-    return Builder->CreateCall(F, {L, R}, "binop");
+  FnName += static_cast<char>(Op);
+  if (llvm::Function* F = getFunction(CI, FnName))
+  {
+    Unsigned      = CI.UnsignedValues.contains(F);
+    CallsOperator = true;
+    return CI.Builder->CreateCall(F, {L, R}, "binop");
+  }
+
+  llvm::errs() << "[codegen] Unknown binary operator '" << static_cast<char>(Op) << "'\n";
+  return LogErrorV(CI, "Unknown binary operator");
+}
+
+/// codegenArgument - A fixed-size array variable passed for a `[T]` parameter is
+/// lent to the callee as a slice over its own storage.
+static auto codegenArgument(CompilerInstance& CI, Expr& Arg, llvm::Type* ParamTy) -> llvm::Value*
+{
+  llvm::Type* Elem = Types::SliceElementType(CI, ParamTy);
+  if (!Elem)
+    return Arg.codegen(CI);
+
+  Address A = Arg.codegenAddress(CI);
+  if (!A)
+    return Arg.codegen(CI);
 
-  llvm::errs() << "[codegen] Unknown binary operator '" << Op << "'\n";
-  return LogErrorV("Unknown binary operator");
+  auto* AT = llvm::dyn_cast<llvm::ArrayType>(A.Ty);
+  if (!AT || AT->getElementType() != Elem)
+    return LoadAddress(CI, A);
+
+  // Fixed-size arrays always store whole structs.
+  if (Types::IsSoAType(CI, Elem))
+    return LogErrorV(CI, "An array of a '@layout(soa)' struct cannot be passed as a slice; "
+                         "allocate it with 'new'");
+
+  return MakeSlice(CI, ParamTy, A.Ptr, ConstantInt::get(MARE_INT64_TYPE, AT->getNumElements()));
 }
 
-inline auto CallExpr::codegen() -> Value*
+inline auto CallExpr::codegen(CompilerInstance& CI) -> Value*
 {
   // Look up the name in the global module table.
-  llvm::Function*   CalleeF = getFunction(Callee);
+  llvm::Function*   CalleeF = getFunction(CI, Callee);
   const std::string errMsg  = "Unknown function referenced: " + Callee;
   if (!CalleeF)
-    return LogErrorV(errMsg.c_str());
+  {
+    // Not a declared function: try the builtins, which are emitted inline.
+    const Builtins::Builtin* B = Builtins::Find(Callee);
+    if (!B)
+      return LogErrorV(CI, errMsg.c_str());
+    if (Args.size() < B->MinArgs || Args.size() > B->MaxArgs)
+      return LogErrorV(CI, "Incorrect # arguments passed");
+
+    // Memory builtins work on the storage their first argument names.
+    Address Target;
+    if (B->EmitAt && !(Target = Args.front()->codegenAddress(CI)))
+      return LogErrorV(CI, "Memory builtins expect a variable, element or field first");
+    Unsigned = B->EmitAt && Args.front()->isUnsigned();
+
+    std::vector<Value*> ArgsV;
+    std::vector<bool>   ArgsUnsigned;
+    for (size_t i = B->EmitAt ? 1 : 0; i != Args.size(); ++i)
+    {
+      if (!ArgsV.emplace_back(Args[i]->codegen(CI)))
+        return nullptr;
+      ArgsUnsigned.push_back(Args[i]->isUnsigned());
+      Unsigned |= Args[i]->isUnsigned();
+    }
+
+    IsBuiltin            = true;
+    StoresThroughPointer = B->WritesTarget && Args.front()->isThroughPointer();
+    BuiltinEffects       = B->Effects;
+    CI.fileCoords.UpdateCodegenCoords();
+    if (B->EmitArgs)
+      return B->EmitArgs(CI, ArgsV, ArgsUnsigned);
+    return B->EmitAt ? B->EmitAt(CI, Target, ArgsV, Unsigned) : B->Emit(CI, ArgsV, Unsigned);
+  }
 
   // If argument mismatch error.
   if (CalleeF->arg_size() != Args.size())
-    return LogErrorV("Incorrect # arguments passed");
+    return LogErrorV(CI, "Incorrect # arguments passed");
 
   std::vector<Value*> ArgsV;
-  for (const auto& Arg : Args)
+  for (unsigned i = 0; i != Args.size(); ++i)
   {
-    ArgsV.push_back(Arg->codegen());
+    ArgsV.push_back(codegenArgument(CI, *Args[i], CalleeF->getFunctionType()->getParamType(i)));
     if (!ArgsV.back())
       return nullptr;
   }
 
-  Global::UpdateCodegenCoords();
+  Unsigned = CI.UnsignedValues.contains(CalleeF);
+
+  CI.fileCoords.UpdateCodegenCoords();
   // If the function returns void, don't create a named call.
   if (CalleeF->getReturnType()->isVoidTy())
   {
-    return Builder->CreateCall(CalleeF, ArgsV);
+    return CI.Builder->CreateCall(CalleeF, ArgsV);
+  }
+
+  return CI.Builder->CreateCall(CalleeF, ArgsV, "calltmp");
+}
+
+/// GetSpawnEntry - `F.spawn(env)`, the entry point of a thread running F. It
+/// loads the arguments from the block env, frees it, and returns the result of
+/// F widened to an i64.
+static auto GetSpawnEntry(CompilerInstance& CI, llvm::Function* F, llvm::StructType* EnvTy)
+  -> llvm::Function*
+{
+  const std::string Name = F->getName().str() + __MARE_SPAWN_SUFFIX__;
+  if (llvm::Function* Entry = CI.TheModule->getFunction(Name))
+    return Entry;
+
+  auto* FT    = llvm::FunctionType::get(MARE_INT64_TYPE, {MARE_PTR_TYPE}, false);
+  auto* Entry = llvm::Function::Create(FT, llvm::Function::InternalLinkage, Name, *CI.TheModule);
+
+  llvm::IRBuilderBase::InsertPointGuard Guard(*CI.Builder);
+  CI.Builder->SetInsertPoint(BasicBlock::Create(*CI.TheContext, "entry", Entry));
+
+  llvm::Value*              Env = Entry->getArg(0);
+  std::vector<llvm::Value*> Args;
+  for (unsigned i = 0; i != EnvTy->getNumElements(); ++i)
+    Args.push_back(CI.Builder->CreateLoad(EnvTy->getElementType(i),
+                                          CI.Builder->CreateStructGEP(EnvTy, Env, i)));
+  CI.Builder->CreateCall(GetFreeFunction(CI), {Env});
+
+  llvm::Value* Result = CI.Builder->CreateCall(F, Args);
+  if (F->getReturnType()->isVoidTy())
+    Result = CI.Builder->getInt64(0);
+  else
+    Result = CI.Builder->CreateIntCast(Result, MARE_INT64_TYPE, !CI.UnsignedValues.contains(F));
+  CI.Builder->CreateRet(Result);
+  return Entry;
+}
+
+inline auto SpawnExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  const std::string& Callee = Call->getCallee();
+  const auto&        Args   = Call->getArgs();
+
+  llvm::Function* F = getFunction(CI, Callee);
+  if (!F)
+    return LogErrorV(CI, ("'spawn' needs a declared function: " + Callee).c_str());
+  if (!F->getReturnType()->isVoidTy() && !F->getReturnType()->isIntegerTy())
+    return LogErrorV(CI, "'spawn' needs a function returning an integer or nothing");
+  if (F->arg_size() != Args.size())
+    return LogErrorV(CI, "Incorrect # arguments passed");
+
+  // The arguments are evaluated here and handed over in a block of their own.
+  std::vector<llvm::Type*> ParamTys(F->getFunctionType()->param_begin(),
+                                    F->getFunctionType()->param_end());
+  llvm::StructType*        EnvTy = llvm::StructType::get(*CI.TheContext, ParamTys);
+
+  // The module has no DataLayout yet; sizeof folds once the target is known.
+  llvm::Value* Env = CI.Builder->CreateCall(
+    GetAllocFunction(CI), {llvm::ConstantExpr::getSizeOf(EnvTy)}, "spawn.env");
+  for (unsigned i = 0; i != Args.size(); ++i)
+  {
+    llvm::Value* V = codegenArgument(CI, *Args[i], ParamTys[i]);
+    V = convertValue(CI, V, Args[i]->isUnsigned(), ParamTys[i],
+                     CI.UnsignedValues.contains(F->getArg(i)));
+    if (!V)
+      return nullptr;
+    CI.Builder->CreateStore(V, CI.Builder->CreateStructGEP(EnvTy, Env, i));
+  }
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return CI.Builder->CreateCall(Threads::GetSpawnFunction(CI),
+                                {GetSpawnEntry(CI, F, EnvTy), Env}, "thread");
+}
+
+inline auto AsmExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  std::string Constraints;
+  auto        Append = [&](const std::string& C)
+  {
+    if (!Constraints.empty())
+      Constraints += ',';
+    Constraints += C;
+  };
+
+  for (const auto& Out : Outputs)
+    Append(Out);
+
+  // Indirect operands pass an address and name the type behind it.
+  std::vector<llvm::Value*>                     Args;
+  std::vector<std::pair<unsigned, llvm::Type*>> Indirect;
+  for (const auto& In : Inputs)
+  {
+    llvm::Value* V = nullptr;
+    if (In.isIndirect())
+    {
+      Address A = In.Value->codegenAddress(CI);
+      if (!A)
+        return LogErrorV(CI, "An indirect 'asm' input needs a variable, an element or a field");
+      if ((V = Builtins::SingleAddress(CI, A, "asm")))
+        Indirect.push_back({Args.size(), A.Ty});
+    }
+    else
+      V = In.Value->codegen(CI);
+    if (!V)
+      return nullptr;
+
+    Args.push_back(V);
+    Append(In.Constraint);
+  }
+
+  for (const auto& C : Clobbers)
+    Append(C.starts_with('~') ? C : "~{" + C + "}");
+
+  std::vector<llvm::Type*> ArgTys;
+  for (llvm::Value* V : Args)
+    ArgTys.push_back(V->getType());
+  auto* FT = llvm::FunctionType::get(ResultType, ArgTys, false);
+
+  if (llvm::Error E = llvm::InlineAsm::verify(FT, Constraints))
+  {
+    const std::string errMsg = "Invalid 'asm' constraints \"" + Constraints +
+                               "\": " + llvm::toString(std::move(E));
+    return LogErrorV(CI, errMsg.c_str());
   }
 
-  return Builder->CreateCall(CalleeF, ArgsV, "calltmp");
+  const auto Dialect = findAttribute(Attrs, "intel") ? llvm::InlineAsm::AD_Intel
+                                                     : llvm::InlineAsm::AD_ATT;
+  auto* IA   = llvm::InlineAsm::get(FT, Template, Constraints, hasSideEffects(),
+                                    /*isAlignStack=*/false, Dialect);
+  auto* Call = CI.Builder->CreateCall(FT, IA, Args);
+  for (const auto& [ArgNo, Ty] : Indirect)
+    Call->addParamAttr(ArgNo,
+                       llvm::Attribute::get(*CI.TheContext, llvm::Attribute::ElementType, Ty));
+
+  // Like a pure function, a block without side effects can be merged or hoisted.
+  Call->setDoesNotThrow();
+  if (!hasSideEffects())
+    Call->setDoesNotAccessMemory();
+
+  CI.fileCoords.UpdateCodegenCoords();
+  if (ResultType->isVoidTy())
+    return Constant::getNullValue(MARE_INT64_TYPE);
+  return Call;
 }
 
-inline auto StringExpr::codegen() -> llvm::Value*
+inline auto StringExpr::codegen(CompilerInstance& CI) -> llvm::Value*
 {
   // Create a global string constant
-  llvm::Value* Str = llvm::ConstantDataArray::getString(*TheContext, Val, true);
+  llvm::Value* Str = llvm::ConstantDataArray::getString(*CI.TheContext, Val, true);
   auto*        GV =
-    new llvm::GlobalVariable(*TheModule, Str->getType(), true, llvm::GlobalValue::PrivateLinkage,
+    new llvm::GlobalVariable(*CI.TheModule, Str->getType(), true, llvm::GlobalValue::PrivateLinkage,
                              llvm::cast<llvm::Constant>(Str), ".str");
 
   // Generate GEP to get pointer to the string data
   llvm::Value* Zero      = llvm::ConstantInt::get(MARE_INT32_TYPE, 0);
-  llvm::Value* StringPtr = Builder->CreateGEP(GV->getValueType(), GV, {Zero, Zero}, "strptr");
+  llvm::Value* StringPtr = CI.Builder->CreateGEP(GV->getValueType(), GV, {Zero, Zero}, "strptr");
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   // Return the string pointer directly
   return StringPtr;
 }
 
-inline auto IfExpr::codegen() -> Value*
+inline auto IfExpr::codegen(CompilerInstance& CI) -> Value*
 {
-  Value* CondV = Cond->codegen();
+  Value* CondV = Cond->codegen(CI);
   if (!CondV)
     return nullptr;
 
   // Convert condition to a bool by comparing to zero
-  // Handle different types for the condition
-  Value* ZeroValue = nullptr;
-  Type*  CondType  = CondV->getType();
-
-  if (CondType->isIntegerTy())
-  {
-    ZeroValue = ConstantInt::get(CondType, 0);
-    CondV     = Builder->CreateICmpNE(CondV, ZeroValue, "ifcond");
-  }
-  else if (CondType->isFloatTy())
-  {
-    ZeroValue = ConstantFP::get(CondType, 0.0f);
-    CondV     = Builder->CreateFCmpONE(CondV, ZeroValue, "ifcond");
-  }
-  else if (CondType->isDoubleTy())
-  {
-    ZeroValue = ConstantFP::get(CondType, 0.0);
-    CondV     = Builder->CreateFCmpONE(CondV, ZeroValue, "ifcond");
-  }
-  else
+  CondV = CreateCondition(CI, CondV, "ifcond");
+  if (!CondV)
   {
-    LogErrorV("Unsupported condition type in 'if' expression");
+    LogErrorV(CI, "Unsupported condition type in 'if' expression");
     return nullptr;
   }
 
-  llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
 
   // Create blocks for the then and else cases.  Insert the 'then' block at the
   // end of the function.
-  BasicBlock* ThenBB  = BasicBlock::Create(*TheContext, "then", TheFunction);
-  BasicBlock* ElseBB  = BasicBlock::Create(*TheContext, "else");
-  BasicBlock* MergeBB = BasicBlock::Create(*TheContext, "ifcont");
+  BasicBlock* ThenBB  = BasicBlock::Create(*CI.TheContext, "then", TheFunction);
+  BasicBlock* ElseBB  = BasicBlock::Create(*CI.TheContext, "else");
+  BasicBlock* MergeBB = BasicBlock::Create(*CI.TheContext, "ifcont");
 
-  Builder->CreateCondBr(CondV, ThenBB, ElseBB);
+  CI.Builder->CreateCondBr(CondV, ThenBB, ElseBB);
 
   // Emit then value.
-  Builder->SetInsertPoint(ThenBB);
-  Value* ThenV = Then->codegen();
+  CI.Builder->SetInsertPoint(ThenBB);
+  Value* ThenV = Then->codegen(CI);
   if (!ThenV)
     return nullptr;
-  Builder->CreateBr(MergeBB);
   // Codegen of 'Then' can change the current block, update ThenBB for the PHI.
-  ThenBB = Builder->GetInsertBlock();
+  ThenBB = CI.Builder->GetInsertBlock();
 
   // Emit else block.
   TheFunction->insert(TheFunction->end(), ElseBB);
-  Builder->SetInsertPoint(ElseBB);
-  Value* ElseV = Else->codegen();
+  CI.Builder->SetInsertPoint(ElseBB);
+  Value* ElseV = Else->codegen(CI);
   if (!ElseV)
     return nullptr;
-  Builder->CreateBr(MergeBB);
   // Codegen of 'Else' can change the current block, update ElseBB for the PHI.
-  ElseBB = Builder->GetInsertBlock();
+  ElseBB = CI.Builder->GetInsertBlock();
 
-  // Emit merge block.
-  TheFunction->insert(TheFunction->end(), MergeBB);
-  Builder->SetInsertPoint(MergeBB);
+  // A branch ending in `ret`, `break` or `continue` never reaches the merge block.
+  const bool ThenFalls = !ThenBB->getTerminator();
+  const bool ElseFalls = !ElseBB->getTerminator();
 
   Type* ThenType = ThenV->getType();
   Type* ElseType = ElseV->getType();
 
-  // Handle type promotion/conversion for different ValueVariant types
-  if (ThenType != ElseType)
+  // Handle type promotion/conversion for different ValueVariant types. The
+  // conversions go at the end of each branch, ahead of the PHI.
+  if (ThenFalls && ElseFalls && ThenType != ElseType)
   {
     // Try to find a common type and promote both values
     Type* CommonType = getCommonType(ThenType, ElseType);
     if (!CommonType)
     {
-      LogErrorV("Cannot find common type for 'if' expression branches");
+      LogErrorV(CI, "Cannot find common type for 'if' expression branches");
       return nullptr;
     }
 
     // Promote ThenV to common type if needed
     if (ThenType != CommonType)
     {
-      ThenV = promoteValue(ThenV, ThenType, CommonType);
+      CI.Builder->SetInsertPoint(ThenBB);
+      ThenV = promoteValue(CI, ThenV, ThenType, CommonType, Then->isUnsigned());
       if (!ThenV)
       {
-        LogErrorV("Failed to promote 'then' branch value");
+        LogErrorV(CI, "Failed to promote 'then' branch value");
         return nullptr;
       }
     }
@@ -315,10 +889,11 @@ inline auto IfExpr::codegen() -> Value*
     // Promote ElseV to common type if needed
     if (ElseType != CommonType)
     {
-      ElseV = promoteValue(ElseV, ElseType, CommonType);
+      CI.Builder->SetInsertPoint(ElseBB);
+      ElseV = promoteValue(CI, ElseV, ElseType, CommonType, Else->isUnsigned());
       if (!ElseV)
       {
-        LogErrorV("Failed to promote 'else' branch value");
+        LogErrorV(CI, "Failed to promote 'else' branch value");
         return nullptr;
       }
     }
@@ -326,15 +901,240 @@ inline auto IfExpr::codegen() -> Value*
     ThenType = CommonType;
   }
 
+  for (BasicBlock* BB : {ThenBB, ElseBB})
+  {
+    if (BB->getTerminator())
+      continue;
+    CI.Builder->SetInsertPoint(BB);
+    CI.Builder->CreateBr(MergeBB);
+  }
+
+  // Emit merge block.
+  TheFunction->insert(TheFunction->end(), MergeBB);
+  CI.Builder->SetInsertPoint(MergeBB);
+
+  Unsigned = Then->isUnsigned() || Else->isUnsigned();
+  CI.fileCoords.UpdateCodegenCoords();
+
+  // With one incoming branch there is nothing to merge; with none, code after
+  // the `if` is dead.
+  if (!ThenFalls && !ElseFalls)
+    CI.Builder->CreateUnreachable();
+  if (!ThenFalls || !ElseFalls)
+    return ThenFalls ? ThenV : ElseV;
+
   llvm::errs() << "\n>>> Creating PHI with types: " << *ThenV->getType() << " and "
                << *ElseV->getType() << "\n";
 
-  PHINode* PN = Builder->CreatePHI(ThenType, 2, "iftmp");
+  PHINode* PN = CI.Builder->CreatePHI(ThenType, 2, "iftmp");
   PN->addIncoming(ThenV, ThenBB);
   PN->addIncoming(ElseV, ElseBB);
 
-  Global::UpdateCodegenCoords();
+  return PN;
+}
+
+/// MatchPatternValue - Pattern P as a constant of the scrutinee's type T.
+static auto MatchPatternValue(CompilerInstance& CI, Expr& P, llvm::IntegerType* T, bool U)
+  -> ConstantInt*
+{
+  Value* V = P.codegen(CI);
+  if (!V)
+    return nullptr;
+
+  auto* C = dyn_cast<ConstantInt>(V);
+  if (!C)
+    return LogErrorV(CI, "'match' patterns must be integer constants"), nullptr;
+
+  // A wider pattern has to fit the scrutinee, or it could never match.
+  const llvm::APInt& Val  = C->getValue();
+  const bool         PatU = P.isUnsigned();
+  const unsigned     Bits = T->getBitWidth();
+  const bool         Fits = U ? (PatU || !Val.isNegative()) && Val.isIntN(Bits)
+                              : (PatU ? Val.isIntN(Bits - 1) : Val.isSignedIntN(Bits));
+  if (!Fits)
+    return LogErrorV(CI, "'match' pattern is out of range for the matched value"), nullptr;
+
+  return ConstantInt::get(*CI.TheContext,
+                          PatU || U ? Val.zextOrTrunc(Bits) : Val.sextOrTrunc(Bits));
+}
+
+// Output match as a switch, with each arm in its own block:
+//   switch x, match.default [0 -> arm0, 1 -> arm1, 2 -> arm1, ...]
+// match.default:            ; ranges too wide to list as cases
+//   br x - lo <u hi - lo, armN, next
+//   ...
+//   goto arm_ (or match.none, which yields zero)
+// armK:
+//   value = bodyK
+//   goto match.end
+// match.end:
+//   phi [value0, arm0], [value1, arm1], ...
+inline auto MatchExpr::codegen(CompilerInstance& CI) -> Value*
+{
+  // Ranges up to this size become switch cases; wider ones are tested in order.
+  constexpr u64 MaxCasesPerRange = 256;
+
+  Value* V = Scrutinee->codegen(CI);
+  if (!V)
+    return nullptr;
+  auto* T = dyn_cast<llvm::IntegerType>(V->getType());
+  if (!T)
+    return LogErrorV(CI, "'match' expects an integer value");
+  const bool U = Scrutinee->isUnsigned() || T->getBitWidth() == 1;
+
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+  BasicBlock*     DefaultBB   = BasicBlock::Create(*CI.TheContext, "match.default");
+  BasicBlock*     EndBB       = BasicBlock::Create(*CI.TheContext, "match.end");
+  BasicBlock*     FallbackBB  = nullptr; // The `_` arm
+  auto*           Switch      = CI.Builder->CreateSwitch(V, DefaultBB);
+
+  struct WideRange
+  {
+    ConstantInt* Lo;
+    llvm::APInt  Count;
+    BasicBlock*  Target;
+  };
+  std::vector<WideRange>   WideRanges;
+  std::vector<BasicBlock*> ArmBBs;
+
+  // The first arm naming a value wins; later ones cannot be reached for it. Cases
+  // are tested before the wide ranges, so a value an earlier wide range covers
+  // must not become a case.
+  auto AddCase = [&](const llvm::APInt& Val, BasicBlock* Target)
+  {
+    for (const auto& R : WideRanges)
+      if ((Val - R.Lo->getValue()).ult(R.Count))
+        return;
+
+    ConstantInt* C = ConstantInt::get(*CI.TheContext, Val);
+    if (Switch->findCaseValue(C) == Switch->case_default())
+      Switch->addCase(C, Target);
+  };
+
+  for (auto& Arm : Arms)
+  {
+    BasicBlock* ArmBB = ArmBBs.emplace_back(BasicBlock::Create(*CI.TheContext, "match.arm"));
+    if (Arm.Patterns.empty())
+    {
+      if (FallbackBB)
+        return LogErrorV(CI, "A 'match' can only have one '_' arm");
+      FallbackBB = ArmBB;
+    }
+
+    for (auto& P : Arm.Patterns)
+    {
+      ConstantInt* Lo = MatchPatternValue(CI, *P.Lo, T, U);
+      if (!Lo)
+        return nullptr;
+      if (!P.Hi)
+      {
+        AddCase(Lo->getValue(), ArmBB);
+        continue;
+      }
+
+      ConstantInt* Hi = MatchPatternValue(CI, *P.Hi, T, U);
+      if (!Hi)
+        return nullptr;
+      const llvm::APInt& LoVal = Lo->getValue();
+      const llvm::APInt& HiVal = Hi->getValue();
+      if (U ? HiVal.ule(LoVal) : HiVal.sle(LoVal))
+      {
+        LogWarning(CI, "Empty range in 'match' pattern never matches");
+        continue;
+      }
+
+      const llvm::APInt Count = HiVal - LoVal;
+      if (Count.ugt(MaxCasesPerRange))
+      {
+        WideRanges.push_back({Lo, Count, ArmBB});
+        continue;
+      }
+      for (llvm::APInt Val = LoVal; Val != HiVal; ++Val)
+        AddCase(Val, ArmBB);
+    }
+  }
+
+  // Values that are not a case: wide ranges, then the `_` arm.
+  TheFunction->insert(TheFunction->end(), DefaultBB);
+  CI.Builder->SetInsertPoint(DefaultBB);
+  for (const auto& R : WideRanges)
+  {
+    BasicBlock* NextBB = BasicBlock::Create(*CI.TheContext, "match.range", TheFunction);
+    Value*      Off    = CI.Builder->CreateSub(V, R.Lo, "off");
+    CI.Builder->CreateCondBr(
+      CI.Builder->CreateICmpULT(Off, ConstantInt::get(T, R.Count), "inrange"), R.Target, NextBB);
+    CI.Builder->SetInsertPoint(NextBB);
+  }
+  BasicBlock* NoneBB = nullptr;
+  if (!FallbackBB)
+    FallbackBB = NoneBB = CI.Builder->GetInsertBlock();
+  else
+    CI.Builder->CreateBr(FallbackBB);
+
+  // Emit the arms; each one that falls through brings a value to the PHI.
+  struct Incoming
+  {
+    Value*      Val;
+    BasicBlock* BB;
+    Expr*       Body;
+  };
+  std::vector<Incoming> Results;
+  for (size_t i = 0; i != Arms.size(); ++i)
+  {
+    BasicBlock* ArmBB = ArmBBs[i];
+    TheFunction->insert(TheFunction->end(), ArmBB);
+    CI.Builder->SetInsertPoint(ArmBB);
+    Value* ArmV = Arms[i].Body->codegen(CI);
+    if (!ArmV)
+      return nullptr;
+    if (!CI.Builder->GetInsertBlock()->getTerminator())
+      Results.push_back({ArmV, CI.Builder->GetInsertBlock(), Arms[i].Body.get()});
+  }
+
+  // The arms agree on the widest of their types; statements (void) give no value.
+  Type* ResultType = Results.empty() ? nullptr : Results.front().Val->getType();
+  for (const auto& R : Results)
+  {
+    if (R.Val->getType()->isVoidTy() || ResultType->isVoidTy())
+      ResultType = MARE_VOID_TYPE;
+    else if (!(ResultType = getCommonType(ResultType, R.Val->getType())))
+      return LogErrorV(CI, "Cannot find common type for 'match' arms");
+  }
+
+  for (auto& R : Results)
+  {
+    CI.Builder->SetInsertPoint(R.BB);
+    if (!ResultType->isVoidTy() && R.Val->getType() != ResultType &&
+        !(R.Val = promoteValue(CI, R.Val, R.Val->getType(), ResultType, R.Body->isUnsigned())))
+      return nullptr;
+    CI.Builder->CreateBr(EndBB);
+    Unsigned |= R.Body->isUnsigned();
+  }
+  if (NoneBB)
+  {
+    CI.Builder->SetInsertPoint(NoneBB);
+    CI.Builder->CreateBr(EndBB);
+  }
 
+  TheFunction->insert(TheFunction->end(), EndBB);
+  CI.Builder->SetInsertPoint(EndBB);
+  CI.fileCoords.UpdateCodegenCoords();
+
+  // With no arm reaching the end, code after the `match` is dead.
+  if (!ResultType)
+  {
+    if (!NoneBB)
+      CI.Builder->CreateUnreachable();
+    return ConstantFP::get(MARE_DOUBLE_TYPE, 0.0);
+  }
+  if (ResultType->isVoidTy())
+    return ConstantFP::get(MARE_DOUBLE_TYPE, 0.0);
+
+  PHINode* PN = CI.Builder->CreatePHI(ResultType, Results.size() + (NoneBB != nullptr), "match");
+  for (const auto& R : Results)
+    PN->addIncoming(R.Val, R.BB);
+  if (NoneBB)
+    PN->addIncoming(Constant::getNullValue(ResultType), NoneBB);
   return PN;
 }
 
@@ -346,7 +1146,7 @@ inline auto IfExpr::codegen() -> Value*
 //   goto loop
 // loop:
 //   ...
-//   bodyexpr
+//   bodyexpr        ; `continue` -> loopend, `break` -> afterloop
 //   ...
 // loopend:
 //   step = stepexpr
@@ -357,12 +1157,12 @@ inline auto IfExpr::codegen() -> Value*
 //   store nextvar -> var
 //   br endcond, loop, endloop
 // outloop:
-inline auto ForExpr::codegen() -> Value*
+inline auto ForExpr::codegen(CompilerInstance& CI) -> Value*
 {
-  llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
 
   // Emit the start code first to determine the loop variable type
-  Value* StartVal = Start->codegen();
+  Value* StartVal = Start->codegen(CI);
   if (!StartVal)
     return nullptr;
 
@@ -371,33 +1171,47 @@ inline auto ForExpr::codegen() -> Value*
 
   // Create an alloca for the variable in the entry block using dynamic type
   AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, LoopVarType, VarName);
+  if (Start->isUnsigned())
+    CI.UnsignedValues.insert(Alloca);
 
   // Store the value into the alloca.
-  Builder->CreateStore(StartVal, Alloca);
+  CI.Builder->CreateStore(StartVal, Alloca);
 
   // Make the new basic block for the loop header, inserting after current block.
-  BasicBlock* LoopBB = BasicBlock::Create(*TheContext, "loop", TheFunction);
+  BasicBlock* LoopBB = BasicBlock::Create(*CI.TheContext, "loop", TheFunction);
   // Insert an explicit fall through from the current block to the LoopBB.
-  Builder->CreateBr(LoopBB);
+  CI.Builder->CreateBr(LoopBB);
   // Start insertion in LoopBB.
-  Builder->SetInsertPoint(LoopBB);
+  CI.Builder->SetInsertPoint(LoopBB);
 
   // Within the loop, the variable is defined equal to the PHI node. If it
   // shadows an existing variable, we have to restore it, so save it now.
-  AllocaInst* OldVal   = NamedValues[VarName];
-  NamedValues[VarName] = Alloca;
+  AllocaInst* OldVal      = CI.NamedValues[VarName];
+  CI.NamedValues[VarName] = Alloca;
+
+  BasicBlock* LatchBB = BasicBlock::Create(*CI.TheContext, "loopend");
+  BasicBlock* AfterBB = BasicBlock::Create(*CI.TheContext, "afterloop");
 
   // Emit the body of the loop. This, like any other expr, can change the
   // current BB. Note that we ignore the value computed by the body, but don't
   // allow an error.
-  if (!Body->codegen())
+  CI.Loops.push_back({AfterBB, LatchBB});
+  Value* BodyV = Body->codegen(CI);
+  CI.Loops.pop_back();
+  if (!BodyV)
     return nullptr;
 
+  // `continue` and the end of the body meet in the single latch.
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+  TheFunction->insert(TheFunction->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+
   // Emit the step value.
   Value* StepVal = nullptr;
   if (Step)
   {
-    StepVal = Step->codegen();
+    StepVal = Step->codegen(CI);
     if (!StepVal)
       return nullptr;
   }
@@ -414,87 +1228,796 @@ inline auto ForExpr::codegen() -> Value*
     }
     else
     {
-      return LogErrorV("Unsupported type for loop variable");
+      return LogErrorV(CI, "Unsupported type for loop variable");
     }
   }
 
   // Compute the end condition.
-  Value* EndCond = End->codegen();
+  Value* EndCond = End->codegen(CI);
   if (!EndCond)
     return nullptr;
 
   // Reload, increment, and restore the alloca. This handles the case where
   // the body of the loop mutates the variable.
-  Value* CurVar = Builder->CreateLoad(LoopVarType, Alloca, VarName.c_str());
+  Value* CurVar = CI.Builder->CreateLoad(LoopVarType, Alloca, VarName.c_str());
 
   Value* NextVar = nullptr;
   if (LoopVarType->isFloatingPointTy() || LoopVarType->isDoubleTy())
   {
-    NextVar = Builder->CreateFAdd(CurVar, StepVal, "nextvar");
+    NextVar = CI.Builder->CreateFAdd(CurVar, StepVal, "nextvar");
   }
   else if (LoopVarType->isIntegerTy())
   {
-    NextVar = Builder->CreateAdd(CurVar, StepVal, "nextvar");
+    NextVar = CI.Builder->CreateAdd(CurVar, StepVal, "nextvar");
   }
   else
   {
-    return LogErrorV("Unsupported type for loop arithmetic");
+    return LogErrorV(CI, "Unsupported type for loop arithmetic");
   }
 
-  Builder->CreateStore(NextVar, Alloca);
+  CI.Builder->CreateStore(NextVar, Alloca);
 
   // Convert condition to a bool by comparing non-equal to appropriate zero value
   Value* ZeroValue = nullptr;
   if (EndCond->getType()->isFloatingPointTy() || EndCond->getType()->isDoubleTy())
   {
     ZeroValue = ConstantFP::get(EndCond->getType(), 0.0);
-    EndCond   = Builder->CreateFCmpONE(EndCond, ZeroValue, "loopcond");
+    EndCond   = CI.Builder->CreateFCmpONE(EndCond, ZeroValue, "loopcond");
   }
   else if (EndCond->getType()->isIntegerTy())
   {
     ZeroValue = ConstantInt::get(EndCond->getType(), 0);
-    EndCond   = Builder->CreateICmpNE(EndCond, ZeroValue, "loopcond");
+    EndCond   = CI.Builder->CreateICmpNE(EndCond, ZeroValue, "loopcond");
   }
   else
   {
-    return LogErrorV("Unsupported type for loop condition");
+    return LogErrorV(CI, "Unsupported type for loop condition");
   }
 
-  // Create the "after loop" block and insert it.
-  BasicBlock* AfterBB = BasicBlock::Create(*TheContext, "afterloop", TheFunction);
   // Insert the conditional branch into the end of LoopEndBB.
-  Builder->CreateCondBr(EndCond, LoopBB, AfterBB);
+  BranchInst* Backedge = CI.Builder->CreateCondBr(EndCond, LoopBB, AfterBB);
+  LoopHints::Attach(CI, Backedge, LoopBB, Hints);
   // Any new code will be inserted in AfterBB.
-  Builder->SetInsertPoint(AfterBB);
+  TheFunction->insert(TheFunction->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
 
   // Restore the unshadowed variable.
   if (OldVal)
-    NamedValues[VarName] = OldVal;
+    CI.NamedValues[VarName] = OldVal;
   else
-    NamedValues.erase(VarName);
+    CI.NamedValues.erase(VarName);
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   // for expr returns zero value of the loop variable type
   return Constant::getNullValue(LoopVarType);
 }
 
-inline auto VarExpr::codegen() -> llvm::Value*
+// Output a counted loop in rotated form, so the optimizers see a canonical
+// induction variable with a known trip count:
+//   start, end, step = ...      ; evaluated once
+//   br start < end, range.preheader, afterloop
+// range.preheader:
+//   trips = (end - start - 1) / step + 1
+// range.body:
+//   i = phi [start, range.preheader], [next, range.latch]
+//   n = phi [trips, range.preheader], [n.next, range.latch]
+//   bodyexpr        ; `continue` -> range.latch, `break` -> afterloop
+//   goto range.latch
+// range.latch:
+//   next = i + step
+//   n.next = n - 1
+//   br n.next != 0, range.body, afterloop
+// afterloop:
+// A downward loop (negative step) tests `start > end` and divides the distance
+// `start - end` by `-step` instead.
+inline auto RangeForExpr::codegen(CompilerInstance& CI) -> Value*
 {
-  llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
 
-  // Generate initializer
-  llvm::Value* InitVal = nullptr;
-  if (Init)
+  Value* StartVal = Start->codegen(CI);
+  if (!StartVal)
+    return nullptr;
+  Value* EndVal = End->codegen(CI);
+  if (!EndVal)
+    return nullptr;
+  Value* StepVal = nullptr;
+  if (Step && !(StepVal = Step->codegen(CI)))
+    return nullptr;
+
+  for (Value* V : {StartVal, EndVal, StepVal})
+    if (V && !V->getType()->isIntegerTy())
+      return LogErrorV(CI, "The bounds and step of a range loop must be integers");
+
+  // The induction variable is an i64; it counts unsigned when the end bound is
+  // unsigned and the start cannot be negative.
+  auto*      StartConst = dyn_cast<ConstantInt>(StartVal);
+  const bool IsUnsigned =
+    End->isUnsigned() && (Start->isUnsigned() || (StartConst && !StartConst->isNegative()));
+  Type* IVType = MARE_INT64_TYPE;
+
+  StartVal = convertValue(CI, StartVal, Start->isUnsigned(), IVType, IsUnsigned);
+  EndVal   = convertValue(CI, EndVal, End->isUnsigned(), IVType, IsUnsigned);
+  StepVal  = Step ? convertValue(CI, StepVal, Step->isUnsigned(), IVType, IsUnsigned)
+                  : ConstantInt::get(IVType, 1);
+
+  // A constant step fixes the direction. A signed step only known at runtime
+  // picks it by its sign; an unsigned one counts up.
+  auto* StepConst = dyn_cast<ConstantInt>(StepVal);
+  ConstantStep    = StepConst != nullptr;
+  if (StepConst && StepConst->isZero())
+    return LogErrorV(CI, "The step of a range loop must not be zero");
+  const bool SignedStep = !(Step && Step->isUnsigned());
+  const bool Down       = StepConst && SignedStep && StepConst->isNegative();
+  Value*     StepNeg    = nullptr;
+  if (!StepConst && SignedStep)
+    StepNeg = CI.Builder->CreateICmpSLT(StepVal, ConstantInt::get(IVType, 0), "step.neg");
+
+  // ByDirection - Emit(Down) for the direction of the loop, selected at runtime
+  // when only the sign of the step tells.
+  auto ByDirection = [&](auto Emit) -> Value*
   {
-    InitVal = Init->codegen();
-    if (!InitVal)
-      return nullptr;
-  }
-  else
+    if (!StepNeg)
+      return Emit(Down);
+    Value* IfDown = Emit(true);
+    Value* IfUp   = Emit(false);
+    return CI.Builder->CreateSelect(StepNeg, IfDown, IfUp);
+  };
+
+  BasicBlock* PreheaderBB = BasicBlock::Create(*CI.TheContext, "range.preheader", TheFunction);
+  BasicBlock* BodyBB      = BasicBlock::Create(*CI.TheContext, "range.body");
+  BasicBlock* LatchBB     = BasicBlock::Create(*CI.TheContext, "range.latch");
+  BasicBlock* AfterBB     = BasicBlock::Create(*CI.TheContext, "afterloop");
+
+  Value* Guard = ByDirection(
+    [&](bool D)
+    {
+      const auto Pred = D ? (IsUnsigned ? ICmpInst::ICMP_UGT : ICmpInst::ICMP_SGT)
+                          : (IsUnsigned ? ICmpInst::ICMP_ULT : ICmpInst::ICMP_SLT);
+      return CI.Builder->CreateICmp(Pred, StartVal, EndVal, "guard");
+    });
+  CI.Builder->CreateCondBr(Guard, PreheaderBB, AfterBB);
+
+  // The trip count is worked out in unsigned arithmetic, where the distance
+  // between any two i64 bounds fits, and the loop counts it down. Testing
+  // `i + step < end` instead would overflow when `end` lies within one step of
+  // the largest i64, so the induction variable steps without wrap flags. A zero
+  // step found at runtime gives zero trips, which the count down wraps to 2^64,
+  // so a loop that never advances still runs on as before.
+  CI.Builder->SetInsertPoint(PreheaderBB);
+  Value* Distance = ByDirection([&](bool D)
+                                { return D ? CI.Builder->CreateSub(StartVal, EndVal, "distance")
+                                           : CI.Builder->CreateSub(EndVal, StartVal, "distance"); });
+  Value* Stride   = ByDirection([&](bool D)
+                              { return D ? CI.Builder->CreateNeg(StepVal, "stride") : StepVal; });
+  Value* StepZero = nullptr;
+  if (!StepConst)
   {
-    // Default to 0.0
-    InitVal = llvm::ConstantFP::get(*TheContext, llvm::APFloat(0.0));
+    StepZero = CI.Builder->CreateICmpEQ(StepVal, ConstantInt::get(IVType, 0), "step.zero");
+    Stride   = CI.Builder->CreateSelect(StepZero, ConstantInt::get(IVType, 1), Stride);
+  }
+  Value* Trips = CI.Builder->CreateAdd(
+    CI.Builder->CreateUDiv(CI.Builder->CreateSub(Distance, ConstantInt::get(IVType, 1)), Stride),
+    ConstantInt::get(IVType, 1), "trips", /*HasNUW=*/true);
+  if (StepZero)
+    Trips = CI.Builder->CreateSelect(StepZero, ConstantInt::get(IVType, 0), Trips);
+  CI.Builder->CreateBr(BodyBB);
+
+  TheFunction->insert(TheFunction->end(), BodyBB);
+  CI.Builder->SetInsertPoint(BodyBB);
+  PHINode* IV = CI.Builder->CreatePHI(IVType, 2, VarName + ".iv");
+  IV->addIncoming(StartVal, PreheaderBB);
+  PHINode* Remaining = CI.Builder->CreatePHI(IVType, 2, VarName + ".trips");
+  Remaining->addIncoming(Trips, PreheaderBB);
+
+  // The body works on a copy of the induction variable, so assigning to it
+  // cannot change the trip count.
+  AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, IVType, VarName);
+  if (IsUnsigned)
+    CI.UnsignedValues.insert(Alloca);
+  CI.Builder->CreateStore(IV, Alloca);
+
+  // The loop variable shadows any outer variable of the same name.
+  AllocaInst* OldVal      = CI.NamedValues[VarName];
+  CI.NamedValues[VarName] = Alloca;
+
+  CI.Loops.push_back({AfterBB, LatchBB});
+  Value* BodyV = Body->codegen(CI);
+  CI.Loops.pop_back();
+  if (!BodyV)
+    return nullptr;
+
+  // `continue` and the end of the body meet in the single latch.
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+  TheFunction->insert(TheFunction->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+
+  Value* NextVar = CI.Builder->CreateAdd(IV, StepVal, "nextvar");
+  IV->addIncoming(NextVar, LatchBB);
+  Value* NextRemaining =
+    CI.Builder->CreateSub(Remaining, ConstantInt::get(IVType, 1), VarName + ".trips.next");
+  Remaining->addIncoming(NextRemaining, LatchBB);
+  BranchInst* Backedge = CI.Builder->CreateCondBr(
+    CI.Builder->CreateIsNotNull(NextRemaining, "loopcond"), BodyBB, AfterBB);
+  LoopHints::Attach(CI, Backedge, BodyBB, Hints);
+
+  TheFunction->insert(TheFunction->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
+
+  // Restore the unshadowed variable.
+  if (OldVal)
+    CI.NamedValues[VarName] = OldVal;
+  else
+    CI.NamedValues.erase(VarName);
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return Constant::getNullValue(IVType);
+}
+
+// Output for-each loop as:
+//   data, len = range
+//   idx = 0
+//   goto cond
+// cond:
+//   br idx < len, body, afterloop
+// body:
+//   var = data[idx]
+//   bodyexpr        ; `continue` -> latch, `break` -> afterloop
+//   goto latch
+// latch:
+//   idx = idx + 1
+//   goto cond
+// afterloop:
+inline auto ForEachExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  if (auto* Call = dynamic_cast<CallExpr*>(Range.get()))
+  {
+    auto It = CI.FunctionProtos.find(Call->getCallee());
+    if (It != CI.FunctionProtos.end() && It->second->isGenerator())
+      return codegenGenerator(CI, *It->second);
+  }
+
+  Address Storage = MaterializeAddress(CI, *Range);
+  if (!Storage)
+    return nullptr;
+
+  auto View = ViewElements(CI, Storage);
+  if (!View)
+    return LogErrorV(CI, "'for ... in' expects an array or a slice");
+  ThroughPointer = !IsLocalStorage(View->Data);
+
+  AllocaInst* IdxAlloca = CreateEntryBlockAlloca(TheFunction, MARE_INT64_TYPE, VarName + ".idx");
+  AllocaInst* VarAlloca = CreateEntryBlockAlloca(TheFunction, View->Elem, VarName);
+  if (Range->isUnsigned())
+    CI.UnsignedValues.insert(VarAlloca);
+  CI.Builder->CreateStore(ConstantInt::get(MARE_INT64_TYPE, 0), IdxAlloca);
+
+  BasicBlock* CondBB  = BasicBlock::Create(*CI.TheContext, "foreach.cond", TheFunction);
+  BasicBlock* BodyBB  = BasicBlock::Create(*CI.TheContext, "foreach.body", TheFunction);
+  BasicBlock* LatchBB = BasicBlock::Create(*CI.TheContext, "foreach.latch");
+  BasicBlock* AfterBB = BasicBlock::Create(*CI.TheContext, "afterloop");
+
+  CI.Builder->CreateBr(CondBB);
+  CI.Builder->SetInsertPoint(CondBB);
+  Value* Idx     = CI.Builder->CreateLoad(MARE_INT64_TYPE, IdxAlloca, "idx");
+  Value* InRange = CI.Builder->CreateICmpULT(Idx, View->Len, "loopcond");
+  CI.Builder->CreateCondBr(InRange, BodyBB, AfterBB);
+
+  CI.Builder->SetInsertPoint(BodyBB);
+  CI.Builder->CreateStore(LoadAddress(CI, ElementAddress(CI, *View, Idx), "elem"), VarAlloca);
+
+  // The element variable shadows any outer variable of the same name.
+  AllocaInst* OldVal      = CI.NamedValues[VarName];
+  CI.NamedValues[VarName] = VarAlloca;
+
+  CI.Loops.push_back({AfterBB, LatchBB});
+  Value* BodyV = Body->codegen(CI);
+  CI.Loops.pop_back();
+  if (!BodyV)
+    return nullptr;
+
+  // The body may already have left the function.
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+
+  TheFunction->insert(TheFunction->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+  Value* NextIdx = CI.Builder->CreateAdd(Idx, ConstantInt::get(MARE_INT64_TYPE, 1), "nextidx",
+                                         /*HasNUW=*/true, /*HasNSW=*/true);
+  CI.Builder->CreateStore(NextIdx, IdxAlloca);
+  LoopHints::Attach(CI, CI.Builder->CreateBr(CondBB), CondBB, Hints);
+
+  TheFunction->insert(TheFunction->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
+
+  // Restore the unshadowed variable.
+  if (OldVal)
+    CI.NamedValues[VarName] = OldVal;
+  else
+    CI.NamedValues.erase(VarName);
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return Constant::getNullValue(View->Elem);
+}
+
+// Drive a generator as:
+//   hdl = gen(args)
+// foreach.cond:
+//   coro.resume(hdl)
+//   br coro.done(hdl), afterloop, foreach.body
+// foreach.body:
+//   x = *coro.promise(hdl)
+//   bodyexpr        ; `continue` -> foreach.latch, `break` -> afterloop
+// foreach.latch:
+//   goto foreach.cond
+// afterloop:
+//   coro.destroy(hdl)
+// Leaving the loop with `ret` destroys the generator too (see ReturnExpr).
+inline auto ForEachExpr::codegenGenerator(CompilerInstance& CI, const Prototype& Gen)
+  -> llvm::Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  Value* Handle = Range->codegen(CI);
+  if (!Handle)
+    return nullptr;
+  ThroughPointer = true; // The values live in the generator's frame
+
+  llvm::Type* YieldTy   = Gen.getReturnType();
+  AllocaInst* VarAlloca = CreateEntryBlockAlloca(TheFunction, YieldTy, VarName);
+  if (Range->isUnsigned())
+    CI.UnsignedValues.insert(VarAlloca);
+
+  BasicBlock* CondBB  = BasicBlock::Create(*CI.TheContext, "foreach.cond", TheFunction);
+  BasicBlock* BodyBB  = BasicBlock::Create(*CI.TheContext, "foreach.body", TheFunction);
+  BasicBlock* LatchBB = BasicBlock::Create(*CI.TheContext, "foreach.latch");
+  BasicBlock* AfterBB = BasicBlock::Create(*CI.TheContext, "afterloop");
+
+  CI.Builder->CreateBr(CondBB);
+  CI.Builder->SetInsertPoint(CondBB);
+  Coro::Resume(CI, Handle);
+  CI.Builder->CreateCondBr(Coro::Done(CI, Handle), AfterBB, BodyBB);
+
+  CI.Builder->SetInsertPoint(BodyBB);
+  CI.Builder->CreateStore(Coro::LoadYielded(CI, Handle, YieldTy), VarAlloca);
+
+  // The element variable shadows any outer variable of the same name.
+  AllocaInst* OldVal      = CI.NamedValues[VarName];
+  CI.NamedValues[VarName] = VarAlloca;
+
+  CI.Loops.push_back({AfterBB, LatchBB, Handle});
+  Value* BodyV = Body->codegen(CI);
+  CI.Loops.pop_back();
+  if (!BodyV)
+    return nullptr;
+
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+
+  TheFunction->insert(TheFunction->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+  LoopHints::Attach(CI, CI.Builder->CreateBr(CondBB), CondBB, Hints);
+
+  TheFunction->insert(TheFunction->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
+  Coro::Destroy(CI, Handle);
+
+  // Restore the unshadowed variable.
+  if (OldVal)
+    CI.NamedValues[VarName] = OldVal;
+  else
+    CI.NamedValues.erase(VarName);
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return Constant::getNullValue(YieldTy);
+}
+
+/// codegenChunk - The body of Chunk(ctx, lo, hi): run the iterations from lo to
+/// hi. The chunk is a function of its own; it reaches the enclosing locals
+/// through the addresses ctx holds, so every chunk works on the same ones and
+/// their stores (or atomics) are seen after the loop.
+inline auto ParallelForExpr::codegenChunk(
+  CompilerInstance& CI, llvm::Function* Chunk,
+  const std::vector<std::pair<std::string, Address>>& Captures, bool IsUnsigned) -> bool
+{
+  llvm::IRBuilderBase::InsertPointGuard Guard(*CI.Builder);
+
+  auto       OuterValues    = std::exchange(CI.NamedValues, {});
+  auto       OuterShared    = std::exchange(CI.SharedLocals, {});
+  auto       OuterLoops     = std::exchange(CI.Loops, {});
+  auto       OuterGenerator = std::exchange(CI.Generator, std::nullopt);
+  const bool OuterParallel  = std::exchange(CI.InParallelBody, true);
+
+  llvm::Value* Ctx = Chunk->getArg(0);
+  llvm::Value* Lo  = Chunk->getArg(1);
+  llvm::Value* Hi  = Chunk->getArg(2);
+  Ctx->setName("ctx");
+  Lo->setName("lo");
+  Hi->setName("hi");
+
+  BasicBlock* EntryBB = BasicBlock::Create(*CI.TheContext, "entry", Chunk);
+  CI.Builder->SetInsertPoint(EntryBB);
+
+  llvm::Type* CtxTy = MARE_ARRAY_TYPE(MARE_PTR_TYPE, Captures.size());
+  for (unsigned i = 0; i != Captures.size(); ++i)
+  {
+    const auto& [Name, Outer] = Captures[i];
+    llvm::Value* Addr         = CI.Builder->CreateLoad(
+      MARE_PTR_TYPE, CI.Builder->CreateConstInBoundsGEP2_32(CtxTy, Ctx, 0, i), Name + ".addr");
+    if (CI.UnsignedValues.contains(Outer.Ptr))
+      CI.UnsignedValues.insert(Addr);
+    CI.SharedLocals[Name] = {Addr, Outer.Ty};
+  }
+
+  BasicBlock* BodyBB  = BasicBlock::Create(*CI.TheContext, "pfor.body", Chunk);
+  BasicBlock* LatchBB = BasicBlock::Create(*CI.TheContext, "pfor.latch");
+  BasicBlock* AfterBB = BasicBlock::Create(*CI.TheContext, "afterloop");
+  CI.Builder->CreateCondBr(CI.Builder->CreateICmpSLT(Lo, Hi, "guard"), BodyBB, AfterBB);
+
+  CI.Builder->SetInsertPoint(BodyBB);
+  PHINode* IV = CI.Builder->CreatePHI(MARE_INT64_TYPE, 2, VarName + ".iv");
+  IV->addIncoming(Lo, EntryBB);
+
+  AllocaInst* Alloca = CreateEntryBlockAlloca(Chunk, MARE_INT64_TYPE, VarName);
+  if (IsUnsigned)
+    CI.UnsignedValues.insert(Alloca);
+  CI.Builder->CreateStore(IV, Alloca);
+  CI.NamedValues[VarName] = Alloca;
+
+  // `continue` ends the iteration; nothing can end the loop early.
+  CI.Loops.push_back({nullptr, LatchBB});
+  Value* BodyV = Body->codegen(CI);
+  if (!BodyV)
+    return false;
+
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+  Chunk->insert(Chunk->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+
+  Value*      NextVar  = CI.Builder->CreateNSWAdd(IV, CI.Builder->getInt64(1), "nextvar");
+  BranchInst* Backedge = CI.Builder->CreateCondBr(
+    CI.Builder->CreateICmpSLT(NextVar, Hi, "loopcond"), BodyBB, AfterBB);
+  IV->addIncoming(NextVar, LatchBB);
+  LoopHints::Attach(CI, Backedge, BodyBB, Hints);
+
+  Chunk->insert(Chunk->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
+  CI.Builder->CreateRetVoid();
+
+  CI.NamedValues    = std::move(OuterValues);
+  CI.SharedLocals   = std::move(OuterShared);
+  CI.Loops          = std::move(OuterLoops);
+  CI.Generator      = std::move(OuterGenerator);
+  CI.InParallelBody = OuterParallel;
+  return true;
+}
+
+inline auto ParallelForExpr::codegen(CompilerInstance& CI) -> Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  Value* StartVal = Start->codegen(CI);
+  if (!StartVal)
+    return nullptr;
+  Value* EndVal = End->codegen(CI);
+  if (!EndVal)
+    return nullptr;
+  if (!StartVal->getType()->isIntegerTy() || !EndVal->getType()->isIntegerTy())
+    return LogErrorV(CI, "The bounds of a 'pfor' must be integers");
+
+  // As in a range loop, the induction variable counts unsigned when the end
+  // bound is unsigned and the start cannot be negative. The pool splits the
+  // range as signed i64s.
+  auto*      StartConst = dyn_cast<ConstantInt>(StartVal);
+  const bool IsUnsigned =
+    End->isUnsigned() && (Start->isUnsigned() || (StartConst && !StartConst->isNegative()));
+  StartVal = convertValue(CI, StartVal, Start->isUnsigned(), MARE_INT64_TYPE, IsUnsigned);
+  EndVal   = convertValue(CI, EndVal, End->isUnsigned(), MARE_INT64_TYPE, IsUnsigned);
+
+  // The chunks find the locals in scope through their addresses; in a nested
+  // `pfor` those include the locals the enclosing chunk shares.
+  std::map<std::string, Address> InScope = CI.SharedLocals;
+  for (const auto& [Name, Alloca] : CI.NamedValues)
+    if (Alloca)
+      InScope[Name] = {Alloca, Alloca->getAllocatedType()};
+  std::vector<std::pair<std::string, Address>> Captures(InScope.begin(), InScope.end());
+
+  llvm::Type* CtxTy = MARE_ARRAY_TYPE(MARE_PTR_TYPE, Captures.size());
+  AllocaInst* Ctx   = CreateEntryBlockAlloca(TheFunction, CtxTy, "pfor.ctx");
+  for (unsigned i = 0; i != Captures.size(); ++i)
+    CI.Builder->CreateStore(Captures[i].second.Ptr,
+                            CI.Builder->CreateConstInBoundsGEP2_32(CtxTy, Ctx, 0, i));
+
+  auto* ChunkTy = llvm::FunctionType::get(
+    MARE_VOID_TYPE, {MARE_PTR_TYPE, MARE_INT64_TYPE, MARE_INT64_TYPE}, false);
+  auto* Chunk   = llvm::Function::Create(ChunkTy, llvm::Function::InternalLinkage,
+                                         TheFunction->getName() + __MARE_PFOR_SUFFIX__,
+                                         *CI.TheModule);
+  if (!codegenChunk(CI, Chunk, Captures, IsUnsigned))
+    return nullptr;
+
+  CI.fileCoords.UpdateCodegenCoords();
+  CI.Builder->CreateCall(Threads::GetParallelForFunction(CI), {Chunk, Ctx, StartVal, EndVal});
+  return Constant::getNullValue(MARE_INT64_TYPE);
+}
+
+/// ReduceIdentity - The value x for which `x Op y` is y.
+static auto ReduceIdentity(CompilerInstance& CI, char Op, llvm::Type* Ty, bool Unsigned)
+  -> llvm::Constant*
+{
+  llvm::Type* Elem = Ty->getScalarType();
+  if (Elem->isFloatingPointTy())
+  {
+    if (Op == '+')
+      return llvm::ConstantFP::getNegativeZero(Ty);
+    if (Op == '*')
+      return llvm::ConstantFP::get(Ty, 1.0);
+    if (Op == '<' || Op == '>')
+      return llvm::ConstantFP::getInfinity(Ty, /*Negative=*/Op == '>');
+    return LogErrorV(CI, "reduce: bitwise folds need integers"), nullptr;
+  }
+
+  const unsigned Bits = Elem->getIntegerBitWidth();
+  switch (Op)
+  {
+    case '*':
+      return llvm::ConstantInt::get(Ty, 1);
+    case '&':
+      return llvm::Constant::getAllOnesValue(Ty);
+    case '<':
+      return llvm::ConstantInt::get(Ty, Unsigned ? llvm::APInt::getMaxValue(Bits)
+                                                 : llvm::APInt::getSignedMaxValue(Bits));
+    case '>':
+      return llvm::ConstantInt::get(Ty, Unsigned ? llvm::APInt::getMinValue(Bits)
+                                                 : llvm::APInt::getSignedMinValue(Bits));
+    default: // '+', '|', '^'
+      return llvm::Constant::getNullValue(Ty);
+  }
+}
+
+inline auto ReduceExpr::codegen(CompilerInstance& CI) -> Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  Value* StartVal = Start->codegen(CI);
+  if (!StartVal)
+    return nullptr;
+  Value* EndVal = End->codegen(CI);
+  if (!EndVal)
+    return nullptr;
+  if (!StartVal->getType()->isIntegerTy() || !EndVal->getType()->isIntegerTy())
+    return LogErrorV(CI, "The bounds of a 'reduce' range must be integers");
+
+  // The range counts like `for i in start..end`.
+  auto*      StartConst = dyn_cast<ConstantInt>(StartVal);
+  const bool IsUnsigned =
+    End->isUnsigned() && (Start->isUnsigned() || (StartConst && !StartConst->isNegative()));
+  const auto Pred = IsUnsigned ? ICmpInst::ICMP_ULT : ICmpInst::ICMP_SLT;
+
+  StartVal = convertValue(CI, StartVal, Start->isUnsigned(), MARE_INT64_TYPE, IsUnsigned);
+  EndVal   = convertValue(CI, EndVal, End->isUnsigned(), MARE_INT64_TYPE, IsUnsigned);
+
+  BasicBlock* GuardBB = CI.Builder->GetInsertBlock();
+  BasicBlock* BodyBB  = BasicBlock::Create(*CI.TheContext, "reduce.body", TheFunction);
+  BasicBlock* AfterBB = BasicBlock::Create(*CI.TheContext, "reduce.end");
+  CI.Builder->CreateCondBr(CI.Builder->CreateICmp(Pred, StartVal, EndVal, "guard"), BodyBB,
+                           AfterBB);
+
+  CI.Builder->SetInsertPoint(BodyBB);
+  PHINode* IV = CI.Builder->CreatePHI(MARE_INT64_TYPE, 2, VarName + ".iv");
+  IV->addIncoming(StartVal, GuardBB);
+
+  AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, MARE_INT64_TYPE, VarName);
+  if (IsUnsigned)
+    CI.UnsignedValues.insert(Alloca);
+  CI.Builder->CreateStore(IV, Alloca);
+
+  AllocaInst* OldVal      = CI.NamedValues[VarName];
+  CI.NamedValues[VarName] = Alloca;
+
+  // The fold is an expression: `break` and `continue` cannot leave it.
+  auto   OuterLoops = std::exchange(CI.Loops, {});
+  Value* V          = Body->codegen(CI);
+  CI.Loops          = std::move(OuterLoops);
+  if (!V)
+    return nullptr;
+
+  llvm::Type* Ty = V->getType();
+  if (!Ty->isIntOrIntVectorTy() && !Ty->isFPOrFPVectorTy())
+    return LogErrorV(CI, "reduce: expects numbers or vectors of numbers");
+  const bool FP = Ty->isFPOrFPVectorTy();
+  Unsigned      = Body->isUnsigned();
+
+  llvm::Constant* Identity = ReduceIdentity(CI, Op, Ty, Unsigned);
+  if (!Identity)
+    return nullptr;
+
+  // The accumulator lives in a PHI, never in memory.
+  llvm::PHINode* Acc = llvm::PHINode::Create(Ty, 2, "acc");
+  Acc->insertBefore(IV);
+  Acc->addIncoming(Identity, GuardBB);
+
+  namespace In = llvm::Intrinsic;
+  Value* Next  = nullptr;
+  switch (Op)
+  {
+    case '+':
+    case '*':
+      if (FP)
+        Next = Op == '+' ? CI.Builder->CreateFAdd(Acc, V, "acc.next")
+                         : CI.Builder->CreateFMul(Acc, V, "acc.next");
+      else if (CI.Args.trapOverflow)
+        Next = Builtins::EmitTrappingArith(CI, Op, Acc, V, Unsigned);
+      else
+        Next = Op == '+' ? CI.Builder->CreateAdd(Acc, V, "acc.next")
+                         : CI.Builder->CreateMul(Acc, V, "acc.next");
+      if (FP && Reassoc)
+        llvm::cast<llvm::Instruction>(Next)->setHasAllowReassoc(*Reassoc);
+      break;
+    case '&':
+      Next = CI.Builder->CreateAnd(Acc, V, "acc.next");
+      break;
+    case '|':
+      Next = CI.Builder->CreateOr(Acc, V, "acc.next");
+      break;
+    case '^':
+      Next = CI.Builder->CreateXor(Acc, V, "acc.next");
+      break;
+    default: // min and max are exact in any order
+    {
+      const In::ID ID = FP         ? (Op == '<' ? In::minnum : In::maxnum)
+                        : Unsigned ? (Op == '<' ? In::umin : In::umax)
+                                   : (Op == '<' ? In::smin : In::smax);
+      Next            = Builtins::EmitIntrinsic(CI, ID, {Acc, V}, "acc.next");
+    }
+  }
+
+  BasicBlock* LatchBB = CI.Builder->GetInsertBlock();
+  Value*      NextVar = CI.Builder->CreateAdd(IV, CI.Builder->getInt64(1), "nextvar",
+                                              /*HasNUW=*/IsUnsigned, /*HasNSW=*/!IsUnsigned);
+  IV->addIncoming(NextVar, LatchBB);
+  Acc->addIncoming(Next, LatchBB);
+  BranchInst* Backedge = CI.Builder->CreateCondBr(
+    CI.Builder->CreateICmp(Pred, NextVar, EndVal, "loopcond"), BodyBB, AfterBB);
+  LoopHints::Attach(CI, Backedge, BodyBB, Hints);
+
+  TheFunction->insert(TheFunction->end(), AfterBB);
+  CI.Builder->SetInsertPoint(AfterBB);
+  PHINode* Result = CI.Builder->CreatePHI(Ty, 2, "reduced");
+  Result->addIncoming(Identity, GuardBB);
+  Result->addIncoming(Next, LatchBB);
+
+  if (OldVal)
+    CI.NamedValues[VarName] = OldVal;
+  else
+    CI.NamedValues.erase(VarName);
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return Result;
+}
+
+// Output while loop as:
+// while.cond:
+//   br cond, while.body, while.end
+// while.body:
+//   bodyexpr        ; `continue` -> while.latch, `break` -> while.end
+//   goto while.latch
+// while.latch:
+//   goto while.cond
+// while.end:
+inline auto WhileExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  BasicBlock* CondBB  = BasicBlock::Create(*CI.TheContext, "while.cond", TheFunction);
+  BasicBlock* BodyBB  = BasicBlock::Create(*CI.TheContext, "while.body");
+  BasicBlock* LatchBB = BasicBlock::Create(*CI.TheContext, "while.latch");
+  BasicBlock* ExitBB  = BasicBlock::Create(*CI.TheContext, "while.end");
+
+  CI.Builder->CreateBr(CondBB);
+  CI.Builder->SetInsertPoint(CondBB);
+
+  Value* CondV = Cond->codegen(CI);
+  if (!CondV)
+    return nullptr;
+  if (!(CondV = CreateCondition(CI, CondV, "whilecond")))
+    return LogErrorV(CI, "Unsupported condition type in 'while' loop");
+  CI.Builder->CreateCondBr(CondV, BodyBB, ExitBB);
+
+  TheFunction->insert(TheFunction->end(), BodyBB);
+  CI.Builder->SetInsertPoint(BodyBB);
+
+  CI.Loops.push_back({ExitBB, LatchBB});
+  Value* BodyV = Body->codegen(CI);
+  CI.Loops.pop_back();
+  if (!BodyV)
+    return nullptr;
+
+  // `continue` and the end of the body meet in the single latch.
+  if (!CI.Builder->GetInsertBlock()->getTerminator())
+    CI.Builder->CreateBr(LatchBB);
+  TheFunction->insert(TheFunction->end(), LatchBB);
+  CI.Builder->SetInsertPoint(LatchBB);
+  LoopHints::Attach(CI, CI.Builder->CreateBr(CondBB), CondBB, Hints);
+
+  TheFunction->insert(TheFunction->end(), ExitBB);
+  CI.Builder->SetInsertPoint(ExitBB);
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  // while expr always returns 0.0.
+  return Constant::getNullValue(MARE_DOUBLE_TYPE);
+}
+
+inline auto BreakExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  if (CI.Loops.empty())
+    return LogErrorV(CI, "'break' outside of a loop");
+  if (!CI.Loops.back().Break)
+    return LogErrorV(CI, "'break' cannot leave a 'pfor'; its iterations run in any order");
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return CI.Builder->CreateBr(CI.Loops.back().Break);
+}
+
+inline auto ContinueExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  if (CI.Loops.empty())
+    return LogErrorV(CI, "'continue' outside of a loop");
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return CI.Builder->CreateBr(CI.Loops.back().Continue);
+}
+
+inline auto YieldExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  if (!CI.Generator)
+    return LogErrorV(CI, "'yield' outside of a 'gen fn'");
+
+  llvm::Value* V = Operand->codegen(CI);
+  if (!V)
+    return nullptr;
+
+  // Convert to the declared type; a tuple converts element by element.
+  llvm::Type* YieldTy = CI.Generator->Promise->getAllocatedType();
+  V = isScalarType(V->getType())
+        ? promoteValue(CI, V, V->getType(), YieldTy, Operand->isUnsigned())
+        : coerceTuple(CI, V, YieldTy, Operand->isUnsigned());
+  if (!V)
+    return nullptr;
+  if (V->getType() != YieldTy)
+    return LogErrorV(CI, "'yield' value does not match the type the generator yields");
+
+  Unsigned = CI.Generator->Unsigned;
+  Coro::Yield(CI, V);
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return V;
+}
+
+inline auto VarExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Function* TheFunction = CI.Builder->GetInsertBlock()->getParent();
+
+  // Generate initializer
+  llvm::Value* InitVal = nullptr;
+  if (Init)
+  {
+    InitVal = Init->codegen(CI);
+    if (!InitVal)
+      return nullptr;
+  }
+  else
+  {
+    // Default to 0.0
+    InitVal = llvm::ConstantFP::get(*CI.TheContext, llvm::APFloat(0.0));
   }
 
   llvm::Type* InitType = InitVal->getType();
@@ -502,108 +2025,240 @@ inline auto VarExpr::codegen() -> llvm::Value*
 
   // Allocate space for the variable in the entry block
   llvm::AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, InitType, VarName);
+  if (Init && Init->isUnsigned())
+    CI.UnsignedValues.insert(Alloca);
+  Unsigned = Init && Init->isUnsigned();
 
   // Store the initializer value
-  Builder->CreateStore(InitVal, Alloca);
+  CI.Builder->CreateStore(InitVal, Alloca);
 
   // Register in symbol table
-  NamedValues[VarName] = Alloca;
+  CI.NamedValues[VarName] = Alloca;
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   // Return the value just assigned (or null if you'd prefer this to be void)
   return InitVal;
 }
 
-inline auto Prototype::codegen() -> llvm::Function*
+inline auto DestructureExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Value* InitVal = Init->codegen(CI);
+  if (!InitVal)
+    return nullptr;
+
+  auto* ST = llvm::dyn_cast<llvm::StructType>(InitVal->getType());
+  if (!ST || Types::IsSliceType(CI, ST))
+    return LogErrorV(CI, "Only a tuple or a struct can be destructured");
+  if (ST->getNumElements() != VarNames.size())
+    return LogErrorV(CI, "Number of names does not match the number of elements");
+
+  // Tuples carry one signedness for all their elements, struct fields their own.
+  const StructInfo* S           = Types::FindStruct(CI, ST);
+  llvm::Function*   TheFunction = CI.Builder->GetInsertBlock()->getParent();
+  Unsigned                      = Init->isUnsigned();
+  for (unsigned i = 0; i != VarNames.size(); ++i)
+  {
+    if (VarNames[i] == "_")
+      continue;
+
+    llvm::Value*      Elem   = CI.Builder->CreateExtractValue(InitVal, i, VarNames[i]);
+    llvm::AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, Elem->getType(), VarNames[i]);
+    if (S ? S->UnsignedFields[i] : Unsigned)
+      CI.UnsignedValues.insert(Alloca);
+
+    CI.Builder->CreateStore(Elem, Alloca);
+    CI.NamedValues[VarNames[i]] = Alloca;
+  }
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return InitVal;
+}
+
+inline auto TupleExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  std::vector<llvm::Value*> Vals;
+  std::vector<llvm::Type*>  ElemTypes;
+  Unsigned = true;
+  for (auto& E : Elements)
+  {
+    llvm::Value* V = E->codegen(CI);
+    if (!V)
+      return nullptr;
+    Vals.push_back(V);
+    ElemTypes.push_back(V->getType());
+    Unsigned &= E->isUnsigned();
+  }
+
+  // Build the value in registers; a struct return hands it back the same way.
+  llvm::Value* Tuple = llvm::PoisonValue::get(llvm::StructType::get(*CI.TheContext, ElemTypes));
+  for (unsigned i = 0; i != Vals.size(); ++i)
+    Tuple = CI.Builder->CreateInsertValue(Tuple, Vals[i], i);
+
+  CI.fileCoords.UpdateCodegenCoords();
+  return Tuple;
+}
+
+inline auto Prototype::codegen(CompilerInstance& CI) -> llvm::Function*
 {
-  // Make the function type: RetType(ArgType, ArgType, ...) etc.
-  FunctionType* FT = FunctionType::get(RetType, ArgTypes, false); // Use stored return type
+  // Make the function type: RetType(ArgType, ArgType, ...) etc. A generator
+  // returns the handle of its coroutine instead.
+  llvm::Type*   FnRetType = Generator ? MARE_PTR_TYPE : RetType;
+  FunctionType* FT        = FunctionType::get(FnRetType, ArgTypes, false);
 
   llvm::Function* F =
-    llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Name, TheModule.get());
+    llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Name, CI.TheModule.get());
 
-  // Set names for all arguments.
+  // Set names for all arguments, and remember which hold unsigned integers.
   unsigned Idx = 0;
   for (auto& Arg : F->args())
+  {
+    if (Idx < UnsignedArgs.size() && UnsignedArgs[Idx])
+      CI.UnsignedValues.insert(&Arg);
     Arg.setName(Args[Idx++]);
+  }
+  if (UnsignedRet)
+    CI.UnsignedValues.insert(F);
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   return F;
 }
 
-inline auto FunctionalAST::codegen() -> llvm::Function*
+inline auto GlobalVarAST::codegen(CompilerInstance& CI) -> llvm::GlobalVariable*
+{
+  if (CI.GlobalValues.contains(Name))
+  {
+    const std::string errMsg = "'" + Name + "' is already defined at top level";
+    return LogErrorV(CI, errMsg.c_str()), nullptr;
+  }
+
+  // The initializer is evaluated in a scratch function that is dropped again;
+  // only a constant result can become the global's data.
+  auto* ScratchTy = llvm::FunctionType::get(MARE_VOID_TYPE, false);
+  auto* Scratch   = llvm::Function::Create(ScratchTy, llvm::Function::PrivateLinkage,
+                                           "__mare_global_init", *CI.TheModule);
+  CI.NamedValues.clear();
+  CI.Builder->SetInsertPoint(BasicBlock::Create(*CI.TheContext, "entry", Scratch));
+  Value* InitV = Init->codegen(CI);
+  CI.Builder->ClearInsertionPoint();
+
+  // A non-constant result is an instruction of Scratch, so look at it first.
+  auto* C = dyn_cast_or_null<Constant>(InitV);
+  Scratch->eraseFromParent();
+  if (!InitV)
+    return nullptr;
+  if (!C)
+    return LogErrorV(CI, "A 'const' or 'global' needs a constant initializer"), nullptr;
+
+  // Constants are read-only and nobody compares their addresses, so they can
+  // go to .rodata and be merged with equal data.
+  auto* GV = new llvm::GlobalVariable(*CI.TheModule, C->getType(), IsConst,
+                                      llvm::GlobalValue::InternalLinkage, C, Name);
+  if (IsConst)
+    GV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  if (Init->isUnsigned())
+    CI.UnsignedValues.insert(GV);
+
+  CI.GlobalValues[Name] = GV;
+  return GV;
+}
+
+inline auto FunctionalAST::codegen(CompilerInstance& CI) -> llvm::Function*
 {
   // Transfer ownership of the prototype to the FunctionProtos map.
   auto& P = *Proto;
   fprintf(stderr, "-- Generating Code for '%s'\n", P.getName().c_str());
-  FunctionProtos[Proto->getName()] = std::move(Proto);
-  llvm::Function* TheFunction      = getFunction(P.getName());
+  CI.FunctionProtos[Proto->getName()] = std::move(Proto);
+  llvm::Function* TheFunction         = getFunction(CI, P.getName());
   if (!TheFunction)
     return nullptr;
 
   // If this is an operator, install it.
   if (P.isBinaryOp())
-    Mare::Parser::BinopPrecedence[P.getOperatorName()] = P.getBinaryPrecedence();
+    CI.BinopPrecedence[P.getOperatorName()] = P.getBinaryPrecedence();
 
   // Create a new basic block to start insertion into.
-  BasicBlock* BB = BasicBlock::Create(*TheContext, "entry", TheFunction);
-  Builder->SetInsertPoint(BB);
+  BasicBlock* BB = BasicBlock::Create(*CI.TheContext, "entry", TheFunction);
+  CI.Builder->SetInsertPoint(BB);
+  CI.Builder->setFastMathFlags(FastMath::Mode(P.getAttributes()).value_or(FastMath::Default(CI)));
+
+  // A generator runs nothing until it is first resumed, not even the copies of
+  // its arguments below.
+  CI.Generator.reset();
+  if (P.isGenerator())
+  {
+    if (P.getReturnType()->isVoidTy())
+      return LogErrorV(CI, "A 'gen fn' must declare the type it yields"), nullptr;
+
+    AllocaInst* Promise = CreateEntryBlockAlloca(TheFunction, P.getReturnType(), "promise");
+    Coro::Begin(CI, TheFunction, Promise, CI.UnsignedValues.contains(TheFunction));
+  }
 
   // Record the function arguments in the NamedValues map.
-  NamedValues.clear();
+  CI.NamedValues.clear();
   for (auto& Arg : TheFunction->args())
   {
     // Create an alloca for this variable.
     AllocaInst* Alloca = CreateEntryBlockAlloca(TheFunction, Arg.getType(), Arg.getName());
+    if (CI.UnsignedValues.contains(&Arg))
+      CI.UnsignedValues.insert(Alloca);
 
     // Store the initial value into the alloca.
-    Builder->CreateStore(&Arg, Alloca);
+    CI.Builder->CreateStore(&Arg, Alloca);
 
     // Add arguments to variable symbol table.
-    NamedValues[std::string(Arg.getName())] = Alloca;
+    CI.NamedValues[std::string(Arg.getName())] = Alloca;
   }
 
-  if (Value* RetVal = Body->codegen())
+  if (Value* RetVal = Body->codegen(CI))
   {
+    // A generator returns its handle from the suspend points instead.
+    if (P.isGenerator())
+      Coro::End(CI);
     // If function return type is void, we do not return a value.
-    if (!Builder->GetInsertBlock()->getTerminator())
+    else if (!CI.Builder->GetInsertBlock()->getTerminator())
     {
       if (P.getReturnType()->isVoidTy())
-        Builder->CreateRetVoid();
-      else
-        Builder->CreateRet(RetVal);
+        CI.Builder->CreateRetVoid();
+      else if ((RetVal = coerceTuple(CI, RetVal, P.getReturnType(), Body->isUnsigned())))
+        CI.Builder->CreateRet(RetVal);
     }
 
     // Validate the generated code, checking for consistency.
     verifyFunction(*TheFunction);
 
+    // Summarise the body for attribute inference once the module is complete.
+    Effects::RecordFunction(CI, P, *Body);
+    if (P.hasAttribute("memo"))
+      CI.MemoFunctions.push_back(P.getName());
+
     return TheFunction;
   }
 
   // Error reading body, remove function.
   TheFunction->eraseFromParent();
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   if (P.isBinaryOp())
-    Mare::Parser::BinopPrecedence.erase(P.getOperatorName());
+    CI.BinopPrecedence.erase(P.getOperatorName());
   return nullptr;
 }
 
-inline auto BlockExpr::codegen() -> llvm::Value*
+inline auto BlockExpr::codegen(CompilerInstance& CI) -> llvm::Value*
 {
   llvm::Value* Last = nullptr;
 
   for (auto& Expr : Expressions)
   {
-    Last = Expr->codegen();
+    Last = Expr->codegen(CI);
     if (!Last)
       return nullptr;
+    Unsigned = Expr->isUnsigned();
 
     // If the current basic block now ends in a return, break early
-    llvm::BasicBlock* BB = Builder->GetInsertBlock();
+    llvm::BasicBlock* BB = CI.Builder->GetInsertBlock();
     if (BB && BB->getTerminator())
       break;
   }
@@ -611,24 +2266,303 @@ inline auto BlockExpr::codegen() -> llvm::Value*
   return Last;
 }
 
-auto ReturnExpr::codegen() -> llvm::Value*
+inline auto FPModeExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::IRBuilderBase::FastMathFlagGuard Guard(*CI.Builder);
+  CI.Builder->setFastMathFlags(Flags);
+
+  llvm::Value* V = Body->codegen(CI);
+  Unsigned       = Body->isUnsigned();
+  return V;
+}
+
+inline auto ArrayExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  std::vector<llvm::Value*> Vals;
+  llvm::Type*               ElemTy = nullptr;
+  for (auto& E : Elements)
+  {
+    llvm::Value* V = E->codegen(CI);
+    if (!V)
+      return nullptr;
+
+    ElemTy = ElemTy ? getCommonType(ElemTy, V->getType()) : V->getType();
+    if (!ElemTy)
+      return LogErrorV(CI, "Array literal elements have incompatible types");
+    Vals.push_back(V);
+    Unsigned |= E->isUnsigned();
+  }
+
+  for (unsigned i = 0; i != Vals.size(); ++i)
+  {
+    llvm::Value*& V = Vals[i];
+    if (V->getType() != ElemTy &&
+        !(V = promoteValue(CI, V, V->getType(), ElemTy, Elements[i]->isUnsigned())))
+      return nullptr;
+  }
+
+  if (RepeatCount)
+    Vals.assign(*RepeatCount, Vals.front());
+
+  auto* ArrTy = llvm::cast<llvm::ArrayType>(MARE_ARRAY_TYPE(ElemTy, Vals.size()));
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  // Literals of constants fold into one constant aggregate.
+  if (std::all_of(Vals.begin(), Vals.end(), [](Value* V) { return llvm::isa<Constant>(V); }))
+  {
+    std::vector<Constant*> Consts;
+    for (Value* V : Vals)
+      Consts.push_back(llvm::cast<Constant>(V));
+    return llvm::ConstantArray::get(ArrTy, Consts);
+  }
+
+  llvm::Value* Agg = llvm::PoisonValue::get(ArrTy);
+  for (unsigned i = 0; i != Vals.size(); ++i)
+    Agg = CI.Builder->CreateInsertValue(Agg, Vals[i], i);
+  return Agg;
+}
+
+inline auto VectorExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  auto*       VT     = llvm::cast<llvm::FixedVectorType>(VecType);
+  llvm::Type* ElemTy = VT->getElementType();
+
+  std::vector<llvm::Value*> Vals;
+  for (auto& E : Lanes)
+  {
+    llvm::Value* V = E->codegen(CI);
+    if (!V)
+      return nullptr;
+
+    // `vec<f32, 8>(v)` converts a whole vector lane by lane.
+    if (V->getType()->isVectorTy() && Lanes.size() == 1)
+      return convertValue(CI, V, E->isUnsigned(), VT, Unsigned);
+
+    if (V->getType() != ElemTy &&
+        !(V = promoteValue(CI, V, V->getType(), ElemTy, E->isUnsigned())))
+      return nullptr;
+    Vals.push_back(V);
+  }
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  if (Vals.size() == 1)
+    return CI.Builder->CreateVectorSplat(VT->getNumElements(), Vals.front(), "splat");
+
+  if (std::all_of(Vals.begin(), Vals.end(), [](Value* V) { return llvm::isa<Constant>(V); }))
+  {
+    std::vector<Constant*> Consts;
+    for (Value* V : Vals)
+      Consts.push_back(llvm::cast<Constant>(V));
+    return llvm::ConstantVector::get(Consts);
+  }
+
+  llvm::Value* Vec = llvm::PoisonValue::get(VT);
+  for (unsigned i = 0; i != Vals.size(); ++i)
+    Vec = CI.Builder->CreateInsertElement(Vec, Vals[i], CI.Builder->getInt64(i));
+  return Vec;
+}
+
+inline auto StructExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  if (Fields.empty())
+    return Constant::getNullValue(Ty);
+
+  std::vector<llvm::Value*> Vals;
+  for (unsigned i = 0; i != Fields.size(); ++i)
+  {
+    llvm::Value* V = Fields[i]->codegen(CI);
+    if (!V)
+      return nullptr;
+
+    llvm::Type* FieldTy = Ty->getElementType(i);
+    if (V->getType() != FieldTy)
+    {
+      if (!isScalarType(V->getType()) || !isScalarType(FieldTy))
+        return LogErrorV(CI, "Struct constructor value does not match the field type");
+      if (!(V = promoteValue(CI, V, V->getType(), FieldTy, Fields[i]->isUnsigned())))
+        return nullptr;
+    }
+    Vals.push_back(V);
+  }
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  if (std::all_of(Vals.begin(), Vals.end(), [](Value* V) { return llvm::isa<Constant>(V); }))
+  {
+    std::vector<Constant*> Consts;
+    for (Value* V : Vals)
+      Consts.push_back(llvm::cast<Constant>(V));
+    return llvm::ConstantStruct::get(Ty, Consts);
+  }
+
+  llvm::Value* Agg = llvm::PoisonValue::get(Ty);
+  for (unsigned i = 0; i != Vals.size(); ++i)
+    Agg = CI.Builder->CreateInsertValue(Agg, Vals[i], i);
+  return Agg;
+}
+
+inline auto CastExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Value* V = Operand->codegen(CI);
+  if (!V)
+    return nullptr;
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return convertValue(CI, V, Operand->isUnsigned(), DestType, Unsigned);
+}
+
+inline auto IndexExpr::codegenAddress(CompilerInstance& CI) -> Address
 {
+  Address Storage = MaterializeAddress(CI, *Base);
+  if (!Storage)
+    return {};
+
+  auto View = ViewElements(CI, Storage);
+  if (!View)
+    return LogErrorV(CI, "Only arrays and slices can be indexed"), Address{};
+  ThroughPointer = !IsLocalStorage(View->Data);
+  Unsigned       = Base->isUnsigned();
+
+  llvm::Value* Idx = Index->codegen(CI);
+  if (!Idx)
+    return {};
+  if (!Idx->getType()->isIntegerTy())
+    return LogErrorV(CI, "Array index must be an integer"), Address{};
+  Idx = CI.Builder->CreateIntCast(Idx, MARE_INT64_TYPE, !Index->isUnsigned(), "idx");
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return ElementAddress(CI, *View, Idx);
+}
+
+inline auto IndexExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  Address Elem = codegenAddress(CI);
+  if (!Elem)
+    return nullptr;
+  return LoadAddress(CI, Elem, "elem");
+}
+
+// `len` is never a field (see Types::DeclareStruct) and has no storage.
+inline auto MemberExpr::codegenAddress(CompilerInstance& CI) -> Address
+{
+  if (Member == "len")
+    return {};
+
+  Address Storage = Base->codegenAddress(CI);
+  if (!Storage)
+    return {};
+  Unsigned = Types::IsUnsignedField(CI, Storage.Ty, Member);
+  return FieldAddress(CI, Storage, Member);
+}
+
+inline auto MemberExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  Address Storage = MaterializeAddress(CI, *Base);
+  if (!Storage)
+    return nullptr;
+
+  // Load just the field, so an SoA loop only touches the field arrays it uses.
+  if (Member != "len")
+  {
+    Address Field = FieldAddress(CI, Storage, Member);
+    if (!Field)
+      return nullptr;
+    Unsigned = Types::IsUnsignedField(CI, Storage.Ty, Member);
+    CI.fileCoords.UpdateCodegenCoords();
+    return LoadAddress(CI, Field, Member);
+  }
+
+  auto View = ViewElements(CI, Storage);
+  if (!View)
+    return LogErrorV(CI, "'.len' expects an array or a slice");
+  return View->Len;
+}
+
+inline auto NewSliceExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Value* Len = Count->codegen(CI);
+  if (!Len)
+    return nullptr;
+  if (!Len->getType()->isIntegerTy())
+    return LogErrorV(CI, "Slice length must be an integer");
+  Len = CI.Builder->CreateIntCast(Len, MARE_INT64_TYPE, !Count->isUnsigned(), "len");
+
+  // The module has no DataLayout yet; sizeof folds once the target is known.
+  const StructInfo* S        = Types::FindStruct(CI, ElemType);
+  llvm::Constant*   ElemSize = S && S->SoA ? CI.Builder->getInt64(S->SoAStride)
+                                           : llvm::ConstantExpr::getSizeOf(ElemType);
+
+  llvm::Value* Bytes = CI.Builder->CreateMul(Len, ElemSize, "bytes", /*HasNUW=*/true,
+                                             /*HasNSW=*/true);
+  llvm::Value* Data  = CI.Builder->CreateCall(GetAllocFunction(CI), Bytes, "data");
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  return MakeSlice(CI, Types::GetSliceType(CI, ElemType), Data, Len);
+}
+
+inline auto DeleteExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  llvm::Value* Slice = Operand->codegen(CI);
+  if (!Slice)
+    return nullptr;
+  if (!Types::IsSliceType(CI, Slice->getType()))
+    return LogErrorV(CI, "'delete' expects a slice");
+
+  CI.fileCoords.UpdateCodegenCoords();
+
+  llvm::Value* Data = CI.Builder->CreateExtractValue(Slice, 0, "data");
+  return CI.Builder->CreateCall(GetFreeFunction(CI), Data);
+}
+
+auto ReturnExpr::codegen(CompilerInstance& CI) -> llvm::Value*
+{
+  if (CI.InParallelBody)
+    return LogErrorV(CI, "'ret' cannot leave a 'pfor'; use 'continue' to end an iteration");
+
+  // The generators driven by the loops `ret` leaves are destroyed on the way out,
+  // after the returned value, which may read what they yielded, is computed.
+  auto DestroyGenerators = [&CI]
+  {
+    for (auto L = CI.Loops.rbegin(); L != CI.Loops.rend(); ++L)
+      if (L->Generator)
+        Coro::Destroy(CI, L->Generator);
+  };
+
+  // Returning from a generator finishes it: the consumer's loop ends.
+  if (CI.Generator)
+  {
+    if (Exp)
+      return LogErrorV(CI, "'ret' in a 'gen fn' takes no value; use 'yield' to produce values");
+    DestroyGenerators();
+    return CI.Builder->CreateBr(CI.Generator->Final);
+  }
 
   if (Exp)
   {
-    llvm::Value* RetVal = Exp->codegen();
+    llvm::Value* RetVal = Exp->codegen(CI);
     if (!RetVal)
       return nullptr;
 
-    Global::UpdateCodegenCoords();
+    llvm::Type* RetType = CI.Builder->GetInsertBlock()->getParent()->getReturnType();
+    if (!(RetVal = coerceTuple(CI, RetVal, RetType, Exp->isUnsigned())))
+      return nullptr;
+
+    CI.fileCoords.UpdateCodegenCoords();
 
-    return Builder->CreateRet(RetVal);
+    DestroyGenerators();
+    return CI.Builder->CreateRet(RetVal);
   }
 
-  Global::UpdateCodegenCoords();
+  CI.fileCoords.UpdateCodegenCoords();
 
   // For void return
-  return Builder->CreateRetVoid();
+  DestroyGenerators();
+  return CI.Builder->CreateRetVoid();
 }
 
 } // namespace Mare
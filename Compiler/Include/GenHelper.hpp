@@ -3,9 +3,9 @@
 #include "AST.hpp"
 #include "Parser.hpp"
 
-inline auto LogErrorV(const char* Str) -> Value*
+inline auto LogErrorV(const Mare::CompilerInstance& CI, const char* Str) -> Value*
 {
-  Mare::Err::LogError(Str);
+  Mare::Err::LogError(CI, Str);
   return nullptr;
 }
 
@@ -63,21 +63,26 @@ auto getCommonType(Type* T1, Type* T2) -> Type*
   return (Rank1 >= Rank2) ? T1 : T2;
 }
 
-// Helper function to promote a value to a target type
-auto promoteValue(Value* Val, Type* FromType, Type* ToType) -> Value*
+// Helper function to promote a value to a target type; FromUnsigned integers are
+// zero-extended (and converted to floating point as unsigned)
+auto promoteValue(Mare::CompilerInstance& CI, Value* Val, Type* FromType, Type* ToType,
+                  bool FromUnsigned = false) -> Value*
 {
   if (!Val || !FromType || !ToType)
     return nullptr;
   if (FromType == ToType)
     return Val;
 
+  // A bool converts to 0 or 1, never to -1.
+  FromUnsigned |= FromType->isIntegerTy(1);
+
   // Ensure we're working with supported types
   bool FromSupported = FromType->isIntegerTy() || FromType->isFloatTy() || FromType->isDoubleTy();
   bool ToSupported   = ToType->isIntegerTy() || ToType->isFloatTy() || ToType->isDoubleTy();
 
   if (!FromSupported || !ToSupported)
   {
-    LogErrorV("Unsupported type in value promotion");
+    LogErrorV(CI, "Unsupported type in value promotion");
     return nullptr;
   }
 
@@ -89,45 +94,140 @@ auto promoteValue(Value* Val, Type* FromType, Type* ToType) -> Value*
 
     if (FromBits < ToBits)
     {
-      return Builder->CreateSExt(Val, ToType, "sext");
+      return FromUnsigned ? CI.Builder->CreateZExt(Val, ToType, "zext")
+                          : CI.Builder->CreateSExt(Val, ToType, "sext");
     }
     else if (FromBits > ToBits)
     {
-      return Builder->CreateTrunc(Val, ToType, "trunc");
+      return CI.Builder->CreateTrunc(Val, ToType, "trunc");
     }
     return Val; // Same bit width
   }
 
-  // Integer to float promotion
-  if (FromType->isIntegerTy() && ToType->isFloatTy())
+  // Integer to float/double promotion
+  if (FromType->isIntegerTy() && ToType->isFloatingPointTy())
   {
-    return Builder->CreateSIToFP(Val, ToType, "sitofp");
-  }
-
-  // Integer to double promotion
-  if (FromType->isIntegerTy() && ToType->isDoubleTy())
-  {
-    return Builder->CreateSIToFP(Val, ToType, "sitofp");
+    return FromUnsigned ? CI.Builder->CreateUIToFP(Val, ToType, "uitofp")
+                        : CI.Builder->CreateSIToFP(Val, ToType, "sitofp");
   }
 
   // Float to double promotion
   if (FromType->isFloatTy() && ToType->isDoubleTy())
   {
-    return Builder->CreateFPExt(Val, ToType, "fpext");
+    return CI.Builder->CreateFPExt(Val, ToType, "fpext");
   }
 
   // Double to float demotion (potentially lossy)
   if (FromType->isDoubleTy() && ToType->isFloatTy())
   {
-    return Builder->CreateFPTrunc(Val, ToType, "fptrunc");
+    return CI.Builder->CreateFPTrunc(Val, ToType, "fptrunc");
   }
 
   // Float/double to integer conversion (potentially lossy)
   if (FromType->isFloatingPointTy() && ToType->isIntegerTy())
   {
-    return Builder->CreateFPToSI(Val, ToType, "fptosi");
+    return CI.Builder->CreateFPToSI(Val, ToType, "fptosi");
   }
 
-  LogErrorV("Unsupported type conversion in value promotion");
+  LogErrorV(CI, "Unsupported type conversion in value promotion");
   return nullptr;
 }
+
+inline auto isScalarType(Type* T) -> bool
+{
+  return T->isIntegerTy() || T->isFloatTy() || T->isDoubleTy();
+}
+
+/// CreateCondition - Convert a condition to an i1 by comparing it against zero.
+/// Returns null if V is not a number.
+inline auto CreateCondition(Mare::CompilerInstance& CI, Value* V, const llvm::Twine& Name)
+  -> Value*
+{
+  Type* T = V->getType();
+  if (T->isIntegerTy(1))
+    return V;
+  if (T->isIntegerTy())
+    return CI.Builder->CreateICmpNE(V, ConstantInt::get(T, 0), Name);
+  if (T->isFloatTy() || T->isDoubleTy())
+    return CI.Builder->CreateFCmpONE(V, ConstantFP::get(T, 0.0), Name);
+  return nullptr;
+}
+
+/// coerceTuple - Convert a tuple element by element to the tuple type ToType
+/// (e.g. `ret (0, 1)` in a `-> (i64, i64)` function). Other values pass through.
+inline auto coerceTuple(Mare::CompilerInstance& CI, Value* Val, Type* ToType,
+                        bool FromUnsigned = false) -> Value*
+{
+  auto* From = dyn_cast<StructType>(Val->getType());
+  auto* To   = dyn_cast<StructType>(ToType);
+  if (!From || !To || From == To || !From->isLiteral() || !To->isLiteral())
+    return Val;
+  if (From->getNumElements() != To->getNumElements())
+    return LogErrorV(CI, "Tuple has the wrong number of elements");
+
+  Value* Result = PoisonValue::get(To);
+  for (unsigned i = 0; i != To->getNumElements(); ++i)
+  {
+    Value* Elem = CI.Builder->CreateExtractValue(Val, i);
+    Elem        = promoteValue(CI, Elem, Elem->getType(), To->getElementType(i), FromUnsigned);
+    if (!Elem)
+      return nullptr;
+    Result = CI.Builder->CreateInsertValue(Result, Elem, i);
+  }
+  return Result;
+}
+
+// Helper function to broadcast a scalar into every lane of a vector type
+inline auto splatToVector(Mare::CompilerInstance& CI, Value* Val, Type* VecType,
+                          bool FromUnsigned = false) -> Value*
+{
+  if (!Val || Val->getType() == VecType)
+    return Val;
+
+  auto* VT = dyn_cast<VectorType>(VecType);
+  if (!VT || !isScalarType(Val->getType()))
+  {
+    LogErrorV(CI, "Cannot mix vectors of different types");
+    return nullptr;
+  }
+
+  Value* Elem = promoteValue(CI, Val, Val->getType(), VT->getElementType(), FromUnsigned);
+  if (!Elem)
+    return nullptr;
+  return CI.Builder->CreateVectorSplat(VT->getElementCount(), Elem, "splat");
+}
+
+// Helper function for explicit conversions: scalars, or vectors lane by lane. The
+// source signedness picks sext/zext and sitofp/uitofp, the destination's fptosi/fptoui.
+inline auto convertValue(Mare::CompilerInstance& CI, Value* Val, bool FromUnsigned, Type* ToType,
+                         bool ToUnsigned) -> Value*
+{
+  if (!Val || Val->getType() == ToType)
+    return Val;
+
+  Type* FromType = Val->getType();
+  auto* FromVec  = dyn_cast<FixedVectorType>(FromType);
+  auto* ToVec    = dyn_cast<FixedVectorType>(ToType);
+  if (FromVec && !ToVec)
+    return LogErrorV(CI, "Cannot convert a vector to a scalar; use extract or reduce_*");
+  if (FromVec && FromVec->getNumElements() != ToVec->getNumElements())
+    return LogErrorV(CI, "Vector conversions need the same number of lanes");
+  if (!FromVec && ToVec)
+    return splatToVector(CI, Val, ToType, FromUnsigned);
+
+  Type* From = FromType->getScalarType();
+  Type* To   = ToType->getScalarType();
+  if (!isScalarType(From) || !isScalarType(To))
+    return LogErrorV(CI, "Only numbers (and vectors of them) can be converted");
+
+  FromUnsigned |= From->isIntegerTy(1);
+  if (From->isIntegerTy() && To->isIntegerTy())
+    return CI.Builder->CreateIntCast(Val, ToType, !FromUnsigned, "conv");
+  if (From->isIntegerTy())
+    return FromUnsigned ? CI.Builder->CreateUIToFP(Val, ToType, "uitofp")
+                        : CI.Builder->CreateSIToFP(Val, ToType, "sitofp");
+  if (To->isIntegerTy())
+    return ToUnsigned ? CI.Builder->CreateFPToUI(Val, ToType, "fptoui")
+                      : CI.Builder->CreateFPToSI(Val, ToType, "fptosi");
+  return CI.Builder->CreateFPCast(Val, ToType, "fpconv");
+}
@@ -21,6 +21,7 @@ using i8     = int8_t;
 using i16    = int16_t;
 using i32    = int32_t;
 using i64    = int64_t;
+using u64    = uint64_t;
 using Coords = int;
 
 namespace Mare::Global
@@ -47,21 +48,14 @@ public:
     resetLine();
     resetCol();
   }
-};
-
-static FileCoords fileCoords;
 
-void UpdateCodegenCoords()
-{
-  fileCoords.codegenCoords.line = fileCoords.line;
-  fileCoords.codegenCoords.col  = fileCoords.col;
-}
+  void UpdateCodegenCoords()
+  {
+    codegenCoords.line = line;
+    codegenCoords.col  = col;
+  }
+};
 
 using ValueVariant = std::variant<int8_t, int16_t, int32_t, int64_t, float, double>;
 
-static std::string  IdentifierStr; // Filled in if tok_identifier
-static Token__      NumTok;
-static ValueVariant NumVal;
-static std::string  StringVal;
-static bool         isExtern = false;
 } // namespace Mare::Global
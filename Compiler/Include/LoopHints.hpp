@@ -0,0 +1,172 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Colors.h"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "ErrorHandling.hpp"
+#include <llvm/Analysis/VectorUtils.h>
+#include <llvm/IR/DiagnosticInfo.h>
+
+//===----------------------------------------------------------------------===//
+// Loop Hints
+//
+// Attributes written in front of a loop body steer the loop optimizers:
+//
+//   for i = 0, i < n in @unroll(8) @vectorize(width=8) body
+//
+//   @unroll, @unroll(N), @unroll(full), @unroll(off)  -> llvm.loop.unroll.*
+//   @vectorize, @vectorize(width=N), @vectorize(off)  -> llvm.loop.vectorize.*
+//   @interleave(N)                                    -> llvm.loop.interleave.count
+//   @parallel                                         -> llvm.loop.parallel_accesses
+//
+// @parallel promises that iterations do not depend on each other through
+// memory; every memory access of the body joins the loop's access group.
+// Malformed hints are dropped with a warning, and hints the optimizer could not
+// honor are reported as warnings once the pipeline has run.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::LoopHints
+{
+
+inline auto IsPowerOfTwoUpTo(i64 V, i64 Max) -> bool
+{
+  return V > 0 && V <= Max && (V & (V - 1)) == 0;
+}
+
+/// IsValidHint - Whether A is a loop hint with well-formed arguments.
+inline auto IsValidHint(const Attribute& A) -> bool
+{
+  const auto& Args = A.Args;
+  const bool  Bare = Args.empty();
+  const bool  Flag = Args.size() == 1 && !Args[0].Value; // A lone identifier, e.g. `off`
+
+  if (A.Name == "unroll")
+    return Bare || (Flag && (Args[0].Key == "full" || Args[0].Key == "off")) ||
+           (Args.size() == 1 && Args[0].Key.empty() && *Args[0].Value > 0);
+
+  if (A.Name == "vectorize")
+    return Bare || (Flag && Args[0].Key == "off") ||
+           (Args.size() == 1 && (Args[0].Key.empty() || Args[0].Key == "width") &&
+            Args[0].Value && IsPowerOfTwoUpTo(*Args[0].Value, 64));
+
+  if (A.Name == "interleave")
+    return Args.size() == 1 && Args[0].Key.empty() && IsPowerOfTwoUpTo(*Args[0].Value, 16);
+
+  if (A.Name == "parallel")
+    return Bare;
+
+  return false;
+}
+
+/// Check - The well-formed hints of Attrs; the others are dropped with a warning.
+inline auto Check(const CompilerInstance& CI, const AttributeList& Attrs) -> AttributeList
+{
+  AttributeList Hints;
+  for (const auto& A : Attrs)
+  {
+    if (IsValidHint(A))
+    {
+      Hints.push_back(A);
+      continue;
+    }
+
+    const bool        Known = A.Name == "unroll" || A.Name == "vectorize" ||
+                       A.Name == "interleave" || A.Name == "parallel";
+    const std::string msg   = Known ? "Malformed loop hint '@" + A.Name + "' is ignored"
+                                    : "Unknown loop hint '@" + A.Name + "' is ignored";
+    Err::LogWarning(CI, msg.c_str(),
+                    "use @unroll(N|full|off), @vectorize(width=N|off), @interleave(N) or "
+                    "@parallel; widths and interleave counts are powers of two");
+  }
+  return Hints;
+}
+
+inline auto HintNode(llvm::LLVMContext& Ctx, llvm::StringRef Name, llvm::Constant* Val = nullptr)
+  -> llvm::MDNode*
+{
+  llvm::SmallVector<llvm::Metadata*, 2> Ops = {llvm::MDString::get(Ctx, Name)};
+  if (Val)
+    Ops.push_back(llvm::ConstantAsMetadata::get(Val));
+  return llvm::MDNode::get(Ctx, Ops);
+}
+
+/// Attach - Give the loop from Header to the block of Backedge its llvm.loop
+/// metadata. Call once the body is complete, so @parallel sees every access.
+inline void Attach(CompilerInstance& CI, llvm::Instruction* Backedge, llvm::BasicBlock* Header,
+                   const AttributeList& Hints)
+{
+  if (Hints.empty())
+    return;
+
+  llvm::LLVMContext&                    Ctx = *CI.TheContext;
+  llvm::SmallVector<llvm::Metadata*, 4> Ops = {nullptr}; // The loop ID refers to itself
+
+  for (const auto& A : Hints)
+  {
+    const AttributeArg* Arg = A.Args.empty() ? nullptr : &A.Args.front();
+
+    if (A.Name == "unroll")
+    {
+      if (!Arg)
+        Ops.push_back(HintNode(Ctx, "llvm.loop.unroll.enable"));
+      else if (Arg->Key == "full")
+        Ops.push_back(HintNode(Ctx, "llvm.loop.unroll.full"));
+      else if (Arg->Key == "off")
+        Ops.push_back(HintNode(Ctx, "llvm.loop.unroll.disable"));
+      else
+        Ops.push_back(HintNode(Ctx, "llvm.loop.unroll.count", CI.Builder->getInt32(*Arg->Value)));
+    }
+    else if (A.Name == "vectorize")
+    {
+      const bool Off = Arg && Arg->Key == "off";
+      Ops.push_back(HintNode(Ctx, "llvm.loop.vectorize.enable", CI.Builder->getInt1(!Off)));
+      if (Arg && Arg->Value)
+        Ops.push_back(
+          HintNode(Ctx, "llvm.loop.vectorize.width", CI.Builder->getInt32(*Arg->Value)));
+    }
+    else if (A.Name == "interleave")
+      Ops.push_back(
+        HintNode(Ctx, "llvm.loop.interleave.count", CI.Builder->getInt32(*Arg->Value)));
+    else if (A.Name == "parallel")
+    {
+      // Blocks are appended as they are generated, so the loop is exactly the
+      // run of blocks from its header to its latch.
+      llvm::MDNode* Group = llvm::MDNode::getDistinct(Ctx, {});
+      auto          End   = std::next(Backedge->getParent()->getIterator());
+      for (auto BB = Header->getIterator(); BB != End; ++BB)
+        for (llvm::Instruction& I : *BB)
+          if (I.mayReadOrWriteMemory())
+            I.setMetadata(llvm::LLVMContext::MD_access_group,
+                          llvm::uniteAccessGroups(
+                            I.getMetadata(llvm::LLVMContext::MD_access_group), Group));
+
+      Ops.push_back(llvm::MDNode::get(
+        Ctx, {llvm::MDString::get(Ctx, "llvm.loop.parallel_accesses"), Group}));
+    }
+  }
+
+  llvm::MDNode* LoopID = llvm::MDNode::getDistinct(Ctx, Ops);
+  LoopID->replaceOperandWith(0, LoopID);
+  Backedge->setMetadata(llvm::LLVMContext::MD_loop, LoopID);
+}
+
+/// MissedHintHandler - Reports the loop transformations that were requested
+/// but not performed (see WarnMissedTransformationsPass) as compiler warnings.
+/// Every other diagnostic is left to LLVM's default printer.
+struct MissedHintHandler : llvm::DiagnosticHandler
+{
+  auto handleDiagnostics(const llvm::DiagnosticInfo& DI) -> bool override
+  {
+    if (DI.getKind() != llvm::DK_OptimizationFailure)
+      return false;
+
+    const auto&       Failure = llvm::cast<llvm::DiagnosticInfoOptimizationFailure>(DI);
+    const std::string msg =
+      "In '" + Failure.getFunction().getName().str() + "': " + Failure.getMsg();
+    PRINT_WARNING(msg.c_str());
+    return true;
+  }
+};
+
+} // namespace Mare::LoopHints
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "ErrorHandling.hpp"
+#include "PrimitiveTypes.hpp"
+#include <set>
+
+//===----------------------------------------------------------------------===//
+// Memoization (@memo)
+//
+// A memoized function `f` is split into `f.memo.impl` (the original body) and a
+// new `f` that first looks the argument tuple up in a runtime cache:
+//
+//   f(args):
+//     key = [args as i64 slots]
+//     if __mare_memo_lookup(id, key, N, &out): ret out
+//     r = f.memo.impl(args)
+//     __mare_memo_store(id, "f", key, N, r)
+//     ret r
+//
+// Every existing call (including recursive ones inside the body) is redirected
+// to the wrapper, so recursion turns into dynamic programming for free. The
+// cache is not observable by the program, but it is memory: `f` and everything
+// that reaches it may access inaccessible memory on top of their own effects.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Memo
+{
+
+inline auto IsSlotType(llvm::Type* T) -> bool
+{
+  return T->isIntegerTy() || T->isFloatTy() || T->isDoubleTy();
+}
+
+/// ToSlot - Bit-preserving conversion of a scalar into a 64 bit key/value slot.
+inline auto ToSlot(CompilerInstance& CI, llvm::Value* V) -> llvm::Value*
+{
+  llvm::Type* T = V->getType();
+  if (T->isFloatTy())
+    V = CI.Builder->CreateBitCast(V, MARE_INT32_TYPE);
+  else if (T->isDoubleTy())
+    return CI.Builder->CreateBitCast(V, MARE_INT64_TYPE);
+  return CI.Builder->CreateZExt(V, MARE_INT64_TYPE, "slot");
+}
+
+/// FromSlot - Inverse of ToSlot.
+inline auto FromSlot(CompilerInstance& CI, llvm::Value* Slot, llvm::Type* T) -> llvm::Value*
+{
+  if (T->isDoubleTy())
+    return CI.Builder->CreateBitCast(Slot, T);
+  if (T->isFloatTy())
+    return CI.Builder->CreateBitCast(CI.Builder->CreateTrunc(Slot, MARE_INT32_TYPE), T);
+  return CI.Builder->CreateTrunc(Slot, T, "unslot");
+}
+
+inline auto GetRuntimeFunctions(CompilerInstance& CI)
+  -> std::pair<llvm::Function*, llvm::Function*>
+{
+  llvm::Module& M = *CI.TheModule;
+
+  llvm::Type* PtrTy = llvm::PointerType::getUnqual(MARE_INT64_TYPE);
+
+  auto* LookupTy = llvm::FunctionType::get(
+    MARE_INT8_TYPE, {MARE_INT32_TYPE, PtrTy, MARE_INT32_TYPE, PtrTy}, false);
+  auto* StoreTy = llvm::FunctionType::get(
+    MARE_VOID_TYPE,
+    {MARE_INT32_TYPE, llvm::PointerType::getUnqual(MARE_INT8_TYPE), PtrTy, MARE_INT32_TYPE,
+     MARE_INT64_TYPE},
+    false);
+
+  auto* Lookup = llvm::cast<llvm::Function>(
+    M.getOrInsertFunction(__MARE_MEMO_LOOKUP_FN__, LookupTy).getCallee());
+  auto* Store = llvm::cast<llvm::Function>(
+    M.getOrInsertFunction(__MARE_MEMO_STORE_FN__, StoreTy).getCallee());
+
+  // The tables are runtime-private state; the key/out buffers are arguments.
+  for (llvm::Function* RT : {Lookup, Store})
+  {
+    RT->setOnlyAccessesInaccessibleMemOrArgMem();
+    RT->setDoesNotThrow();
+  }
+
+  return {Lookup, Store};
+}
+
+/// CanMemoize - Pure, non-void, scalar functions with a bounded argument tuple.
+inline auto CanMemoize(llvm::Function* F, std::string& Why) -> bool
+{
+  if (!F->doesNotAccessMemory() || !F->doesNotThrow())
+    Why = "is not pure (annotate it @pure if its side effects do not matter)";
+  else if (!IsSlotType(F->getReturnType()))
+    Why = "must return an integer or floating point value";
+  else if (F->arg_size() > __MARE_MEMO_MAX_ARITY__)
+    Why = "takes more than " + std::to_string(__MARE_MEMO_MAX_ARITY__) + " arguments";
+  else if (std::any_of(F->arg_begin(), F->arg_end(),
+                       [](const llvm::Argument& A) { return !IsSlotType(A.getType()); }))
+    Why = "has an argument that is not an integer or floating point value";
+  else
+    return true;
+  return false;
+}
+
+inline auto EmitWrapper(CompilerInstance& CI, llvm::Function* Impl, unsigned TableId)
+  -> llvm::Function*
+{
+  auto [Lookup, Store] = GetRuntimeFunctions(CI);
+
+  const std::string   Name = Impl->getName().str();
+  llvm::FunctionType* FT   = Impl->getFunctionType();
+  const unsigned      Ary  = Impl->arg_size();
+
+  Impl->setName(Name + __MARE_MEMO_IMPL_SUFFIX__);
+  Impl->setLinkage(llvm::Function::InternalLinkage);
+
+  llvm::Function* Wrapper =
+    llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Name, CI.TheModule.get());
+  Impl->replaceAllUsesWith(Wrapper);
+
+  Wrapper->setOnlyAccessesInaccessibleMemory();
+  Wrapper->setDoesNotThrow();
+  if (Impl->hasFnAttribute(llvm::Attribute::WillReturn))
+    Wrapper->addFnAttr(llvm::Attribute::WillReturn);
+
+  BasicBlock* Entry = BasicBlock::Create(*CI.TheContext, "entry", Wrapper);
+  BasicBlock* Hit   = BasicBlock::Create(*CI.TheContext, "memo.hit", Wrapper);
+  BasicBlock* Miss  = BasicBlock::Create(*CI.TheContext, "memo.miss", Wrapper);
+
+  CI.Builder->SetInsertPoint(Entry);
+  llvm::Type*  KeyTy = MARE_ARRAY_TYPE(MARE_INT64_TYPE, std::max(Ary, 1u));
+  llvm::Value* Key   = CI.Builder->CreateAlloca(KeyTy, nullptr, "memo.key");
+  llvm::Value* Out   = CI.Builder->CreateAlloca(MARE_INT64_TYPE, nullptr, "memo.out");
+
+  std::vector<llvm::Value*> Args;
+  for (auto& Arg : Wrapper->args())
+  {
+    unsigned Idx = Arg.getArgNo();
+    Arg.setName(Impl->getArg(Idx)->getName());
+    Args.push_back(&Arg);
+    CI.Builder->CreateStore(ToSlot(CI, &Arg),
+                            CI.Builder->CreateConstInBoundsGEP2_32(KeyTy, Key, 0, Idx));
+  }
+
+  llvm::Value* KeyPtr = CI.Builder->CreateConstInBoundsGEP2_32(KeyTy, Key, 0, 0);
+  llvm::Value* Id     = llvm::ConstantInt::get(MARE_INT32_TYPE, TableId);
+  llvm::Value* Arity  = llvm::ConstantInt::get(MARE_INT32_TYPE, Ary);
+
+  llvm::Value* Found = CI.Builder->CreateCall(Lookup, {Id, KeyPtr, Arity, Out}, "memo.found");
+  llvm::Value* IsHit = CI.Builder->CreateICmpNE(Found, llvm::ConstantInt::get(MARE_INT8_TYPE, 0));
+  CI.Builder->CreateCondBr(IsHit, Hit, Miss);
+
+  CI.Builder->SetInsertPoint(Hit);
+  llvm::Value* Cached = CI.Builder->CreateLoad(MARE_INT64_TYPE, Out, "memo.cached");
+  CI.Builder->CreateRet(FromSlot(CI, Cached, FT->getReturnType()));
+
+  CI.Builder->SetInsertPoint(Miss);
+  llvm::Value* Result  = CI.Builder->CreateCall(Impl, Args, "memo.result");
+  llvm::Value* NameStr = CI.Builder->CreateGlobalStringPtr(Name, ".memo.name");
+  CI.Builder->CreateCall(Store, {Id, NameStr, KeyPtr, Arity, ToSlot(CI, Result)});
+  CI.Builder->CreateRet(Result);
+
+  verifyFunction(*Wrapper);
+  return Wrapper;
+}
+
+/// AddCacheAccess - Attribute inference ran before the wrappers existed, so a
+/// caller of Wrapper may claim memory(none) although it now reaches the cache.
+/// Widen every transitive caller (the impl included) to inaccessible memory.
+inline void AddCacheAccess(llvm::Function* Wrapper)
+{
+  std::set<llvm::Function*>    Seen{Wrapper};
+  std::vector<llvm::Function*> Work{Wrapper};
+  while (!Work.empty())
+  {
+    llvm::Function* F = Work.back();
+    Work.pop_back();
+    for (llvm::User* U : F->users())
+    {
+      auto* Call = llvm::dyn_cast<llvm::CallBase>(U);
+      if (!Call || Call->getCalledFunction() != F)
+        continue;
+
+      llvm::Function* Caller = Call->getFunction();
+      if (!Seen.insert(Caller).second)
+        continue;
+      Caller->setMemoryEffects(Caller->getMemoryEffects() |
+                               llvm::MemoryEffects::inaccessibleMemOnly());
+      Work.push_back(Caller);
+    }
+  }
+}
+
+/// EmitMemoWrappers - Run after attribute inference, which decides purity. All
+/// wrappers are in place before any caller is widened, so one memoized function
+/// calling another is still seen as pure.
+inline void EmitMemoWrappers(CompilerInstance& CI)
+{
+  std::vector<llvm::Function*> Wrappers;
+  unsigned                     TableId = 0;
+  for (const auto& Name : CI.MemoFunctions)
+  {
+    llvm::Function* F = CI.TheModule->getFunction(Name);
+    if (!F)
+      continue;
+
+    std::string Why;
+    if (!CanMemoize(F, Why))
+    {
+      const std::string msg = "'@memo' on '" + Name + "' is ignored: function " + Why;
+      Err::LogWarning(CI, msg.c_str());
+      continue;
+    }
+
+    if (TableId >= __MARE_MEMO_MAX_TABLES__)
+    {
+      const std::string msg = "'@memo' on '" + Name + "' is ignored: too many memoized functions";
+      Err::LogWarning(CI, msg.c_str());
+      continue;
+    }
+
+    Wrappers.push_back(EmitWrapper(CI, F, TableId++));
+  }
+
+  for (llvm::Function* Wrapper : Wrappers)
+    AddCacheAccess(Wrapper);
+}
+
+} // namespace Mare::Memo
@@ -3,24 +3,27 @@
 #include "CmdLineParser.hpp"
 #include "Compiler.hpp"
 #include "ErrorHandling.hpp"
+#include "CompilerInstance.hpp"
+#include "FastMath.hpp"
+#include "LoopHints.hpp"
 #include "PrimitiveTypes.hpp"
 #include "Tokenizer.hpp"
+#include "Types.hpp"
 #include <llvm/IR/DerivedTypes.h>
+#include <set>
 
 using namespace Mare::Err;
 
 namespace Mare::Parser
 {
 
-/// BinopPrecedence - This holds the precedence for each binary operator that is
-/// defined.
-static std::map<char, int> BinopPrecedence;
+static auto ParseExpression(CompilerInstance& CI) -> std::unique_ptr<Expr>;
+static auto ParseBlock(CompilerInstance& CI) -> std::unique_ptr<Expr>;
+static auto ParseReturnExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>;
+static auto ParseUnary(CompilerInstance& CI) -> std::unique_ptr<Expr>;
+static auto ParseAttributes(CompilerInstance& CI) -> AttributeList;
 
-static auto ParseExpression() -> std::unique_ptr<Expr>;
-static auto ParseBlock() -> std::unique_ptr<Expr>;
-static auto ParseReturnExpr() -> std::unique_ptr<Expr>;
-
-inline auto extractPrecedence() -> std::optional<unsigned>
+inline auto extractPrecedence(CompilerInstance& CI) -> std::optional<unsigned>
 {
   return std::visit(
     [](auto&& val) -> std::optional<unsigned>
@@ -43,256 +46,1093 @@ inline auto extractPrecedence() -> std::optional<unsigned>
       }
       return std::nullopt;
     },
-    Global::NumVal);
+    CI.NumVal);
 }
 
 /// GetTokPrecedence - Get the precedence of the pending binary operator token.
-static auto GetTokPrecedence() -> int
+static auto GetTokPrecedence(CompilerInstance& CI) -> int
 {
-  if (!Tokenizer::IsCurTokAscii())
+  // Make sure it's a declared binop (an ASCII character or `<<`, `>>`, ...).
+  auto It = CI.BinopPrecedence.find(CI.CurTok);
+  if (It == CI.BinopPrecedence.end() || It->second <= 0)
     return -1;
+  return It->second;
+}
 
-  // Make sure it's a declared binop.
-  int TokPrec = BinopPrecedence[Tokenizer::CurTok];
-  if (TokPrec <= 0)
-    return -1;
-  return TokPrec;
+static auto ParseType(CompilerInstance& CI, bool* Unsigned = nullptr) -> llvm::Type*;
+
+/// vectortype ::= 'vec' '<' type ',' number '>'
+static auto ParseVectorType(CompilerInstance& CI, bool* Unsigned = nullptr) -> llvm::Type*
+{
+  Tokenizer::getNextToken(CI); // eat 'vec'
+  if (CI.CurTok != '<')
+    return LogErrorP(CI, "Expected '<' after 'vec'"), nullptr;
+  Tokenizer::getNextToken(CI); // eat '<'
+
+  llvm::Type* Elem = ParseType(CI, Unsigned);
+  if (!Elem || !(Elem->isIntegerTy() || Elem->isFloatingPointTy()))
+    return LogErrorP(CI, "Expected an integer or floating point lane type in 'vec<...>'"), nullptr;
+
+  if (CI.CurTok != ARG_DELIM_PROTO)
+    return LogErrorP(CI, "Expected ',' and a lane count in 'vec<...>'"), nullptr;
+  Tokenizer::getNextToken(CI); // eat ','
+
+  if (CI.CurTok != tok_number || Util::ValueAsInt(CI.NumVal) <= 0)
+    return LogErrorP(CI, "Expected a positive lane count in 'vec<...>'"), nullptr;
+  llvm::Type* T = MARE_VECTOR_TYPE(Elem, Util::ValueAsInt(CI.NumVal));
+  Tokenizer::getNextToken(CI); // eat lane count
+
+  if (CI.CurTok != '>')
+    return LogErrorP(CI, "Expected '>' to close 'vec<...>'"), nullptr;
+  Tokenizer::getNextToken(CI); // eat '>'
+  return T;
+}
+
+/// tupletype ::= '(' type (',' type)+ ')'
+/// Lowers to a literal struct; the tuple is unsigned when all its elements are.
+static auto ParseTupleType(CompilerInstance& CI, bool* Unsigned) -> llvm::Type*
+{
+  Tokenizer::getNextToken(CI); // eat '('
+
+  std::vector<llvm::Type*> Elems;
+  bool                     AllUnsigned = true;
+  while (true)
+  {
+    bool        ElemUnsigned = false;
+    llvm::Type* Elem         = ParseType(CI, &ElemUnsigned);
+    if (!Elem || Elem->isVoidTy())
+      return LogErrorP(CI, "Expected an element type in the tuple type"), nullptr;
+    Elems.push_back(Elem);
+    AllUnsigned &= ElemUnsigned;
+
+    if (CI.CurTok == RIGHT_PAREN)
+      break;
+    if (CI.CurTok != ARG_DELIM_PROTO)
+      return LogErrorP(CI, "Expected ',' or ')' in the tuple type"), nullptr;
+    Tokenizer::getNextToken(CI); // eat ','
+  }
+  Tokenizer::getNextToken(CI); // eat ')'
+
+  if (Elems.size() < 2)
+    return LogErrorP(CI, "A tuple type needs at least two elements"), nullptr;
+
+  *Unsigned = AllUnsigned;
+  return llvm::StructType::get(*CI.TheContext, Elems);
+}
+
+/// type
+///   ::= 'void' | 'double' | 'flt' | 'int' | 'i32' | 'i16' | 'i8' | 'string' | 'bool'
+///   ::= 'u64' | 'u32' | 'u16' | 'u8'
+///   ::= '[' type ']'               (slice)
+///   ::= '[' type ';' number ']'    (fixed-size array)
+///   ::= vectortype                 (SIMD vector)
+///   ::= tupletype                  (first-class struct)
+///   ::= id                         (declared struct)
+/// Returns null without a diagnostic if CurTok does not start a type. *Unsigned
+/// is set if the type (or its element type) is one of u8..u64.
+static auto ParseType(CompilerInstance& CI, bool* Unsigned) -> llvm::Type*
+{
+  bool IsUnsigned = false;
+  if (!Unsigned)
+    Unsigned = &IsUnsigned;
+  *Unsigned = false;
+
+  if (CI.CurTok == tok_vec)
+    return ParseVectorType(CI, Unsigned);
+
+  if (CI.CurTok == LEFT_PAREN)
+    return ParseTupleType(CI, Unsigned);
+
+  if (CI.CurTok == tok_identifier)
+  {
+    const StructInfo* S = Types::FindStruct(CI, CI.IdentifierStr);
+    if (S)
+      Tokenizer::getNextToken(CI); // eat the struct name
+    return S ? S->Ty : nullptr;
+  }
+
+  if (CI.CurTok != '[')
+  {
+    llvm::Type* T = Util::ParseReturnTypeProto(CI, CI.CurTok);
+    *Unsigned     = Util::IsUnsignedTypeToken(CI.CurTok);
+    if (T)
+      Tokenizer::getNextToken(CI); // eat the type
+    return T;
+  }
+
+  Tokenizer::getNextToken(CI); // eat '['
+  llvm::Type* Elem = ParseType(CI, Unsigned);
+  if (!Elem || Elem->isVoidTy())
+    return LogErrorP(CI, "Expected an element type after '['"), nullptr;
+
+  llvm::Type* T = nullptr;
+  if (CI.CurTok == STATEMENT_DELIM)
+  {
+    Tokenizer::getNextToken(CI); // eat ';'
+    if (CI.CurTok != tok_number || Util::ValueAsInt(CI.NumVal) <= 0)
+      return LogErrorP(CI, "Expected a positive array length after ';'"), nullptr;
+    T = MARE_ARRAY_TYPE(Elem, Util::ValueAsInt(CI.NumVal));
+    Tokenizer::getNextToken(CI); // eat length
+  }
+  else
+    T = Types::GetSliceType(CI, Elem);
+
+  if (CI.CurTok != ']')
+    return LogErrorP(CI, "Expected ']' to close the type"), nullptr;
+  Tokenizer::getNextToken(CI); // eat ']'
+  return T;
 }
 
 /// numberexpr ::= number (must ensure that the CurTok is tok_number !!)
-static auto ParseNumberExpr() -> std::unique_ptr<Expr>
+static auto ParseNumberExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  llvm::Type* numType = Tokenizer::assignDTypeToNumExpr();
+  llvm::Type* numType = Tokenizer::assignDTypeToNumExpr(CI);
 
   if (numType == nullptr)
-    return LogError("Unknown numeric token type");
+    return LogError(CI, "Unknown numeric token type");
 
-  auto Result = std::make_unique<NumberExpr>(Global::NumVal, numType);
-  Tokenizer::getNextToken(); // consume the number
+  auto Result = std::make_unique<NumberExpr>(CI.NumVal, numType);
+  Tokenizer::getNextToken(CI); // consume the number
 
   return Result;
 }
 
 /// parenexpr ::= '(' expression ')'
-static auto ParseParenExpr() -> std::unique_ptr<Expr>
+///   ::= '(' expression (',' expression)+ ')'
+static auto ParseParenExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  Tokenizer::getNextToken(); // eat (.
-  auto V = ParseExpression();
+  Tokenizer::getNextToken(CI); // eat (.
+  auto V = ParseExpression(CI);
   if (!V)
     return nullptr;
 
-  if (Tokenizer::CurTok != RIGHT_PAREN)
-    return LogError("expected ')'");
-  Tokenizer::getNextToken(); // eat ).
+  if (CI.CurTok == ARG_DELIM_PROTO)
+  {
+    std::vector<std::unique_ptr<Expr>> Elements;
+    Elements.push_back(std::move(V));
+    while (CI.CurTok == ARG_DELIM_PROTO)
+    {
+      Tokenizer::getNextToken(CI); // eat ','
+      auto E = ParseExpression(CI);
+      if (!E)
+        return nullptr;
+      Elements.push_back(std::move(E));
+    }
+    V = std::make_unique<TupleExpr>(std::move(Elements));
+  }
+
+  if (CI.CurTok != RIGHT_PAREN)
+    return LogError(CI, "expected ')'");
+  Tokenizer::getNextToken(CI); // eat ).
   return V;
 }
 
+/// IsReduceOp - Whether the current token starts `reduce(op, ...)`.
+inline auto IsReduceOp(const CompilerInstance& CI) -> bool
+{
+  if (CI.CurTok == tok_identifier)
+    return CI.IdentifierStr == "min" || CI.IdentifierStr == "max";
+  return CI.CurTok == '+' || CI.CurTok == '*' || CI.CurTok == '&' || CI.CurTok == '|' ||
+         CI.CurTok == '^';
+}
+
+/// reduceexpr ::= 'reduce' '(' reduceop ',' identifier ('=' | 'in') expression '..' expression
+///                attributes ',' expression (',' ('ordered' | 'reassoc'))? ')'
+/// reduceop   ::= '+' | '*' | '&' | '|' | '^' | 'min' | 'max'
+/// Called at the operator; `reduce`, `ordered` and `reassoc` are only keywords here.
+static auto ParseReduceExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  char Op = Tokenizer::CurTokChar(CI);
+  if (CI.CurTok == tok_identifier)
+    Op = CI.IdentifierStr == "min" ? '<' : '>';
+  Tokenizer::getNextToken(CI); // eat the operator.
+
+  if (CI.CurTok != ',')
+    return LogError(CI, "Expected ',' after the operator of 'reduce'");
+  if (Tokenizer::getNextToken(CI) != tok_identifier)
+    return LogError(CI, "Expected the variable of the 'reduce' range");
+  std::string VarName = CI.IdentifierStr;
+
+  Tokenizer::getNextToken(CI); // eat identifier.
+  if (CI.CurTok != '=' && CI.CurTok != tok_in)
+    return LogError(CI, "Expected '=' after the variable of 'reduce'");
+  Tokenizer::getNextToken(CI); // eat '=' / 'in'.
+
+  auto Start = ParseExpression(CI);
+  if (!Start)
+    return nullptr;
+  if (CI.CurTok != tok_dotdot)
+    return LogError(CI, "Expected '..' in the range of 'reduce'");
+  Tokenizer::getNextToken(CI); // eat '..'.
+  auto End = ParseExpression(CI);
+  if (!End)
+    return nullptr;
+
+  auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+  if (CI.CurTok != ',')
+    return LogError(CI, "Expected ',' after the range of 'reduce'");
+  Tokenizer::getNextToken(CI); // eat ','.
+
+  auto Body = ParseExpression(CI);
+  if (!Body)
+    return nullptr;
+
+  // The reassociation contract; floating point folds follow the mode by default.
+  std::optional<bool> Reassoc;
+  if (CI.CurTok == ',')
+  {
+    Tokenizer::getNextToken(CI); // eat ','.
+    if (CI.CurTok != tok_identifier ||
+        (CI.IdentifierStr != "ordered" && CI.IdentifierStr != "reassoc"))
+      return LogError(CI, "Expected 'ordered' or 'reassoc' at the end of 'reduce'");
+    Reassoc = CI.IdentifierStr == "reassoc";
+    Tokenizer::getNextToken(CI); // eat the contract.
+  }
+
+  if (CI.CurTok != RIGHT_PAREN)
+    return LogError(CI, "Expected ')' at the end of 'reduce'");
+  Tokenizer::getNextToken(CI); // eat ')'.
+
+  return std::make_unique<ReduceExpr>(Op, std::move(VarName), std::move(Start), std::move(End),
+                                      std::move(Body), std::move(Hints), Reassoc);
+}
+
 /// identifierexpr
 ///   ::= identifier
 ///   ::= identifier '(' expression* ')'
-static auto ParseIdentifierExpr() -> std::unique_ptr<Expr>
+///   ::= reduceexpr
+static auto ParseIdentifierExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  std::string IdName = Global::IdentifierStr;
+  std::string IdName = CI.IdentifierStr;
 
-  Tokenizer::getNextToken(); // eat identifier.
+  Tokenizer::getNextToken(CI); // eat identifier.
 
-  if (Tokenizer::CurTok != LEFT_PAREN) // Simple variable ref.
+  if (CI.CurTok != LEFT_PAREN) // Simple variable ref.
     return std::make_unique<VariableExpr>(IdName);
 
+  const StructInfo* Struct = Types::FindStruct(CI, IdName);
+
   // Call.
-  Tokenizer::getNextToken(); // eat (
+  Tokenizer::getNextToken(CI); // eat (
+  if (IdName == "reduce" && IsReduceOp(CI))
+    return ParseReduceExpr(CI);
+
   std::vector<std::unique_ptr<Expr>> Args;
-  if (Tokenizer::CurTok != RIGHT_PAREN)
+  if (CI.CurTok != RIGHT_PAREN)
   {
     while (true)
     {
-      if (auto Arg = ParseExpression())
+      if (auto Arg = ParseExpression(CI))
         Args.push_back(std::move(Arg));
       else
         return nullptr;
 
-      if (Tokenizer::CurTok == RIGHT_PAREN)
+      if (CI.CurTok == RIGHT_PAREN)
         break;
 
-      if (Tokenizer::CurTok != ARG_DELIM_PROTO)
-        return LogError("Expected ')' or ',' in argument list.");
-      Tokenizer::getNextToken();
+      if (CI.CurTok != ARG_DELIM_PROTO)
+        return LogError(CI, "Expected ')' or ',' in argument list.");
+      Tokenizer::getNextToken(CI);
     }
   }
 
   // Eat the ')'.
-  Tokenizer::getNextToken();
+  Tokenizer::getNextToken(CI);
+
+  if (Struct)
+  {
+    if (!Args.empty() && Args.size() != Struct->Fields.size())
+      return LogError(CI, "A struct constructor takes no values or one value per field");
+    return std::make_unique<StructExpr>(Struct->Ty, std::move(Args));
+  }
 
   return std::make_unique<CallExpr>(IdName, std::move(Args));
 }
 
 /// ifexpr ::= 'if' expression 'then' expression 'else' expression
-static auto ParseIfExpr() -> std::unique_ptr<Expr>
+static auto ParseIfExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  Tokenizer::getNextToken(); // eat the if.
+  Tokenizer::getNextToken(CI); // eat the if.
 
   // condition.
-  auto Cond = ParseExpression();
+  auto Cond = ParseExpression(CI);
   if (!Cond)
     return nullptr;
 
-  if (Tokenizer::CurTok != tok_then)
-    return LogError("Expected the keyword \"then\".");
-  Tokenizer::getNextToken(); // eat the then
+  if (CI.CurTok != tok_then)
+    return LogError(CI, "Expected the keyword \"then\".");
+  Tokenizer::getNextToken(CI); // eat the then
 
-  auto Then = ParseExpression();
+  auto Then = ParseExpression(CI);
   if (!Then)
     return nullptr;
 
-  if (Tokenizer::CurTok != tok_else)
-    return LogError("Expected the keyword \"else\".");
+  if (CI.CurTok != tok_else)
+    return LogError(CI, "Expected the keyword \"else\".");
 
-  Tokenizer::getNextToken();
+  Tokenizer::getNextToken(CI);
 
-  auto Else = ParseExpression();
+  auto Else = ParseExpression(CI);
   if (!Else)
     return nullptr;
 
   return std::make_unique<IfExpr>(std::move(Cond), std::move(Then), std::move(Else));
 }
 
-/// forexpr ::= 'for' identifier '=' expr ',' expr (',' expr)? 'in' expression
-static auto ParseForExpr() -> std::unique_ptr<Expr>
+/// The rest of `for i in start..end step s body`, after the start.
+static auto ParseRangeForTail(CompilerInstance& CI, const std::string& IdName,
+                              std::unique_ptr<Expr> Start) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat '..'.
+
+  auto End = ParseExpression(CI);
+  if (!End)
+    return nullptr;
+
+  // `step` is only a keyword here, so it stays usable as a name elsewhere.
+  std::unique_ptr<Expr> Step;
+  if (CI.CurTok == tok_identifier && CI.IdentifierStr == "step")
+  {
+    Tokenizer::getNextToken(CI); // eat 'step'.
+    Step = ParseExpression(CI);
+    if (!Step)
+      return nullptr;
+  }
+
+  auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+  auto Body  = ParseExpression(CI);
+  if (!Body)
+    return nullptr;
+
+  return std::make_unique<RangeForExpr>(IdName, std::move(Start), std::move(End), std::move(Step),
+                                        std::move(Body), std::move(Hints));
+}
+
+/// matchexpr ::= 'match' expression '{' (matcharm ';'?)* '}'
+/// matcharm  ::= ('_' | pattern (',' pattern)*) '=>' expression
+/// pattern   ::= expression ('..' expression)?
+static auto ParseMatchExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  Tokenizer::getNextToken(); // eat the for.
+  Tokenizer::getNextToken(CI); // eat 'match'.
 
-  if (Tokenizer::CurTok != tok_identifier)
-    return LogError("Expected identifier after 'for'.");
+  auto Scrutinee = ParseExpression(CI);
+  if (!Scrutinee)
+    return nullptr;
 
-  std::string IdName = Global::IdentifierStr;
-  Tokenizer::getNextToken(); // eat identifier.
+  if (CI.CurTok != BLOCK_SCOPE_BEGIN)
+    return LogError(CI, "Expected '{' after the value of 'match'");
+  Tokenizer::getNextToken(CI); // eat '{'.
 
-  if (Tokenizer::CurTok != '=')
-    return LogError("Expected '=' after 'for'.");
-  Tokenizer::getNextToken(); // eat '='.
+  std::vector<MatchArm> Arms;
+  while (CI.CurTok != BLOCK_SCOPE_END)
+  {
+    MatchArm Arm;
+    if (CI.CurTok == tok_identifier && CI.IdentifierStr == "_")
+      Tokenizer::getNextToken(CI); // eat '_'.
+    else
+    {
+      while (true)
+      {
+        MatchPattern P;
+        if (!(P.Lo = ParseExpression(CI)))
+          return nullptr;
+        if (CI.CurTok == tok_dotdot)
+        {
+          Tokenizer::getNextToken(CI); // eat '..'.
+          if (!(P.Hi = ParseExpression(CI)))
+            return nullptr;
+        }
+        Arm.Patterns.push_back(std::move(P));
 
-  auto Start = ParseExpression();
+        if (CI.CurTok != ARG_DELIM_PROTO)
+          break;
+        Tokenizer::getNextToken(CI); // eat ','.
+      }
+    }
+
+    if (CI.CurTok != tok_fatarrow)
+      return LogError(CI, "Expected '=>' after the patterns of a 'match' arm");
+    Tokenizer::getNextToken(CI); // eat '=>'.
+
+    if (!(Arm.Body = ParseExpression(CI)))
+      return nullptr;
+    Arms.push_back(std::move(Arm));
+
+    if (CI.CurTok == STATEMENT_DELIM)
+      Tokenizer::getNextToken(CI);
+  }
+  Tokenizer::getNextToken(CI); // eat '}'.
+
+  return std::make_unique<MatchExpr>(std::move(Scrutinee), std::move(Arms));
+}
+
+/// forexpr
+///   ::= 'for' identifier '=' expr ',' expr (',' expr)? 'in' attributes expression
+///   ::= 'for' identifier 'in' expression attributes expression
+///   ::= 'for' identifier 'in' expression '..' expression ('step' expression)?
+///       attributes expression
+static auto ParseForExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat the for.
+
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected identifier after 'for'.");
+
+  std::string IdName = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI); // eat identifier.
+
+  if (CI.CurTok == tok_in)
+  {
+    Tokenizer::getNextToken(CI); // eat 'in'.
+
+    auto Range = ParseExpression(CI);
+    if (!Range)
+      return nullptr;
+
+    if (CI.CurTok == tok_dotdot)
+      return ParseRangeForTail(CI, IdName, std::move(Range));
+
+    auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+    auto Body  = ParseExpression(CI);
+    if (!Body)
+      return nullptr;
+
+    return std::make_unique<ForEachExpr>(IdName, std::move(Range), std::move(Body),
+                                         std::move(Hints));
+  }
+
+  if (CI.CurTok != '=')
+    return LogError(CI, "Expected '=' after 'for'.");
+  Tokenizer::getNextToken(CI); // eat '='.
+
+  auto Start = ParseExpression(CI);
   if (!Start)
     return nullptr;
-  if (Tokenizer::CurTok != ',')
-    return LogError("Expected ',' after for start value.");
-  Tokenizer::getNextToken();
+  if (CI.CurTok != ',')
+    return LogError(CI, "Expected ',' after for start value.");
+  Tokenizer::getNextToken(CI);
 
-  auto End = ParseExpression();
+  auto End = ParseExpression(CI);
   if (!End)
     return nullptr;
 
   // The step value is optional.
   std::unique_ptr<Expr> Step;
-  if (Tokenizer::CurTok == ',')
+  if (CI.CurTok == ',')
   {
-    Tokenizer::getNextToken();
-    Step = ParseExpression();
+    Tokenizer::getNextToken(CI);
+    Step = ParseExpression(CI);
     if (!Step)
       return nullptr;
   }
 
-  if (Tokenizer::CurTok != tok_in)
-    return LogError("Expected 'in' after for");
-  Tokenizer::getNextToken(); // eat 'in'.
+  if (CI.CurTok != tok_in)
+    return LogError(CI, "Expected 'in' after for");
+  Tokenizer::getNextToken(CI); // eat 'in'.
 
-  auto Body = ParseExpression();
+  auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+  auto Body  = ParseExpression(CI);
   if (!Body)
     return nullptr;
 
   return std::make_unique<ForExpr>(IdName, std::move(Start), std::move(End), std::move(Step),
-                                   std::move(Body));
+                                   std::move(Body), std::move(Hints));
+}
+
+/// pforexpr
+///   ::= 'pfor' identifier '=' expression ',' expression 'in' attributes expression
+///   ::= 'pfor' identifier 'in' expression '..' expression attributes expression
+static auto ParseParallelForExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'pfor'.
+
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected identifier after 'pfor'.");
+
+  std::string IdName = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI); // eat identifier.
+
+  // Both forms run start <= i < end; a `pfor` has no step.
+  const bool IsRange = CI.CurTok == tok_in;
+  if (!IsRange && CI.CurTok != '=')
+    return LogError(CI, "Expected '=' or 'in' after 'pfor'.");
+  Tokenizer::getNextToken(CI); // eat '=' / 'in'.
+
+  auto Start = ParseExpression(CI);
+  if (!Start)
+    return nullptr;
+  if (IsRange ? CI.CurTok != tok_dotdot : CI.CurTok != ',')
+    return LogError(CI, IsRange ? "Expected '..' after the start of a 'pfor' range."
+                                : "Expected ',' after pfor start value.");
+  Tokenizer::getNextToken(CI); // eat '..' / ','.
+
+  auto End = ParseExpression(CI);
+  if (!End)
+    return nullptr;
+
+  if (!IsRange)
+  {
+    if (CI.CurTok != tok_in)
+      return LogError(CI, "Expected 'in' after pfor");
+    Tokenizer::getNextToken(CI); // eat 'in'.
+  }
+
+  // Iterations that may run concurrently cannot depend on each other.
+  auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+  if (!findAttribute(Hints, "parallel"))
+    Hints.push_back({"parallel", {}});
+
+  auto Body = ParseExpression(CI);
+  if (!Body)
+    return nullptr;
+
+  return std::make_unique<ParallelForExpr>(IdName, std::move(Start), std::move(End),
+                                           std::move(Body), std::move(Hints));
+}
+
+/// whileexpr ::= 'while' expression attributes expression
+static auto ParseWhileExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'while'.
+
+  auto Cond = ParseExpression(CI);
+  if (!Cond)
+    return nullptr;
+
+  auto Hints = LoopHints::Check(CI, ParseAttributes(CI));
+  auto Body  = ParseExpression(CI);
+  if (!Body)
+    return nullptr;
+
+  return std::make_unique<WhileExpr>(std::move(Cond), std::move(Body), std::move(Hints));
+}
+
+/// yieldexpr ::= 'yield' expression
+static auto ParseYieldExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'yield'
+
+  auto Operand = ParseExpression(CI);
+  if (!Operand)
+    return nullptr;
+  return std::make_unique<YieldExpr>(std::move(Operand));
+}
+
+/// spawnexpr ::= 'spawn' identifier '(' expression* ')'
+static auto ParseSpawnExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'spawn'
+
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected a function call after 'spawn'");
+
+  std::unique_ptr<Expr> E    = ParseIdentifierExpr(CI);
+  auto*                 Call = dynamic_cast<CallExpr*>(E.get());
+  if (!Call)
+    return LogError(CI, "Expected a function call after 'spawn'");
+
+  E.release();
+  return std::make_unique<SpawnExpr>(std::unique_ptr<CallExpr>(Call));
+}
+
+/// asmstrings ::= (string (',' string)*)?
+static auto ParseAsmStrings(CompilerInstance& CI, std::vector<std::string>& Strs) -> bool
+{
+  while (CI.CurTok == tok_string)
+  {
+    Strs.push_back(CI.StringVal);
+    Tokenizer::getNextToken(CI); // eat the string
+    if (CI.CurTok != ARG_DELIM_PROTO)
+      break;
+    if (Tokenizer::getNextToken(CI) != tok_string) // eat ','
+      return LogError(CI, "Expected a constraint string after ','"), false;
+  }
+  return true;
+}
+
+/// asminputs ::= (string '(' expression ')' (',' string '(' expression ')')*)?
+static auto ParseAsmInputs(CompilerInstance& CI, std::vector<AsmOperand>& Inputs) -> bool
+{
+  while (CI.CurTok == tok_string)
+  {
+    AsmOperand In{CI.StringVal, nullptr};
+    if (Tokenizer::getNextToken(CI) != LEFT_PAREN) // eat the constraint
+      return LogError(CI, "Expected '(' and the value of the 'asm' input"), false;
+    Tokenizer::getNextToken(CI); // eat '('
+    if (!(In.Value = ParseExpression(CI)))
+      return false;
+    if (CI.CurTok != RIGHT_PAREN)
+      return LogError(CI, "Expected ')' after the value of the 'asm' input"), false;
+    Tokenizer::getNextToken(CI); // eat ')'
+    Inputs.push_back(std::move(In));
+
+    if (CI.CurTok != ARG_DELIM_PROTO)
+      break;
+    if (Tokenizer::getNextToken(CI) != tok_string) // eat ','
+      return LogError(CI, "Expected a constraint string after ','"), false;
+  }
+  return true;
+}
+
+/// asmexpr ::= 'asm' attributes ('->' type)? '{' string+
+///             (':' asmstrings (':' asminputs (':' asmstrings)?)?)? '}'
+/// The sections are the outputs, the inputs and the clobbers. Consecutive
+/// template strings are lines of the block; operands are `$0`, `$1`, ... and
+/// `$$` is a literal '$' (`$$1` is the AT&T immediate 1).
+static auto ParseAsmExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'asm'
+
+  AttributeList Attrs = ParseAttributes(CI);
+  for (const auto& A : Attrs)
+  {
+    if (A.Name != "volatile" && A.Name != "intel")
+    {
+      const std::string msg = "Unknown 'asm' attribute '@" + A.Name + "' is ignored";
+      LogWarning(CI, msg.c_str(), "use @volatile or @intel");
+    }
+  }
+
+  llvm::Type* ResultType     = MARE_VOID_TYPE;
+  bool        UnsignedResult = false;
+  if (CI.CurTok == tok_arrow)
+  {
+    Tokenizer::getNextToken(CI); // eat '->'
+    if (!(ResultType = ParseType(CI, &UnsignedResult)))
+      return LogError(CI, "Expected the type of the 'asm' outputs after '->'");
+  }
+
+  if (CI.CurTok != BLOCK_SCOPE_BEGIN)
+    return LogError(CI, "Expected '{' to open the 'asm' block");
+  if (Tokenizer::getNextToken(CI) != tok_string) // eat '{'
+    return LogError(CI, "Expected the assembly template as a string");
+
+  std::string Template;
+  for (; CI.CurTok == tok_string; Tokenizer::getNextToken(CI))
+  {
+    if (!Template.empty())
+      Template += "\n\t";
+    Template += Util::ProcessString(CI.StringVal);
+  }
+
+  std::vector<std::string> Outputs, Clobbers;
+  std::vector<AsmOperand>  Inputs;
+  for (unsigned Section = 0; CI.CurTok == ':' && Section != 3; ++Section)
+  {
+    Tokenizer::getNextToken(CI); // eat ':'
+    const bool Ok = Section == 1 ? ParseAsmInputs(CI, Inputs)
+                                 : ParseAsmStrings(CI, Section == 0 ? Outputs : Clobbers);
+    if (!Ok)
+      return nullptr;
+  }
+
+  for (const auto& Out : Outputs)
+    if (!Out.starts_with('=') || Out.find('*') != std::string::npos)
+      return LogError(CI, "An 'asm' output is written \"=r\"; write memory through a \"*m\" input "
+                          "and a \"memory\" clobber");
+
+  if (CI.CurTok != BLOCK_SCOPE_END)
+    return LogError(CI, "Expected ':' or '}' in the 'asm' block");
+  Tokenizer::getNextToken(CI); // eat '}'
+
+  return std::make_unique<AsmExpr>(std::move(Template), ResultType, UnsignedResult,
+                                   std::move(Outputs), std::move(Inputs), std::move(Clobbers),
+                                   std::move(Attrs));
+}
+
+/// breakexpr ::= 'break'
+/// continueexpr ::= 'continue'
+static auto ParseLoopJumpExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  const bool IsBreak = CI.CurTok == tok_break;
+  Tokenizer::getNextToken(CI); // eat 'break' / 'continue'.
+
+  if (IsBreak)
+    return std::make_unique<BreakExpr>();
+  return std::make_unique<ContinueExpr>();
+}
+
+/// destructure ::= '(' identifier (',' identifier)+ ')' '=' expression
+static auto ParseDestructure(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat '('
+
+  std::vector<std::string> Names;
+  while (true)
+  {
+    if (CI.CurTok != tok_identifier)
+      return LogError(CI, "Expected a variable name (or '_') in the destructuring");
+    Names.push_back(CI.IdentifierStr);
+    Tokenizer::getNextToken(CI); // eat the name
+
+    if (CI.CurTok == RIGHT_PAREN)
+      break;
+    if (CI.CurTok != ARG_DELIM_PROTO)
+      return LogError(CI, "Expected ',' or ')' in the destructuring");
+    Tokenizer::getNextToken(CI); // eat ','
+  }
+  Tokenizer::getNextToken(CI); // eat ')'
+
+  if (Names.size() < 2)
+    return LogError(CI, "Destructuring needs at least two names");
+  if (CI.CurTok != '=')
+    return LogError(CI, "Expected '=' after the destructured names");
+  Tokenizer::getNextToken(CI); // eat '='
+
+  auto Init = ParseExpression(CI);
+  if (!Init)
+    return nullptr;
+  return std::make_unique<DestructureExpr>(std::move(Names), std::move(Init));
 }
 
 /// varexpr ::= 'var' identifier ('=' expression)?
 //                    (',' identifier ('=' expression)?)* 'in' expression
-static auto ParseVarExpr() -> std::unique_ptr<Expr>
+static auto ParseVarExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  Tokenizer::getNextToken(); // eat the var.
+  Tokenizer::getNextToken(CI); // eat the var.
+
+  if (CI.CurTok == LEFT_PAREN)
+    return ParseDestructure(CI);
 
   // At least one variable name is required.
-  if (Tokenizer::CurTok != tok_identifier)
-    return LogError("Expected identifier after 'var'.");
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected identifier after 'var'.");
 
-  std::string VarName = Global::IdentifierStr;
-  Tokenizer::getNextToken();
+  std::string VarName = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI);
 
-  if (Tokenizer::CurTok != '=')
-    return LogError("Expected '=' after variable name");
+  if (CI.CurTok != '=')
+    return LogError(CI, "Expected '=' after variable name");
 
-  Tokenizer::getNextToken(); // eat '='
+  Tokenizer::getNextToken(CI); // eat '='
 
-  auto Body = ParseExpression();
+  auto Body = ParseExpression(CI);
   if (!Body)
     return nullptr;
 
   return std::make_unique<VarExpr>(VarName, std::move(Body));
 }
 
-static auto ParseStringExpr() -> std::unique_ptr<Expr>
+static auto ParseStringExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  const std::string ProcessedStr = Util::ProcessString(); // check for escape sequences
+  // check for escape sequences
+  const std::string ProcessedStr = Util::ProcessString(CI.StringVal);
 
   auto Result = std::make_unique<StringExpr>(ProcessedStr);
-  Tokenizer::getNextToken(); // Consume the string token
+  Tokenizer::getNextToken(CI); // Consume the string token
   return Result;
 }
 
+/// arrayexpr
+///   ::= '[' expression (',' expression)* ']'
+///   ::= '[' expression ';' number ']'
+static auto ParseArrayExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat '['
+
+  std::vector<std::unique_ptr<Expr>> Elements;
+  std::optional<i64>                 RepeatCount;
+  while (true)
+  {
+    auto E = ParseExpression(CI);
+    if (!E)
+      return nullptr;
+    Elements.push_back(std::move(E));
+
+    if (CI.CurTok == STATEMENT_DELIM && Elements.size() == 1)
+    {
+      Tokenizer::getNextToken(CI); // eat ';'
+      if (CI.CurTok != tok_number || Util::ValueAsInt(CI.NumVal) <= 0)
+        return LogError(CI, "Expected a positive repeat count after ';'");
+      RepeatCount = Util::ValueAsInt(CI.NumVal);
+      Tokenizer::getNextToken(CI); // eat count
+    }
+
+    if (CI.CurTok == ']')
+      break;
+    if (CI.CurTok != ARG_DELIM_PROTO || RepeatCount)
+      return LogError(CI, "Expected ',' or ']' in array literal");
+    Tokenizer::getNextToken(CI); // eat ','
+  }
+
+  Tokenizer::getNextToken(CI); // eat ']'
+  return std::make_unique<ArrayExpr>(std::move(Elements), RepeatCount);
+}
+
+/// newexpr ::= 'new' type '[' expression ']'
+static auto ParseNewExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'new'
+
+  bool        UnsignedElems = false;
+  llvm::Type* ElemType      = ParseType(CI, &UnsignedElems);
+  if (!ElemType || ElemType->isVoidTy())
+    return LogError(CI, "Expected an element type after 'new'");
+
+  if (CI.CurTok != '[')
+    return LogError(CI, "Expected '[' with the element count after 'new' type");
+  Tokenizer::getNextToken(CI); // eat '['
+
+  auto Count = ParseExpression(CI);
+  if (!Count)
+    return nullptr;
+
+  if (CI.CurTok != ']')
+    return LogError(CI, "Expected ']' after the element count");
+  Tokenizer::getNextToken(CI); // eat ']'
+
+  return std::make_unique<NewSliceExpr>(ElemType, std::move(Count), UnsignedElems);
+}
+
+/// vectorexpr
+///   ::= vectortype '(' expression ')'                  (splat)
+///   ::= vectortype '(' expression (',' expression)* ')'  (one value per lane)
+static auto ParseVectorExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  bool        UnsignedLanes = false;
+  llvm::Type* VecType       = ParseVectorType(CI, &UnsignedLanes);
+  if (!VecType)
+    return nullptr;
+
+  if (CI.CurTok != '(')
+    return LogError(CI, "Expected '(' with the lane values after the vector type");
+  Tokenizer::getNextToken(CI); // eat '('
+
+  std::vector<std::unique_ptr<Expr>> Lanes;
+  while (true)
+  {
+    auto E = ParseExpression(CI);
+    if (!E)
+      return nullptr;
+    Lanes.push_back(std::move(E));
+
+    if (CI.CurTok == ')')
+      break;
+    if (CI.CurTok != ARG_DELIM_PROTO)
+      return LogError(CI, "Expected ',' or ')' in vector constructor");
+    Tokenizer::getNextToken(CI); // eat ','
+  }
+  Tokenizer::getNextToken(CI); // eat ')'
+
+  const unsigned N = llvm::cast<llvm::FixedVectorType>(VecType)->getNumElements();
+  if (Lanes.size() != 1 && Lanes.size() != N)
+    return LogError(CI, "A vector constructor takes one value or one value per lane");
+
+  return std::make_unique<VectorExpr>(VecType, std::move(Lanes), UnsignedLanes);
+}
+
+/// castexpr ::= scalartype '(' expression ')'
+static auto ParseCastExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  bool        UnsignedDest = false;
+  llvm::Type* DestType     = ParseType(CI, &UnsignedDest);
+  if (!DestType)
+    return nullptr;
+
+  if (CI.CurTok != LEFT_PAREN)
+    return LogError(CI, "Expected '(' with the value to convert after the type name");
+  Tokenizer::getNextToken(CI); // eat '('
+
+  auto Operand = ParseExpression(CI);
+  if (!Operand)
+    return nullptr;
+
+  if (CI.CurTok != RIGHT_PAREN)
+    return LogError(CI, "Expected ')' after the value to convert");
+  Tokenizer::getNextToken(CI); // eat ')'
+
+  return std::make_unique<CastExpr>(DestType, std::move(Operand), UnsignedDest);
+}
+
+/// deleteexpr ::= 'delete' unary
+static auto ParseDeleteExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat 'delete'
+
+  auto Operand = ParseUnary(CI);
+  if (!Operand)
+    return nullptr;
+  return std::make_unique<DeleteExpr>(std::move(Operand));
+}
+
+/// blockexpr ::= '{' expression* '}'
+static auto ParseBlockExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  Tokenizer::getNextToken(CI); // eat '{'
+  return ParseBlock(CI);
+}
+
+/// fpmodeexpr ::= attributes expression
+/// The attributes are one of the floating point modes `@fastmath`, `@fastmath(flags)`
+/// and `@strictfp`.
+static auto ParseFPModeExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  AttributeList Attrs = ParseAttributes(CI);
+  for (const auto& A : Attrs)
+  {
+    if (FastMath::IsMode(A) && FastMath::IsValidMode(A))
+      continue;
+
+    const std::string msg = FastMath::IsMode(A)
+                              ? "Malformed floating point mode '@" + A.Name + "' is ignored"
+                              : "Unknown expression attribute '@" + A.Name + "' is ignored";
+    LogWarning(CI, msg.c_str(),
+               "use @strictfp, @fastmath or @fastmath(reassoc, contract, nnan, ninf, nsz, arcp, "
+               "afn)");
+  }
+
+  auto Body = ParseExpression(CI);
+  if (!Body)
+    return nullptr;
+
+  auto Flags = FastMath::Mode(Attrs);
+  if (!Flags)
+    return Body;
+  return std::make_unique<FPModeExpr>(*Flags, std::move(Body));
+}
+
 /// primary
 ///   ::= identifierexpr
 ///   ::= numberexpr
 ///   ::= parenexpr
 ///   ::= ifexpr
+///   ::= matchexpr
 ///   ::= forexpr
+///   ::= whileexpr
+///   ::= breakexpr
+///   ::= continueexpr
 ///   ::= varexpr
-static auto ParsePrimary() -> std::unique_ptr<Expr>
+///   ::= arrayexpr
+///   ::= newexpr
+///   ::= deleteexpr
+///   ::= vectorexpr
+///   ::= castexpr
+///   ::= asmexpr
+///   ::= blockexpr
+///   ::= fpmodeexpr
+static auto ParsePrimary(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  switch (Tokenizer::CurTok)
+  switch (CI.CurTok)
   {
     default:
-      return LogError("Unknown token when expecting an expression");
+      return LogError(CI, "Unknown token when expecting an expression");
     case tok_identifier:
-      return ParseIdentifierExpr();
+      return ParseIdentifierExpr(CI);
     case tok_number:
-      return ParseNumberExpr();
+      return ParseNumberExpr(CI);
     case '(':
-      return ParseParenExpr();
+      return ParseParenExpr(CI);
     case tok_if:
-      return ParseIfExpr();
+      return ParseIfExpr(CI);
+    case tok_match:
+      return ParseMatchExpr(CI);
     case tok_for:
-      return ParseForExpr();
+      return ParseForExpr(CI);
+    case tok_pfor:
+      return ParseParallelForExpr(CI);
+    case tok_while:
+      return ParseWhileExpr(CI);
+    case tok_break:
+    case tok_continue:
+      return ParseLoopJumpExpr(CI);
+    case tok_yield:
+      return ParseYieldExpr(CI);
+    case tok_spawn:
+      return ParseSpawnExpr(CI);
+    case tok_asm:
+      return ParseAsmExpr(CI);
     case tok_string:
-      return ParseStringExpr();
+      return ParseStringExpr(CI);
     case tok_var:
-      return ParseVarExpr();
+      return ParseVarExpr(CI);
+    case '[':
+      return ParseArrayExpr(CI);
+    case tok_new:
+      return ParseNewExpr(CI);
+    case tok_delete:
+      return ParseDeleteExpr(CI);
+    case tok_vec:
+      return ParseVectorExpr(CI);
+    case tok_double:
+    case tok_float:
+    case tok_int64:
+    case tok_int32:
+    case tok_int16:
+    case tok_int8:
+    case tok_uint64:
+    case tok_uint32:
+    case tok_uint16:
+    case tok_uint8:
+      return ParseCastExpr(CI);
+    case BLOCK_SCOPE_BEGIN:
+      return ParseBlockExpr(CI);
+    case tok_attribute:
+      return ParseFPModeExpr(CI);
   }
 }
 
-/// unary
+/// postfix
 ///   ::= primary
+///   ::= postfix '[' expression ']'
+///   ::= postfix '.' identifier
+static auto ParsePostfix(CompilerInstance& CI) -> std::unique_ptr<Expr>
+{
+  auto E = ParsePrimary(CI);
+
+  while (E)
+  {
+    if (CI.CurTok == '[')
+    {
+      Tokenizer::getNextToken(CI); // eat '['
+      auto Index = ParseExpression(CI);
+      if (!Index)
+        return nullptr;
+      if (CI.CurTok != ']')
+        return LogError(CI, "Expected ']' after index");
+      Tokenizer::getNextToken(CI); // eat ']'
+      E = std::make_unique<IndexExpr>(std::move(E), std::move(Index));
+    }
+    else if (CI.CurTok == '.')
+    {
+      Tokenizer::getNextToken(CI); // eat '.'
+      if (CI.CurTok != tok_identifier)
+        return LogError(CI, "Expected member name after '.'");
+      E = std::make_unique<MemberExpr>(std::move(E), CI.IdentifierStr);
+      Tokenizer::getNextToken(CI); // eat member
+    }
+    else
+      break;
+  }
+
+  return E;
+}
+
+/// unary
+///   ::= postfix
 ///   ::= '!' unary
-static auto ParseUnary() -> std::unique_ptr<Expr>
+static auto ParseUnary(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
   // If the current token is not an operator, it must be a primary expr.
-  if (Tokenizer::IsCurTokPrimaryExpr())
-    return ParsePrimary();
+  if (Tokenizer::IsCurTokPrimaryExpr(CI))
+    return ParsePostfix(CI);
 
   // If this is a unary operator, read it.
-  int Opc = Tokenizer::CurTok;
-  Tokenizer::getNextToken();
-  if (auto Operand = ParseUnary())
+  int Opc = CI.CurTok;
+  Tokenizer::getNextToken(CI);
+  if (auto Operand = ParseUnary(CI))
     return std::make_unique<UnaryExpr>(Opc, std::move(Operand));
   return nullptr;
 }
 
 /// binoprhs
 ///   ::= ('+' unary)*
-static auto ParseBinOpRHS(int ExprPrec, std::unique_ptr<Expr> LHS) -> std::unique_ptr<Expr>
+static auto ParseBinOpRHS(CompilerInstance& CI, int ExprPrec, std::unique_ptr<Expr> LHS)
+  -> std::unique_ptr<Expr>
 {
   // If this is a binop, find its precedence.
   while (true)
   {
-    int TokPrec = GetTokPrecedence();
+    int TokPrec = GetTokPrecedence(CI);
 
     // If this is a binop that binds at least as tightly as the current binop,
     // consume it, otherwise we are done.
@@ -300,20 +1140,20 @@ static auto ParseBinOpRHS(int ExprPrec, std::unique_ptr<Expr> LHS) -> std::uniqu
       return LHS;
 
     // Okay, we know this is a binop.
-    int BinOp = Tokenizer::CurTok;
-    Tokenizer::getNextToken(); // eat binop
+    Token__ BinOp = CI.CurTok;
+    Tokenizer::getNextToken(CI); // eat binop
 
     // Parse the unary expression after the binary operator.
-    auto RHS = ParseUnary();
+    auto RHS = ParseUnary(CI);
     if (!RHS)
       return nullptr;
 
     // If BinOp binds less tightly with RHS than the operator after RHS, let
     // the pending operator take RHS as its LHS.
-    int NextPrec = GetTokPrecedence();
+    int NextPrec = GetTokPrecedence(CI);
     if (TokPrec < NextPrec)
     {
-      RHS = ParseBinOpRHS(TokPrec + 1, std::move(RHS));
+      RHS = ParseBinOpRHS(CI, TokPrec + 1, std::move(RHS));
       if (!RHS)
         return nullptr;
     }
@@ -326,50 +1166,58 @@ static auto ParseBinOpRHS(int ExprPrec, std::unique_ptr<Expr> LHS) -> std::uniqu
 /// expression
 ///   ::= unary binoprhs
 ///
-static auto ParseExpression() -> std::unique_ptr<Expr>
+static auto ParseExpression(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  if (Tokenizer::CurTok == tok_ret)
-    return ParseReturnExpr();
+  if (CI.CurTok == tok_ret)
+    return ParseReturnExpr(CI);
 
-  auto LHS = ParseUnary();
+  auto LHS = ParseUnary(CI);
   if (!LHS)
     return nullptr;
 
-  return ParseBinOpRHS(0, std::move(LHS));
+  return ParseBinOpRHS(CI, 0, std::move(LHS));
 }
 
-static auto ParseBlock() -> std::unique_ptr<Expr>
+static auto ParseBlock(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
   std::vector<std::unique_ptr<Expr>> Exprs;
 
   while (true)
   {
     // End of file or new function, break
-    if (Tokenizer::IsCurTokOverBlock())
+    if (Tokenizer::IsCurTokOverBlock(CI))
     {
-      Tokenizer::getNextToken();
+      Tokenizer::getNextToken(CI);
       break;
     }
 
-    auto Expr = ParseExpression();
+    auto Expr = ParseExpression(CI);
     if (!Expr)
       return nullptr;
 
     Exprs.push_back(std::move(Expr));
 
     // Optional semicolon (skip if you don't require it)
-    if (Tokenizer::CurTok == STATEMENT_DELIM)
-      Tokenizer::getNextToken();
+    if (CI.CurTok == STATEMENT_DELIM)
+      Tokenizer::getNextToken(CI);
   }
 
   return std::make_unique<BlockExpr>(std::move(Exprs));
 }
 
-static auto ParseTypedArgument() -> std::optional<std::pair<std::string, llvm::Type*>>
+struct TypedArgument
+{
+  std::string Name;
+  llvm::Type* Ty;
+  bool        Unsigned; // Declared as u8..u64 (or a slice/array/vector of them)
+};
+
+static auto ParseTypedArgument(CompilerInstance& CI) -> std::optional<TypedArgument>
 {
-  llvm::Type* ArgType = MARE_DOUBLE_TYPE;
+  llvm::Type* ArgType  = MARE_DOUBLE_TYPE;
+  bool        Unsigned = false;
 
-  switch (Tokenizer::CurTok)
+  switch (CI.CurTok)
   {
     case tok_double:
       break;
@@ -388,143 +1236,261 @@ static auto ParseTypedArgument() -> std::optional<std::pair<std::string, llvm::T
     case tok_int8:
       ArgType = MARE_INT8_TYPE;
       break;
+    case tok_uint64:
+    case tok_uint32:
+    case tok_uint16:
+    case tok_uint8:
+      ArgType  = Util::ParseReturnTypeProto(CI, CI.CurTok);
+      Unsigned = true;
+      break;
     case tok_string:
       ArgType = MARE_STRPTR_TYPE;
       break;
+    case tok_bool:
+      ArgType = MARE_INT1_TYPE;
+      break;
+    case '[':
+    case tok_vec:
+      ArgType = ParseType(CI, &Unsigned);
+      if (!ArgType)
+        return std::nullopt;
+      break;
     case tok_identifier:
+      if (Types::FindStruct(CI, CI.IdentifierStr) && !(ArgType = ParseType(CI)))
+        return std::nullopt;
       break;
     default:
-      return LogErrorP("Unexpected token in argument list"), std::nullopt;
+      return LogErrorP(CI, "Unexpected token in argument list"), std::nullopt;
   }
 
-  if (Tokenizer::CurTok != tok_identifier)
-    Tokenizer::getNextToken(); // Eat the type token
+  if (CI.CurTok != tok_identifier)
+    Tokenizer::getNextToken(CI); // Eat the type token
+
+  if (CI.CurTok != tok_identifier)
+    return LogErrorP(CI, "Expected argument name after type"), std::nullopt;
+
+  std::string name = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI); // Eat identifier
+  return TypedArgument{name, ArgType, Unsigned};
+}
+
+/// Attributes understood on `fn`/`extern` declarations.
+static const std::set<std::string> FunctionAttributeNames = {
+  "pure",    "readnone", "readonly", "nounwind", "willreturn", "nosync",
+  "noalias", "memo",     "fastmath", "strictfp"};
+
+/// attributeargs ::= '(' (number | id | id '=' number) (',' ...)* ')'
+static auto ParseAttributeArgs(CompilerInstance& CI, Attribute& Attr) -> bool
+{
+  Tokenizer::getNextToken(CI); // eat '('
+
+  while (CI.CurTok != RIGHT_PAREN)
+  {
+    AttributeArg Arg;
+    if (CI.CurTok == tok_number)
+    {
+      Arg.Value = Util::ValueAsInt(CI.NumVal);
+      Tokenizer::getNextToken(CI);
+    }
+    else if (CI.CurTok == tok_identifier)
+    {
+      Arg.Key = CI.IdentifierStr;
+      Tokenizer::getNextToken(CI);
+      if (CI.CurTok == '=')
+      {
+        Tokenizer::getNextToken(CI); // eat '='
+        if (CI.CurTok != tok_number)
+          return LogError(CI, "Expected a number after '=' in attribute argument"), false;
+        Arg.Value = Util::ValueAsInt(CI.NumVal);
+        Tokenizer::getNextToken(CI);
+      }
+    }
+    else
+      return LogError(CI, "Expected number or identifier in attribute arguments"), false;
+
+    Attr.Args.push_back(std::move(Arg));
 
-  if (Tokenizer::CurTok != tok_identifier)
-    return LogErrorP("Expected argument name after type"), std::nullopt;
+    if (CI.CurTok == ARG_DELIM_PROTO)
+      Tokenizer::getNextToken(CI);
+    else if (CI.CurTok != RIGHT_PAREN)
+      return LogError(CI, "Expected ',' or ')' in attribute arguments"), false;
+  }
 
-  std::string name = Global::IdentifierStr;
-  Tokenizer::getNextToken(); // Eat identifier
-  return std::make_pair(name, ArgType);
+  Tokenizer::getNextToken(CI); // eat ')'
+  return true;
+}
+
+/// attributes ::= ('@' id attributeargs?)*
+static auto ParseAttributes(CompilerInstance& CI) -> AttributeList
+{
+  AttributeList Attrs;
+
+  while (CI.CurTok == tok_attribute)
+  {
+    Attribute Attr;
+    Attr.Name = CI.IdentifierStr;
+    Tokenizer::getNextToken(CI); // eat attribute
+
+    if (CI.CurTok == LEFT_PAREN && !ParseAttributeArgs(CI, Attr))
+      return {};
+
+    Attrs.push_back(std::move(Attr));
+  }
+
+  return Attrs;
+}
+
+/// Warn about (and drop nothing from) attributes that do not apply to functions.
+static void CheckFunctionAttributes(CompilerInstance& CI, const AttributeList& Attrs)
+{
+  for (const auto& A : Attrs)
+  {
+    if (!FunctionAttributeNames.contains(A.Name))
+    {
+      const std::string msg = "Unknown function attribute '@" + A.Name + "' is ignored";
+      LogWarning(CI, msg.c_str());
+    }
+    else if (FastMath::IsMode(A) && !FastMath::IsValidMode(A))
+    {
+      const std::string msg = "Malformed floating point mode '@" + A.Name + "' is ignored";
+      LogWarning(CI, msg.c_str(),
+                 "use @strictfp, @fastmath or @fastmath(reassoc, contract, nnan, ninf, nsz, "
+                 "arcp, afn)");
+    }
+  }
 }
 
 /// prototype
 ///   ::= id '(' id* ')'
 ///   ::= binary LETTER number? (id, id)
 ///   ::= unary LETTER (id)
-static auto ParsePrototype() -> std::unique_ptr<Prototype>
+static auto ParsePrototype(CompilerInstance& CI) -> std::unique_ptr<Prototype>
 {
   llvm::Type* RetType = MARE_VOID_TYPE;
   std::string FnName;
   unsigned    Kind = 0, BinaryPrecedence = 30;
 
-  switch (Tokenizer::CurTok)
+  switch (CI.CurTok)
   {
     case tok_identifier:
-      FnName = Global::IdentifierStr;
+      FnName = CI.IdentifierStr;
       Kind   = 0;
-      Tokenizer::getNextToken();
+      Tokenizer::getNextToken(CI);
       break;
 
     case tok_unary:
-      Tokenizer::getNextToken();
-      if (!Tokenizer::IsCurTokAscii())
-        return LogErrorP("Expected unary operator");
-      FnName = __MARE_UNARY_FUNC_DECL__ + std::string(1, Tokenizer::CurTokChar());
+      Tokenizer::getNextToken(CI);
+      if (!Tokenizer::IsCurTokAscii(CI))
+        return LogErrorP(CI, "Expected unary operator");
+      FnName = __MARE_UNARY_FUNC_DECL__ + std::string(1, Tokenizer::CurTokChar(CI));
       Kind   = 1;
-      Tokenizer::getNextToken();
+      Tokenizer::getNextToken(CI);
       break;
 
     case tok_binary:
-      Tokenizer::getNextToken();
-      if (!Tokenizer::IsCurTokAscii())
-        return LogErrorP("Expected binary operator");
-      FnName = __MARE_BINARY_FUNC_DECL__ + std::string(1, Tokenizer::CurTokChar());
+      Tokenizer::getNextToken(CI);
+      if (!Tokenizer::IsCurTokAscii(CI))
+        return LogErrorP(CI, "Expected binary operator");
+      FnName = __MARE_BINARY_FUNC_DECL__ + std::string(1, Tokenizer::CurTokChar(CI));
       Kind   = 2;
-      Tokenizer::getNextToken();
-      if (Tokenizer::CurTok == tok_number)
+      Tokenizer::getNextToken(CI);
+      if (CI.CurTok == tok_number)
       {
-        auto maybePrec = extractPrecedence();
+        auto maybePrec = extractPrecedence(CI);
         if (!maybePrec)
-          return LogErrorP("Invalid precedence: must be 1..100");
+          return LogErrorP(CI, "Invalid precedence: must be 1..100");
         BinaryPrecedence = *maybePrec;
-        Tokenizer::getNextToken();
+        Tokenizer::getNextToken(CI);
       }
       break;
 
     default:
-      return LogErrorP("Expected function name in prototype");
+      return LogErrorP(CI, "Expected function name in prototype");
   }
 
-  if (Tokenizer::CurTok != LEFT_PAREN)
-    return LogErrorP("Expected '(' in prototype");
+  if (CI.CurTok != LEFT_PAREN)
+    return LogErrorP(CI, "Expected '(' in prototype");
 
   std::vector<std::string> ArgNames;
   std::vector<llvm::Type*> ArgTypes;
-  Tokenizer::getNextToken(); // eat '('
+  std::vector<bool>        UnsignedArgs;
+  bool                     UnsignedRet = false;
+  Tokenizer::getNextToken(CI); // eat '('
 
-  while (Tokenizer::TokenIsValidArg())
+  while (Tokenizer::TokenIsValidArg(CI))
   {
-    auto maybeArg = ParseTypedArgument();
+    auto maybeArg = ParseTypedArgument(CI);
     if (!maybeArg)
       return nullptr;
 
-    ArgNames.push_back(maybeArg->first);
-    ArgTypes.push_back(maybeArg->second);
+    ArgNames.push_back(maybeArg->Name);
+    ArgTypes.push_back(maybeArg->Ty);
+    UnsignedArgs.push_back(maybeArg->Unsigned);
 
-    if (Tokenizer::CurTok == ',')
-      Tokenizer::getNextToken(); // eat ','
+    if (CI.CurTok == ',')
+      Tokenizer::getNextToken(CI); // eat ','
   }
 
-  if (Tokenizer::CurTok != RIGHT_PAREN)
-    return LogErrorP("Expected ')' in argument decl");
+  if (CI.CurTok != RIGHT_PAREN)
+    return LogErrorP(CI, "Expected ')' in argument decl");
 
-  Tokenizer::getNextToken(); // eat ')'
+  Tokenizer::getNextToken(CI); // eat ')'
 
-  if (Tokenizer::CurTok == tok_arrow)
+  if (CI.CurTok == tok_arrow)
   {
-    Tokenizer::getNextToken(); // consume the arrow
-    RetType = Util::ParseReturnTypeProto(Tokenizer::CurTok);
+    Tokenizer::getNextToken(CI); // consume the arrow
+    RetType = ParseType(CI, &UnsignedRet);
     if (RetType == nullptr)
     {
-      LogErrorP("Expected return type after '->'");
+      LogErrorP(CI, "Expected return type after '->'");
       return nullptr;
     }
-    Tokenizer::getNextToken(); // eat return type
   }
 
   if (Kind && ArgNames.size() != Kind)
-    return LogErrorP("Invalid number of operands for operator");
+    return LogErrorP(CI, "Invalid number of operands for operator");
 
-  return std::make_unique<Prototype>(FnName, ArgNames, ArgTypes, RetType, Kind != 0,
-                                     BinaryPrecedence);
+  auto Proto = std::make_unique<Prototype>(FnName, ArgNames, ArgTypes, RetType, Kind != 0,
+                                           BinaryPrecedence);
+  Proto->setUnsigned(std::move(UnsignedArgs), UnsignedRet);
+  return Proto;
 }
 
-/// definition ::= 'fn' prototype expression
-static auto ParseDefinition() -> std::unique_ptr<FunctionalAST>
+/// definition ::= attributes 'gen'? 'fn' prototype expression
+static auto ParseDefinition(CompilerInstance& CI, AttributeList Attrs = {})
+  -> std::unique_ptr<FunctionalAST>
 {
-  Tokenizer::getNextToken(); // eat def
-  auto Proto = ParsePrototype();
+  const bool IsGenerator = CI.CurTok == tok_gen;
+  if (IsGenerator && Tokenizer::getNextToken(CI) != tok_def) // eat 'gen'
+    return LogError(CI, "Expected 'fn' after 'gen'"), nullptr;
+
+  Tokenizer::getNextToken(CI); // eat def
+  auto Proto = ParsePrototype(CI);
   if (!Proto)
     return nullptr;
+  if (IsGenerator)
+    Proto->setGenerator();
+
+  CheckFunctionAttributes(CI, Attrs);
+  Proto->setAttributes(std::move(Attrs));
 
-  if (Tokenizer::CurTok != '{')
+  if (CI.CurTok != '{')
   {
-    LogError("Expected '{' to start function body");
+    LogError(CI, "Expected '{' to start function body");
     return nullptr;
   }
 
-  Tokenizer::getNextToken(); // consume '{'
+  Tokenizer::getNextToken(CI); // consume '{'
 
-  if (auto E = ParseBlock())
+  if (auto E = ParseBlock(CI))
     return std::make_unique<FunctionalAST>(std::move(Proto), std::move(E));
   return nullptr;
 }
 
 /// toplevelexpr ::= expression
-static auto ParseTopLevelExpr() -> std::unique_ptr<FunctionalAST>
+static auto ParseTopLevelExpr(CompilerInstance& CI) -> std::unique_ptr<FunctionalAST>
 {
-  if (auto E = ParseExpression())
+  if (auto E = ParseExpression(CI))
   {
     // Determine the return type based on the expression.
     llvm::Type* RetType = MARE_VOID_TYPE; // Default to void
@@ -537,33 +1503,122 @@ static auto ParseTopLevelExpr() -> std::unique_ptr<FunctionalAST>
   return nullptr;
 }
 
-static auto ParseReturnExpr() -> std::unique_ptr<Expr>
+static auto ParseReturnExpr(CompilerInstance& CI) -> std::unique_ptr<Expr>
 {
-  Tokenizer::getNextToken(); // consume 'return'
+  Tokenizer::getNextToken(CI); // consume 'return'
 
   // Support optional return expression (e.g., `return;`)
-  if (Tokenizer::CurTok == ';' || Tokenizer::CurTok == tok_eof)
+  if (CI.CurTok == ';' || CI.CurTok == tok_eof)
     return std::make_unique<ReturnExpr>(nullptr);
 
   // Parse the return value expression directly without going through ParseExpression
-  auto LHS = ParseUnary();
+  auto LHS = ParseUnary(CI);
   if (!LHS)
     return nullptr;
-  auto RetExpr = ParseBinOpRHS(0, std::move(LHS));
+  auto RetExpr = ParseBinOpRHS(CI, 0, std::move(LHS));
   if (!RetExpr)
     return nullptr;
   return std::make_unique<ReturnExpr>(std::move(RetExpr));
 }
 
-/// external ::= 'extern' prototype
-static auto ParseExtern() -> std::unique_ptr<Prototype>
+/// external ::= attributes 'extern' prototype
+static auto ParseExtern(CompilerInstance& CI, AttributeList Attrs = {})
+  -> std::unique_ptr<Prototype>
 {
-  Tokenizer::getNextToken(); // Consume 'extern'
+  Tokenizer::getNextToken(CI); // Consume 'extern'
+
+  if (CI.CurTok != tok_identifier)
+    return LogErrorP(CI, "Expected function name after 'extern'");
+
+  auto Proto = ParsePrototype(CI);
+  if (!Proto)
+    return nullptr;
+
+  CheckFunctionAttributes(CI, Attrs);
+  Proto->setAttributes(std::move(Attrs));
+  return Proto;
+}
+
+/// globaldecl ::= ('const' | 'global') identifier '=' expression
+static auto ParseGlobal(CompilerInstance& CI) -> std::unique_ptr<GlobalVarAST>
+{
+  const bool IsConst = CI.CurTok == tok_const;
+  Tokenizer::getNextToken(CI); // eat 'const' / 'global'
+
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected a name after 'const' or 'global'"), nullptr;
+  std::string Name = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI); // eat name
+
+  if (CI.CurTok != '=')
+    return LogError(CI, "Expected '=' and an initializer after the name"), nullptr;
+  Tokenizer::getNextToken(CI); // eat '='
+
+  auto Init = ParseExpression(CI);
+  if (!Init)
+    return nullptr;
+
+  return std::make_unique<GlobalVarAST>(std::move(Name), std::move(Init), IsConst);
+}
+
+/// structdecl ::= attributes 'struct' id '{' (type id (';' | ','))* '}'
+/// Declares the type right away: later declarations refer to it by name.
+static auto ParseStruct(CompilerInstance& CI, const AttributeList& Attrs = {}) -> bool
+{
+  Tokenizer::getNextToken(CI); // eat 'struct'
+
+  if (CI.CurTok != tok_identifier)
+    return LogError(CI, "Expected struct name after 'struct'"), false;
+  std::string Name = CI.IdentifierStr;
+  Tokenizer::getNextToken(CI); // eat name
+
+  bool SoA = false;
+  for (const auto& A : Attrs)
+  {
+    const std::string Layout = A.Args.size() == 1 ? A.Args.front().Key : "";
+    if (A.Name == "layout" && (Layout == "soa" || Layout == "aos"))
+      SoA = Layout == "soa";
+    else
+    {
+      const std::string msg = "Unknown struct attribute '@" + A.Name + "' is ignored" +
+                              (A.Name == "layout" ? " (expected soa or aos)" : "");
+      LogWarning(CI, msg.c_str());
+    }
+  }
+
+  if (CI.CurTok != BLOCK_SCOPE_BEGIN)
+    return LogError(CI, "Expected '{' after struct name"), false;
+  Tokenizer::getNextToken(CI); // eat '{'
+
+  std::vector<std::pair<std::string, llvm::Type*>> Fields;
+  std::vector<bool>                                UnsignedFields;
+  while (CI.CurTok != BLOCK_SCOPE_END)
+  {
+    bool        Unsigned  = false;
+    llvm::Type* FieldType = ParseType(CI, &Unsigned);
+    if (!FieldType || FieldType->isVoidTy())
+      return LogError(CI, "Expected a field type in struct"), false;
+    if (CI.CurTok != tok_identifier)
+      return LogError(CI, "Expected a field name after its type"), false;
+    Fields.emplace_back(CI.IdentifierStr, FieldType);
+    UnsignedFields.push_back(Unsigned);
+    Tokenizer::getNextToken(CI); // eat field name
+
+    if (CI.CurTok == STATEMENT_DELIM || CI.CurTok == ARG_DELIM_PROTO)
+      Tokenizer::getNextToken(CI);
+    else if (CI.CurTok != BLOCK_SCOPE_END)
+      return LogError(CI, "Expected ';' or '}' after struct field"), false;
+  }
+  Tokenizer::getNextToken(CI); // eat '}'
 
-  if (Tokenizer::CurTok != tok_identifier)
-    return LogErrorP("Expected function name after 'extern'");
+  if (Fields.empty())
+    return LogError(CI, "A struct needs at least one field"), false;
 
-  return ParsePrototype();
+  const std::string Err =
+    Types::DeclareStruct(CI, Name, std::move(Fields), std::move(UnsignedFields), SoA);
+  if (!Err.empty())
+    return LogError(CI, Err.c_str()), false;
+  return true;
 }
 
 } // namespace Mare::Parser
@@ -3,21 +3,24 @@
 #include "Compiler.hpp"
 #include <llvm/IR/Type.h>
 
-#define MARE_DOUBLE_TYPE llvm::Type::getDoubleTy(*TheContext)
-#define MARE_FLOAT_TYPE  llvm::Type::getFloatTy(*TheContext)
-#define MARE_INT1_TYPE   llvm::Type::getInt1Ty(*TheContext)
-#define MARE_INT8_TYPE   llvm::Type::getInt8Ty(*TheContext)
-#define MARE_INT16_TYPE  llvm::Type::getInt16Ty(*TheContext)
-#define MARE_INT32_TYPE  llvm::Type::getInt32Ty(*TheContext)
-#define MARE_INT64_TYPE  llvm::Type::getInt64Ty(*TheContext)
-#define MARE_VOID_TYPE   llvm::Type::getVoidTy(*TheContext)
-#define MARE_STRPTR_TYPE llvm::PointerType::getInt8Ty(*TheContext) // i8*
+// These expand against the `CompilerInstance& CI` of the enclosing function.
+
+#define MARE_DOUBLE_TYPE llvm::Type::getDoubleTy(*CI.TheContext)
+#define MARE_FLOAT_TYPE  llvm::Type::getFloatTy(*CI.TheContext)
+#define MARE_INT1_TYPE   llvm::Type::getInt1Ty(*CI.TheContext)
+#define MARE_INT8_TYPE   llvm::Type::getInt8Ty(*CI.TheContext)
+#define MARE_INT16_TYPE  llvm::Type::getInt16Ty(*CI.TheContext)
+#define MARE_INT32_TYPE  llvm::Type::getInt32Ty(*CI.TheContext)
+#define MARE_INT64_TYPE  llvm::Type::getInt64Ty(*CI.TheContext)
+#define MARE_VOID_TYPE   llvm::Type::getVoidTy(*CI.TheContext)
+#define MARE_PTR_TYPE    llvm::PointerType::getUnqual(*CI.TheContext) // opaque ptr
+#define MARE_STRPTR_TYPE MARE_PTR_TYPE                                // i8*
 
 // For generic integer types of N bits
-#define MARE_INTN_TYPE(N) llvm::Type::getIntNTy(*TheContext, N)
+#define MARE_INTN_TYPE(N) llvm::Type::getIntNTy(*CI.TheContext, N)
 
 // Vector type example: <4 x float>
-#define MARE_VECTOR_TYPE(elemType, count) llvm::VectorType::get(elemType, count)
+#define MARE_VECTOR_TYPE(elemType, count) llvm::FixedVectorType::get(elemType, count)
 
 // Array type example: [10 x i32]
 #define MARE_ARRAY_TYPE(elemType, count) llvm::ArrayType::get(elemType, count)
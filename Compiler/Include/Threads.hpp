@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "PrimitiveTypes.hpp"
+
+//===----------------------------------------------------------------------===//
+// Threads (`spawn`, `join`, `pfor`)
+//
+// `spawn f(a, b)` evaluates the arguments, starts f on a new thread and yields
+// its handle; `join(t)` waits for the thread and yields what f returned, as an
+// i64 (0 for a void function):
+//
+//   var t = spawn sum(xs, i64(0), n / 2);
+//   var s = sum(xs, n / 2, n) + join(t);
+//
+// The arguments travel to the thread in a heap block that its entry point,
+// `f.spawn`, frees once it has read them. Threads share what is behind slices
+// and `global`s; the atomic_* builtins order their accesses to it. Every
+// handle must be joined exactly once.
+//
+// `pfor i in 0..n body` runs the iterations of a loop on a work-stealing pool
+// and returns once all of them are done:
+//
+//   pfor i in 0..n ys[i] = f(xs[i]);
+//
+// The body is outlined into `f.pfor(ctx, lo, hi)`, which runs iterations lo
+// to hi. ctx holds the addresses of the enclosing function's locals, and every
+// chunk reads and writes those very locals: iterations that update the same
+// one must use atomics, as with slices and `global`s. The runtime splits the
+// range in halves on demand and idle workers steal the larger halves.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Threads
+{
+
+inline auto GetRuntimeFunction(CompilerInstance& CI, const char* Name, llvm::FunctionType* FT)
+  -> llvm::Function*
+{
+  auto* F =
+    llvm::cast<llvm::Function>(CI.TheModule->getOrInsertFunction(Name, FT).getCallee());
+  F->setDoesNotThrow();
+  return F;
+}
+
+/// __mare_spawn(entry, env) - handle of a new thread running entry(env).
+inline auto GetSpawnFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  return GetRuntimeFunction(
+    CI, __MARE_SPAWN_FN__,
+    llvm::FunctionType::get(MARE_INT64_TYPE, {MARE_PTR_TYPE, MARE_PTR_TYPE}, false));
+}
+
+/// __mare_join(handle) - result of the thread's entry point.
+inline auto GetJoinFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  return GetRuntimeFunction(CI, __MARE_JOIN_FN__,
+                            llvm::FunctionType::get(MARE_INT64_TYPE, {MARE_INT64_TYPE}, false));
+}
+
+/// __mare_cpu_count() - hardware threads of the machine, at least 1.
+inline auto GetCpuCountFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  return GetRuntimeFunction(CI, __MARE_CPU_COUNT_FN__,
+                            llvm::FunctionType::get(MARE_INT64_TYPE, {}, false));
+}
+
+/// __mare_parallel_for(chunk, ctx, lo, hi) - chunk(ctx, a, b) over pieces of lo..hi.
+inline auto GetParallelForFunction(CompilerInstance& CI) -> llvm::Function*
+{
+  return GetRuntimeFunction(
+    CI, __MARE_PFOR_FN__,
+    llvm::FunctionType::get(MARE_VOID_TYPE,
+                            {MARE_PTR_TYPE, MARE_PTR_TYPE, MARE_INT64_TYPE, MARE_INT64_TYPE},
+                            false));
+}
+
+} // namespace Mare::Threads
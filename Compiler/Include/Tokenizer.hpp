@@ -2,24 +2,21 @@
 
 #include "CmdLineParser.hpp"
 #include "Compiler.hpp"
+#include "CompilerInstance.hpp"
 #include "ErrorHandling.hpp"
 #include "PrimitiveTypes.hpp"
+#include "Utils.hpp"
 
 namespace Mare::Tokenizer
 {
 
 using namespace Mare::Global;
 
-/// CurTok/getNextToken - Provide a simple token buffer.  CurTok is the current
-/// token the parser is looking at.  getNextToken reads another token from the
-/// lexer and updates CurTok with its results.
-static Token__ CurTok;
-
-inline Coords LastLine = 1;
-inline Coords LastCol  = 0;
-
-static auto setNumVal(const std::string& numStr, bool isFloatLike, bool hasFSuffix) -> int
+static auto setNumVal(CompilerInstance& CI, const std::string& numStr, bool isFloatLike,
+                      bool hasFSuffix) -> int
 {
+  auto& NumVal = CI.NumVal;
+
   try
   {
     if (isFloatLike && hasFSuffix)
@@ -51,12 +48,12 @@ static auto setNumVal(const std::string& numStr, bool isFloatLike, bool hasFSuff
   }
   catch (const std::invalid_argument&)
   {
-    Err::LogError("Invalid number literal!");
+    Err::LogError(CI, "Invalid number literal!");
     return tok_double; // define this as needed
   }
   catch (const std::out_of_range&)
   {
-    Err::LogError("Number out of range!");
+    Err::LogError(CI, "Number out of range!");
     return tok_double; // define this as needed
   }
 }
@@ -65,9 +62,10 @@ static auto setNumVal(const std::string& numStr, bool isFloatLike, bool hasFSuff
 // Tokenizer
 //===----------------------------------------------------------------------===//
 
-static auto getNextChar() -> int
+static auto getNextChar(CompilerInstance& CI) -> int
 {
-  int ch = mareArgs.inputFileStream.get();
+  auto& fileCoords = CI.fileCoords;
+  int   ch         = CI.Args.inputFileStream.get();
 
   if (ch == '\n')
   {
@@ -82,20 +80,61 @@ static auto getNextChar() -> int
   return ch;
 }
 
+/// peekChar - The character after LastChar, without consuming it.
+static auto peekChar(CompilerInstance& CI) -> int { return CI.Args.inputFileStream.peek(); }
+
+/// TwoCharOperator - The token of the operator spelled First Second, or 0.
+inline auto TwoCharOperator(Token__ First, Token__ Second) -> Token__
+{
+  if (Second == '=')
+  {
+    switch (First)
+    {
+      case '<':
+        return tok_le;
+      case '>':
+        return tok_ge;
+      case '=':
+        return tok_eq;
+      case '!':
+        return tok_ne;
+    }
+  }
+  else if (First == '=' && Second == '>')
+    return tok_fatarrow;
+  else if (Second == First)
+  {
+    switch (First)
+    {
+      case '<':
+        return tok_shl;
+      case '>':
+        return tok_shr;
+      case '&':
+        return tok_and;
+      case '|':
+        return tok_or;
+    }
+  }
+  return 0;
+}
+
 /// gettok - Return the next token from standard input.
-static auto gettok() -> Token__
+static auto gettok(CompilerInstance& CI) -> Token__
 {
-  static Token__ LastChar = ' ';
+  auto& LastChar      = CI.LastChar;
+  auto& IdentifierStr = CI.IdentifierStr;
+  auto& StringVal     = CI.StringVal;
 
   // Skip any whitespace.
   while (isspace(LastChar))
-    LastChar = getNextChar();
+    LastChar = getNextChar(CI);
 
   // Handle string literals
   if (LastChar == '"')
   {
     StringVal = "";
-    while ((LastChar = getNextChar()) != '"' && LastChar != EOF)
+    while ((LastChar = getNextChar(CI)) != '"' && LastChar != EOF)
     {
       StringVal += LastChar;
     }
@@ -103,7 +142,7 @@ static auto gettok() -> Token__
     if (LastChar == EOF)
       return tok_eof;
 
-    LastChar = getNextChar(); // Consume closing quote
+    LastChar = getNextChar(CI); // Consume closing quote
     return tok_string;
   }
 
@@ -111,13 +150,21 @@ static auto gettok() -> Token__
   if (isalpha(LastChar) || LastChar == '_')
   { // identifier: [a-zA-Z][a-zA-Z0-9]*
     IdentifierStr = LastChar;
-    while (isalnum((LastChar = getNextChar())) || LastChar == '_')
+    while (isalnum((LastChar = getNextChar(CI))) || LastChar == '_')
       IdentifierStr += LastChar;
 
     if (IdentifierStr == "fn")
       return tok_def;
+    if (IdentifierStr == "gen")
+      return tok_gen;
+    if (IdentifierStr == "yield")
+      return tok_yield;
+    if (IdentifierStr == "spawn")
+      return tok_spawn;
     if (IdentifierStr == "extern")
       return tok_extern;
+    if (IdentifierStr == "asm")
+      return tok_asm;
     if (IdentifierStr == "if")
       return tok_if;
     if (IdentifierStr == "then")
@@ -126,6 +173,16 @@ static auto gettok() -> Token__
       return tok_else;
     if (IdentifierStr == "for")
       return tok_for;
+    if (IdentifierStr == "pfor")
+      return tok_pfor;
+    if (IdentifierStr == "while")
+      return tok_while;
+    if (IdentifierStr == "break")
+      return tok_break;
+    if (IdentifierStr == "continue")
+      return tok_continue;
+    if (IdentifierStr == "match")
+      return tok_match;
     if (IdentifierStr == "in")
       return tok_in;
     if (IdentifierStr == "grab")
@@ -136,11 +193,15 @@ static auto gettok() -> Token__
       return tok_unary;
     if (IdentifierStr == "var")
       return tok_var;
+    if (IdentifierStr == "const")
+      return tok_const;
+    if (IdentifierStr == "global")
+      return tok_global;
     if (IdentifierStr == "void")
       return tok_void;
-    if (IdentifierStr == "double")
+    if (IdentifierStr == "double" || IdentifierStr == "f64")
       return tok_double;
-    if (IdentifierStr == "float" || IdentifierStr == "flt")
+    if (IdentifierStr == "float" || IdentifierStr == "flt" || IdentifierStr == "f32")
       return tok_float;
     if (IdentifierStr == "int" || IdentifierStr == "i64")
       return tok_int64;
@@ -150,15 +211,77 @@ static auto gettok() -> Token__
       return tok_int16;
     if (IdentifierStr == "i8")
       return tok_int8;
+    if (IdentifierStr == "u64")
+      return tok_uint64;
+    if (IdentifierStr == "u32")
+      return tok_uint32;
+    if (IdentifierStr == "u16")
+      return tok_uint16;
+    if (IdentifierStr == "u8")
+      return tok_uint8;
     if (IdentifierStr == "string")
       return tok_string;
+    if (IdentifierStr == "bool")
+      return tok_bool;
     if (IdentifierStr == "ret")
       return tok_ret;
+    if (IdentifierStr == "new")
+      return tok_new;
+    if (IdentifierStr == "delete")
+      return tok_delete;
+    if (IdentifierStr == "vec")
+      return tok_vec;
+    if (IdentifierStr == "struct")
+      return tok_struct;
     return tok_identifier;
   }
 
-  // Handle numbers (integers and floating points)
-  if (isdigit(LastChar) || LastChar == '.')
+  // Handle attributes: '@' identifier (name is left in IdentifierStr)
+  if (LastChar == '@')
+  {
+    IdentifierStr = "";
+    while (isalnum((LastChar = getNextChar(CI))) || LastChar == '_')
+      IdentifierStr += LastChar;
+
+    if (IdentifierStr.empty())
+      return '@';
+    return tok_attribute;
+  }
+
+  // Handle hexadecimal integers: 0x... (values above the i64 range keep their bits)
+  if (LastChar == '0' && (peekChar(CI) == 'x' || peekChar(CI) == 'X'))
+  {
+    getNextChar(CI); // eat 'x'
+    std::string HexStr;
+    while (isxdigit(LastChar = getNextChar(CI)))
+      HexStr += LastChar;
+
+    if (HexStr.empty() || HexStr.size() > 16)
+      Err::LogError(CI, "Invalid hexadecimal literal!");
+
+    const u64 Val = std::stoull(HexStr, nullptr, 16);
+    if (Val > static_cast<u64>(Util::dtype_max<i64>()))
+    {
+      CI.NumVal = static_cast<i64>(Val);
+      CI.NumTok = tok_int64;
+    }
+    else
+      CI.NumTok = setNumVal(CI, std::to_string(Val), false, false);
+    return tok_number;
+  }
+
+  // Handle the range operator '..' before a '.' can start a number (`0..5`).
+  if (LastChar == '.' && peekChar(CI) == '.')
+  {
+    getNextChar(CI); // Consume the second '.'
+    LastChar = getNextChar(CI);
+    return tok_dotdot;
+  }
+
+  // Handle numbers (integers and floating points). A '.' only belongs to a
+  // number when a digit follows it, so `xs.len` lexes as `xs` '.' `len`.
+  auto isDecimalPoint = [&] { return LastChar == '.' && isdigit(peekChar(CI)); };
+  if (isdigit(LastChar) || isDecimalPoint())
   {
     std::string NumStr;
     bool        isFloatLike = false;
@@ -169,17 +292,17 @@ static auto gettok() -> Token__
         isFloatLike = true;
 
       NumStr += LastChar;
-      LastChar = getNextChar();
-    } while (isdigit(LastChar) || LastChar == '.');
+      LastChar = getNextChar(CI);
+    } while (isdigit(LastChar) || isDecimalPoint());
 
     bool hasFSuffix = false;
     if (LastChar == 'f' || LastChar == 'F')
     {
       hasFSuffix = true;
-      LastChar   = getNextChar();
+      LastChar   = getNextChar(CI);
     }
 
-    NumTok = setNumVal(NumStr, isFloatLike, hasFSuffix);
+    CI.NumTok = setNumVal(CI, NumStr, isFloatLike, hasFSuffix);
 
     return tok_number;
   }
@@ -188,64 +311,82 @@ static auto gettok() -> Token__
   if (LastChar == '#')
   {
     do
-      LastChar = getNextChar();
+      LastChar = getNextChar(CI);
     while (LastChar != EOF && LastChar != '\n' && LastChar != '\r');
 
     if (LastChar != EOF)
-      return gettok();
+      return gettok(CI);
   }
 
   // Handle the arrow token '->'
   if (LastChar == '-')
   {
-    LastChar = getNextChar();
+    LastChar = getNextChar(CI);
     if (LastChar == '>')
     {
-      LastChar = getNextChar(); // Consume '>'
+      LastChar = getNextChar(CI); // Consume '>'
       return tok_arrow;         // Return the token for '->'
     }
     return '-'; // Otherwise, return just '-'
   }
 
+  // Handle the two-character operators '<<', '>>', '<=', '>=', '==', '!=', '&&', '||', '=>'
+  if (Token__ Op = TwoCharOperator(LastChar, peekChar(CI)))
+  {
+    getNextChar(CI); // Consume the second character
+    LastChar = getNextChar(CI);
+    return Op;
+  }
+
   // Check for end of file. Don't eat the EOF.
   if (LastChar == EOF)
     return tok_eof;
 
   // Otherwise, just return the character as its ASCII value.
   Token__ ThisChar = LastChar;
-  LastChar         = getNextChar();
+  LastChar         = getNextChar(CI);
   return ThisChar;
 }
 
-inline auto IsCurTokOverBlock() -> bool { return (CurTok == '}' || CurTok == tok_eof); }
+inline auto IsCurTokOverBlock(const CompilerInstance& CI) -> bool
+{
+  return (CI.CurTok == '}' || CI.CurTok == tok_eof);
+}
 
-inline auto TokenIsValidInt() -> bool
+inline auto TokenIsValidInt(const CompilerInstance& CI) -> bool
 {
-  return CurTok == tok_int64 || CurTok == tok_int32 || CurTok == tok_int16 || CurTok == tok_int8;
+  return CI.CurTok == tok_int64 || CI.CurTok == tok_int32 || CI.CurTok == tok_int16 ||
+         CI.CurTok == tok_int8 || CI.CurTok == tok_uint64 || CI.CurTok == tok_uint32 ||
+         CI.CurTok == tok_uint16 || CI.CurTok == tok_uint8;
 }
 
-inline auto TokenIsValidArg() -> bool
+inline auto TokenIsValidArg(const CompilerInstance& CI) -> bool
 {
-  return (CurTok == tok_identifier || CurTok == tok_double || CurTok == tok_float ||
-          CurTok == tok_string || TokenIsValidInt());
+  return (CI.CurTok == tok_identifier || CI.CurTok == tok_double || CI.CurTok == tok_float ||
+          CI.CurTok == tok_string || CI.CurTok == tok_bool || CI.CurTok == '[' ||
+          CI.CurTok == tok_vec || TokenIsValidInt(CI));
 }
 
-inline auto CurTokChar() -> char { return (char)CurTok; }
+inline auto CurTokChar(const CompilerInstance& CI) -> char { return (char)CI.CurTok; }
 
-inline auto IsCurTokAscii() -> bool { return isascii(CurTok); }
+inline auto IsCurTokAscii(const CompilerInstance& CI) -> bool { return isascii(CI.CurTok); }
 
-inline auto IsCurTokPrimaryExpr() -> bool
+inline auto IsCurTokPrimaryExpr(const CompilerInstance& CI) -> bool
 {
-  return (!IsCurTokAscii() || CurTok == '(' || CurTok == ',');
+  return (!IsCurTokAscii(CI) || CI.CurTok == '(' || CI.CurTok == ',' || CI.CurTok == '[' ||
+          CI.CurTok == '{');
 }
 
-static auto getNextToken() -> Token__ { return CurTok = gettok(); }
+/// CurTok/getNextToken - Provide a simple token buffer.  CI.CurTok is the current
+/// token the parser is looking at.  getNextToken reads another token from the
+/// lexer and updates CI.CurTok with its results.
+static auto getNextToken(CompilerInstance& CI) -> Token__ { return CI.CurTok = gettok(CI); }
 
-inline auto assignDTypeToNumExpr() -> llvm::Type*
+inline auto assignDTypeToNumExpr(CompilerInstance& CI) -> llvm::Type*
 {
   llvm::Type* llvmType = nullptr;
 
-  switch (Global::NumTok)
+  switch (CI.NumTok)
   {
     case tok_int8:
       llvmType = MARE_INT8_TYPE;
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Compiler.hpp"
+#include "CompilerInstance.hpp"
+#include "PrimitiveTypes.hpp"
+#include <algorithm>
+#include <numeric>
+
+//===----------------------------------------------------------------------===//
+// Aggregate Types
+//
+//   [T; N]    fixed-size array, lowered to the LLVM array `[N x T]`
+//   [T]       slice, lowered to the named struct `mare.slice.T = { ptr, i64 }`
+//   struct S  record, lowered to the named struct `S`
+//   (T, U)    tuple, lowered to the literal struct `{ T, U }`
+//
+// Opaque pointers do not remember what they point to, so every slice type is
+// registered in CompilerInstance::SliceElementTypes when it is created.
+//
+// Slices of a `@layout(soa)` struct keep the same `{ ptr, i64 }` shape, but the
+// data block holds one array per field instead of one struct per element:
+//
+//   struct P { f32 x; f64 y; }     data: [y0 .. yN-1][x0 .. xN-1]
+//
+// Fields are placed largest first, so every field array starts aligned.
+//===----------------------------------------------------------------------===//
+
+namespace Mare::Types
+{
+
+/// TypeName - Spelling of a type inside generated type names.
+inline auto TypeName(llvm::Type* T) -> std::string
+{
+  if (auto* ST = llvm::dyn_cast<llvm::StructType>(T); ST && ST->hasName())
+    return ST->getName().str();
+
+  std::string              Name;
+  llvm::raw_string_ostream OS(Name);
+  T->print(OS);
+  return OS.str();
+}
+
+/// GetSliceType - The (unique) slice type with the given element type.
+inline auto GetSliceType(CompilerInstance& CI, llvm::Type* Elem) -> llvm::StructType*
+{
+  const std::string Name = __MARE_SLICE_TYPE_PREFIX__ + TypeName(Elem);
+  if (auto* ST = llvm::StructType::getTypeByName(*CI.TheContext, Name))
+    return ST;
+
+  auto* ST = llvm::StructType::create(*CI.TheContext, {MARE_PTR_TYPE, MARE_INT64_TYPE}, Name);
+  CI.SliceElementTypes[ST] = Elem;
+  return ST;
+}
+
+/// SliceElementType - Element type of a slice type, null if T is not a slice.
+inline auto SliceElementType(const CompilerInstance& CI, llvm::Type* T) -> llvm::Type*
+{
+  auto It = CI.SliceElementTypes.find(T);
+  return It != CI.SliceElementTypes.end() ? It->second : nullptr;
+}
+
+inline auto IsSliceType(const CompilerInstance& CI, llvm::Type* T) -> bool
+{
+  return SliceElementType(CI, T) != nullptr;
+}
+
+/// ElementType - Element type of an array or a slice, null for anything else.
+inline auto ElementType(const CompilerInstance& CI, llvm::Type* T) -> llvm::Type*
+{
+  if (auto* AT = llvm::dyn_cast<llvm::ArrayType>(T))
+    return AT->getElementType();
+  return SliceElementType(CI, T);
+}
+
+/// FindStruct - The declaration behind a struct type, null if T is not one.
+inline auto FindStruct(const CompilerInstance& CI, llvm::Type* T) -> const StructInfo*
+{
+  auto* ST = llvm::dyn_cast<llvm::StructType>(T);
+  if (!ST || !ST->hasName())
+    return nullptr;
+
+  auto It = CI.Structs.find(ST->getName().str());
+  return It != CI.Structs.end() && It->second.Ty == ST ? &It->second : nullptr;
+}
+
+inline auto FindStruct(const CompilerInstance& CI, const std::string& Name) -> const StructInfo*
+{
+  auto It = CI.Structs.find(Name);
+  return It != CI.Structs.end() ? &It->second : nullptr;
+}
+
+/// IsSoAType - Whether slices of T are stored field by field.
+inline auto IsSoAType(const CompilerInstance& CI, llvm::Type* T) -> bool
+{
+  const StructInfo* S = FindStruct(CI, T);
+  return S && S->SoA;
+}
+
+/// IsUnsignedField - Whether the field Name of struct type T was declared u8..u64.
+inline auto IsUnsignedField(const CompilerInstance& CI, llvm::Type* T, const std::string& Name)
+  -> bool
+{
+  const StructInfo* S = FindStruct(CI, T);
+  if (!S)
+    return false;
+  auto It = std::find(S->Fields.begin(), S->Fields.end(), Name);
+  return It != S->Fields.end() && S->UnsignedFields[It - S->Fields.begin()];
+}
+
+/// DeclareStruct - Create the struct type and (for SoA) the field array layout.
+/// Returns an error message, empty on success.
+inline auto DeclareStruct(CompilerInstance& CI, const std::string& Name,
+                          std::vector<std::pair<std::string, llvm::Type*>> Fields,
+                          std::vector<bool> UnsignedFields, bool SoA) -> std::string
+{
+  if (CI.Structs.contains(Name))
+    return "Redefinition of struct '" + Name + "'";
+
+  StructInfo                S;
+  std::vector<llvm::Type*> FieldTypes;
+  for (const auto& [FieldName, FieldType] : Fields)
+  {
+    if (FieldName == "len")
+      return "'len' is reserved and cannot name a struct field";
+    if (std::find(S.Fields.begin(), S.Fields.end(), FieldName) != S.Fields.end())
+      return "Duplicate field '" + FieldName + "' in struct '" + Name + "'";
+    if (SoA && FieldType->getPrimitiveSizeInBits().getFixedValue() == 0)
+      return "Field '" + FieldName + "' of a '@layout(soa)' struct must be a number or vector";
+    S.Fields.push_back(FieldName);
+    FieldTypes.push_back(FieldType);
+  }
+
+  S.Ty             = llvm::StructType::create(*CI.TheContext, FieldTypes, Name);
+  S.UnsignedFields = std::move(UnsignedFields);
+  S.SoA            = SoA;
+
+  if (SoA)
+  {
+    // A column holds one element per byte stride of the type: bools take a whole
+    // byte, and a vector is padded to a power of two bytes (<3 x float> to 16),
+    // like every element of an array of it.
+    auto Bytes = [&](unsigned i) -> unsigned
+    {
+      const u64 Bits = FieldTypes[i]->getPrimitiveSizeInBits().getFixedValue();
+      const u64 Size = llvm::divideCeil(Bits, 8);
+      return FieldTypes[i]->isVectorTy() ? llvm::PowerOf2Ceil(Size) : Size;
+    };
+
+    std::vector<unsigned> Order(FieldTypes.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::stable_sort(Order.begin(), Order.end(),
+                     [&](unsigned A, unsigned B) { return Bytes(A) > Bytes(B); });
+
+    S.SoAOffsets.resize(FieldTypes.size());
+    for (unsigned i : Order)
+    {
+      S.SoAOffsets[i] = S.SoAStride;
+      S.SoAStride += Bytes(i);
+    }
+  }
+
+  CI.Structs.emplace(Name, std::move(S));
+  return {};
+}
+
+} // namespace Mare::Types
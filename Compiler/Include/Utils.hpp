@@ -1,4 +1,7 @@
+#pragma once
+
 #include "Compiler.hpp"
+#include "CompilerInstance.hpp"
 #include "Globals.hpp"
 #include "PrimitiveTypes.hpp"
 #include <string>
@@ -46,9 +49,16 @@ inline auto GetConstantFromValue(const Global::ValueVariant& val, llvm::Type* va
     val);
 }
 
-auto StringCheckForEscapeSequences(int idx, std::string& ProcessedStr) -> void
+/// ValueAsInt - Truncating view of a numeric literal as an integer.
+inline auto ValueAsInt(const Global::ValueVariant& val) -> i64
+{
+  return std::visit([](auto&& v) -> i64 { return static_cast<i64>(v); }, val);
+}
+
+auto StringCheckForEscapeSequences(const std::string& RawStr, int idx, std::string& ProcessedStr)
+  -> void
 {
-  switch (Global::StringVal[idx + 1])
+  switch (RawStr[idx + 1])
   {
     case 'n':
       ProcessedStr += ESCAPE_SEQUENCE_NEWLINE;
@@ -79,26 +89,26 @@ auto StringCheckForEscapeSequences(int idx, std::string& ProcessedStr) -> void
       break; // Double quote
 
     default:
-      ProcessedStr += Global::StringVal[idx];     // Keep original '\'
-      ProcessedStr += Global::StringVal[idx + 1]; // Keep next char as is
+      ProcessedStr += RawStr[idx];     // Keep original '\'
+      ProcessedStr += RawStr[idx + 1]; // Keep next char as is
   }
 }
 
-static auto ProcessString() -> std::string
+static auto ProcessString(const std::string& RawStr) -> std::string
 {
   std::string processedStr;
 
-  for (size_t i = 0; i < Global::StringVal.size(); ++i)
+  for (size_t i = 0; i < RawStr.size(); ++i)
   {
-    if (Global::StringVal[i] == ESCAPE_SEQUENCE_BACKSLASH &&
-        i + 1 < Global::StringVal.size()) // Check for escape sequences
+    if (RawStr[i] == ESCAPE_SEQUENCE_BACKSLASH &&
+        i + 1 < RawStr.size()) // Check for escape sequences
     {
-      Util::StringCheckForEscapeSequences(i, processedStr);
+      Util::StringCheckForEscapeSequences(RawStr, i, processedStr);
       ++i; // Skip next char as it’s part of escape sequence
     }
     else
     {
-      processedStr += Global::StringVal[i]; // Normal character
+      processedStr += RawStr[i]; // Normal character
     }
   }
 
@@ -106,7 +116,7 @@ static auto ProcessString() -> std::string
 }
 
 // Utility to parse return type
-static auto ParseReturnTypeProto(const Token__ CurTok) -> llvm::Type*
+static auto ParseReturnTypeProto(CompilerInstance& CI, const Token__ CurTok) -> llvm::Type*
 {
   switch (CurTok)
   {
@@ -118,17 +128,30 @@ static auto ParseReturnTypeProto(const Token__ CurTok) -> llvm::Type*
       return MARE_FLOAT_TYPE;
     case tok_string:
       return MARE_STRPTR_TYPE;
+    case tok_bool:
+      return MARE_INT1_TYPE;
     case tok_int8:
+    case tok_uint8:
       return MARE_INT8_TYPE;
     case tok_int16:
+    case tok_uint16:
       return MARE_INT16_TYPE;
     case tok_int32:
+    case tok_uint32:
       return MARE_INT32_TYPE;
     case tok_int64:
+    case tok_uint64:
       return MARE_INT64_TYPE;
     default:
       return nullptr;
   }
 }
 
+/// IsUnsignedTypeToken - u8..u64 lower to the same LLVM types as i8..i64; the
+/// frontend tracks their signedness itself (see Expr::isUnsigned).
+inline auto IsUnsignedTypeToken(const Token__ Tok) -> bool
+{
+  return Tok == tok_uint8 || Tok == tok_uint16 || Tok == tok_uint32 || Tok == tok_uint64;
+}
+
 } // namespace Mare::Util
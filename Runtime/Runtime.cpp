@@ -1,8 +1,21 @@
 #include "Runtime.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <cinttypes>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <type_traits>
 
 // ----------------------------
@@ -19,6 +32,80 @@ template <typename T> inline void print(const char* fmt, T value)
 
 } // namespace Mare::RT
 
+// ----------------------------
+// Formatted Printing (`print`)
+// ----------------------------
+
+namespace Mare::RT::Format
+{
+
+/// Buffer - The text of one print call, written to stderr in as few writes as
+/// possible.
+class Buffer
+{
+  char   Data[MARE_PRINT_BUFFER];
+  size_t Size = 0;
+
+public:
+  ~Buffer() { flush(); }
+
+  void flush()
+  {
+    std::fwrite(Data, 1, Size, stderr);
+    Size = 0;
+  }
+
+  void append(const char* Text, size_t Len)
+  {
+    if (Size + Len > sizeof(Data))
+    {
+      flush();
+      if (Len > sizeof(Data))
+      {
+        std::fwrite(Text, 1, Len, stderr);
+        return;
+      }
+    }
+    std::memcpy(Data + Size, Text, Len);
+    Size += Len;
+  }
+
+  /// number - Append Value as std::to_chars spells it; Digits holds any double
+  /// with MARE_PRINT_PRECISION digits after the point.
+  template <typename T, typename... Format> void number(T Value, Format... F)
+  {
+    char Digits[512];
+    auto Result = std::to_chars(Digits, Digits + sizeof(Digits), Value, F...);
+    append(Digits, Result.ptr - Digits);
+  }
+};
+
+/// asFloat - The T whose bits fill the low end of Bits.
+template <typename T> inline auto asFloat(uint64_t Bits) -> T
+{
+  T Value;
+  if constexpr (sizeof(T) == sizeof(uint32_t))
+  {
+    const uint32_t Low = static_cast<uint32_t>(Bits);
+    std::memcpy(&Value, &Low, sizeof(Value));
+  }
+  else
+    std::memcpy(&Value, &Bits, sizeof(Value));
+  return Value;
+}
+
+/// floating - Append the shortest spelling that reads back as Value, or Digits
+/// digits after the point.
+template <typename T> inline void floating(Buffer& Out, T Value, int32_t Digits)
+{
+  if (Digits < 0)
+    Out.number(Value);
+  else
+    Out.number(Value, std::chars_format::fixed, Digits);
+}
+
+} // namespace Mare::RT::Format
+
 // ----------------------------
 // Templated Math Wrappers
 // ----------------------------
@@ -32,6 +119,294 @@ template <typename T, typename Fn> inline auto binary(Fn func, T x, T y) -> T {
 
 } // namespace Mare::RT::Ops
 
+// ----------------------------
+// Memoization Tables
+// ----------------------------
+
+namespace Mare::RT::Memo
+{
+
+struct Entry
+{
+  uint64_t key[MARE_MEMO_MAX_ARITY];
+  uint64_t value;
+  uint32_t arity;
+  bool     used;
+};
+
+struct Table
+{
+  Entry entries[MARE_MEMO_CAPACITY];
+};
+
+struct Stats
+{
+  std::atomic<const char*> name{nullptr};
+  std::atomic<int64_t>     hits{0};
+  std::atomic<int64_t>     misses{0};
+};
+
+// Tables are allocated lazily, per thread; counters are process wide.
+thread_local std::unique_ptr<Table> tables[MARE_MEMO_MAX_TABLES];
+Stats                               stats[MARE_MEMO_MAX_TABLES];
+
+// FNV-1a over the argument slots
+inline auto hash(const uint64_t* key, uint32_t arity) -> uint64_t
+{
+  uint64_t h = 1469598103934665603ULL;
+  for (uint32_t i = 0; i < arity; ++i)
+  {
+    h ^= key[i];
+    h *= 1099511628211ULL;
+  }
+  return h ^ (h >> 29);
+}
+
+inline auto matches(const Entry& e, const uint64_t* key, uint32_t arity) -> bool
+{
+  return e.used && e.arity == arity && std::memcmp(e.key, key, arity * sizeof(uint64_t)) == 0;
+}
+
+inline auto find(const char* name) -> Stats*
+{
+  for (auto& s : stats)
+  {
+    const char* n = s.name.load(std::memory_order_relaxed);
+    if (n && std::strcmp(n, name) == 0)
+      return &s;
+  }
+  return nullptr;
+}
+
+} // namespace Mare::RT::Memo
+
+// ----------------------------
+// Coroutine Frames
+// ----------------------------
+
+namespace Mare::RT::Coro
+{
+
+// Every frame starts with a header holding its size; the frame itself follows,
+// aligned for any scalar the compiler spills into it.
+struct alignas(alignof(std::max_align_t)) Header
+{
+  int64_t bytes;
+};
+
+// Generators are usually created and drained in a loop, so a few freed frames
+// are kept per thread and handed out again to requests of the same size.
+struct FrameCache
+{
+  Header*  frames[MARE_CORO_CACHED_FRAMES] = {};
+  uint32_t count                           = 0;
+
+  ~FrameCache()
+  {
+    for (uint32_t i = 0; i < count; ++i)
+      std::free(frames[i]);
+  }
+};
+
+thread_local FrameCache cache;
+
+} // namespace Mare::RT::Coro
+
+// ----------------------------
+// Threads
+// ----------------------------
+
+namespace Mare::RT::Threads
+{
+
+// A spawned thread and the result of its entry point; the handle Mare code
+// holds is the address of the Task.
+struct Task
+{
+  std::thread thread;
+  int64_t     result = 0;
+};
+
+} // namespace Mare::RT::Threads
+
+// ----------------------------
+// Parallel Loops (work stealing)
+// ----------------------------
+
+namespace Mare::RT::Pool
+{
+
+using Chunk = void (*)(void* ctx, int64_t lo, int64_t hi);
+
+// One `pfor`: its outlined body and the iterations still to run. Counts are
+// unsigned, since lo..hi may span more than INT64_MAX iterations.
+struct Loop
+{
+  Chunk                 chunk;
+  void*                 ctx;
+  uint64_t              grain; // Pieces this small are run, not split
+  std::atomic<uint64_t> left;
+};
+
+struct Range
+{
+  Loop*   loop;
+  int64_t lo, hi;
+
+  auto size() const -> uint64_t { return static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo); }
+};
+
+// The owner pushes and pops at the back, so it keeps working on the piece it
+// split last; thieves take from the front, where the largest pieces are.
+struct Deque
+{
+  std::mutex        lock;
+  std::deque<Range> ranges;
+
+  void push(Range r)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    ranges.push_back(r);
+  }
+
+  auto pop(Range& r) -> bool
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (ranges.empty())
+      return false;
+    r = ranges.back();
+    ranges.pop_back();
+    return true;
+  }
+
+  auto steal(Range& r) -> bool
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (ranges.empty())
+      return false;
+    r = ranges.front();
+    ranges.pop_front();
+    return true;
+  }
+};
+
+class Scheduler
+{
+  // deques[0] is shared by the threads outside the pool; worker i owns deques[i].
+  std::vector<std::unique_ptr<Deque>> deques;
+  std::vector<std::thread>            workers;
+  std::mutex                          sleepLock;
+  std::condition_variable             wake;
+  std::atomic<int64_t>                running{0}; // Loops not finished yet
+  bool                                stopping = false;
+
+  static thread_local size_t self; // Index of this thread's deque
+
+  // Split r in halves until it is no larger than the grain, leaving the upper
+  // halves to be stolen, then run what is left.
+  void run(Range r)
+  {
+    Deque& own = *deques[self];
+    while (r.size() > r.loop->grain)
+    {
+      const int64_t mid = r.lo + static_cast<int64_t>(r.size() / 2);
+      own.push({r.loop, mid, r.hi});
+      r.hi = mid;
+      wake.notify_one();
+    }
+
+    r.loop->chunk(r.loop->ctx, r.lo, r.hi);
+    r.loop->left.fetch_sub(r.size(), std::memory_order_acq_rel);
+  }
+
+  // Run one piece of any loop: the thread's own newest one, or else the
+  // oldest one of another deque.
+  auto runOne() -> bool
+  {
+    Range r;
+    bool  found = deques[self]->pop(r);
+    for (size_t i = 1; !found && i < deques.size(); ++i)
+      found = deques[(self + i) % deques.size()]->steal(r);
+
+    if (found)
+      run(r);
+    return found;
+  }
+
+  void work(size_t index)
+  {
+    self = index;
+    while (true)
+    {
+      if (runOne())
+        continue;
+
+      std::unique_lock<std::mutex> guard(sleepLock);
+      if (stopping)
+        return;
+      if (running.load(std::memory_order_acquire) == 0)
+        wake.wait(guard);
+      else
+        wake.wait_for(guard, std::chrono::microseconds(100)); // Pieces may appear any time
+    }
+  }
+
+public:
+  Scheduler()
+  {
+    const unsigned n = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned i = 0; i < n; ++i)
+      deques.push_back(std::make_unique<Deque>());
+    for (unsigned i = 1; i < n; ++i)
+      workers.emplace_back([this, i] { work(i); });
+  }
+
+  ~Scheduler()
+  {
+    {
+      std::lock_guard<std::mutex> guard(sleepLock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers)
+      w.join();
+  }
+
+  static auto get() -> Scheduler&
+  {
+    static Scheduler pool;
+    return pool;
+  }
+
+  auto threads() const -> int64_t { return static_cast<int64_t>(deques.size()); }
+
+  // Run chunk over lo..hi and return when every iteration is done. The calling
+  // thread works on it too, so a `pfor` inside a `pfor` cannot deadlock.
+  void parallelFor(Chunk chunk, void* ctx, int64_t lo, int64_t hi)
+  {
+    const uint64_t n      = Range{nullptr, lo, hi}.size();
+    const uint64_t pieces = static_cast<uint64_t>(threads()) * MARE_PFOR_PIECES;
+    Loop           loop{chunk, ctx, std::max<uint64_t>(1, n / pieces), {n}};
+
+    {
+      std::lock_guard<std::mutex> guard(sleepLock);
+      running.fetch_add(1, std::memory_order_acq_rel);
+    }
+    wake.notify_all();
+
+    run({&loop, lo, hi});
+    while (loop.left.load(std::memory_order_acquire) > 0)
+      if (!runOne())
+        std::this_thread::yield();
+
+    running.fetch_sub(1, std::memory_order_acq_rel);
+  }
+};
+
+thread_local size_t Scheduler::self = 0;
+
+} // namespace Mare::RT::Pool
+
 // ----------------------------
 // Macro Helpers
 // ----------------------------
@@ -65,6 +440,51 @@ extern "C"
   MARE_COMPILER_RT_API void __mare_printi32(int32_t x) { Mare::RT::print("%" PRId32, x); }
   MARE_COMPILER_RT_API void __mare_printi64(int64_t x) { Mare::RT::print("%" PRId64, x); }
 
+  // The plan was laid out by the compiler: every step already knows the type of
+  // its value, so nothing here parses a format.
+  MARE_COMPILER_RT_API void __mare_print(const MarePrintStep* plan, int64_t steps,
+                                         const uint64_t* args)
+  {
+    using namespace Mare::RT::Format;
+
+    Buffer Out;
+    for (int64_t i = 0; i != steps; ++i)
+    {
+      const MarePrintStep& S = plan[i];
+      switch (S.Kind)
+      {
+        case MARE_PRINT_TEXT:
+          Out.append(S.Text, S.Arg);
+          continue;
+        case MARE_PRINT_I64:
+          Out.number(static_cast<int64_t>(*args));
+          break;
+        case MARE_PRINT_U64:
+          Out.number(*args);
+          break;
+        case MARE_PRINT_HEX:
+          Out.number(*args, 16);
+          break;
+        case MARE_PRINT_F64:
+          floating(Out, asFloat<F64>(*args), S.Arg);
+          break;
+        case MARE_PRINT_F32:
+          floating(Out, asFloat<F32>(*args), S.Arg);
+          break;
+        case MARE_PRINT_STR:
+        {
+          const char* Str = reinterpret_cast<const char*>(*args);
+          Out.append(Str, std::strlen(Str));
+          break;
+        }
+        case MARE_PRINT_BOOL:
+          Out.append(*args ? "true" : "false", *args ? 4 : 5);
+          break;
+      }
+      ++args;
+    }
+  }
+
   MARE_COMPILER_RT_API auto putchard(F64 x) -> F64
   {
     std::fputc(static_cast<unsigned char>(static_cast<int>(x)), stderr);
@@ -109,4 +529,191 @@ extern "C"
   DEFINE_BINARY_OP_ABI(fmod, F64, d, static_cast<F64Fn2>(std::fmod))
   DEFINE_BINARY_OP_ABI(fmod, F32, f, static_cast<F32Fn2>(std::fmodf))
 
+  // Memoization
+  MARE_COMPILER_RT_API auto __mare_memo_lookup(uint32_t table, const uint64_t* key, uint32_t arity,
+                                               uint64_t* out) -> uint8_t
+  {
+    using namespace Mare::RT::Memo;
+
+    if (table >= MARE_MEMO_MAX_TABLES || arity > MARE_MEMO_MAX_ARITY)
+      return 0;
+
+    if (const auto& t = tables[table])
+    {
+      uint64_t h = hash(key, arity);
+      for (uint32_t p = 0; p < MARE_MEMO_PROBES; ++p)
+      {
+        const Entry& e = t->entries[(h + p) & (MARE_MEMO_CAPACITY - 1)];
+        if (!e.used)
+          break;
+        if (matches(e, key, arity))
+        {
+          *out = e.value;
+          stats[table].hits.fetch_add(1, std::memory_order_relaxed);
+          return 1;
+        }
+      }
+    }
+
+    stats[table].misses.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  MARE_COMPILER_RT_API void __mare_memo_store(uint32_t table, const char* name,
+                                              const uint64_t* key, uint32_t arity, uint64_t value)
+  {
+    using namespace Mare::RT::Memo;
+
+    if (table >= MARE_MEMO_MAX_TABLES || arity > MARE_MEMO_MAX_ARITY)
+      return;
+
+    const char* expected = nullptr;
+    stats[table].name.compare_exchange_strong(expected, name, std::memory_order_relaxed);
+
+    auto& t = tables[table];
+    if (!t)
+      t = std::make_unique<Table>();
+
+    // Take the first free or matching slot in the probe window, else evict the home slot.
+    uint64_t h      = hash(key, arity);
+    Entry*   victim = &t->entries[h & (MARE_MEMO_CAPACITY - 1)];
+    for (uint32_t p = 0; p < MARE_MEMO_PROBES; ++p)
+    {
+      Entry& e = t->entries[(h + p) & (MARE_MEMO_CAPACITY - 1)];
+      if (!e.used || matches(e, key, arity))
+      {
+        victim = &e;
+        break;
+      }
+    }
+
+    std::memcpy(victim->key, key, arity * sizeof(uint64_t));
+    victim->arity = arity;
+    victim->value = value;
+    victim->used  = true;
+  }
+
+  MARE_COMPILER_RT_API auto __mare_memo_hits(char* name) -> int64_t
+  {
+    auto* s = Mare::RT::Memo::find(name);
+    return s ? s->hits.load(std::memory_order_relaxed) : 0;
+  }
+
+  MARE_COMPILER_RT_API auto __mare_memo_misses(char* name) -> int64_t
+  {
+    auto* s = Mare::RT::Memo::find(name);
+    return s ? s->misses.load(std::memory_order_relaxed) : 0;
+  }
+
+  MARE_COMPILER_RT_API void __mare_memo_report()
+  {
+    for (const auto& s : Mare::RT::Memo::stats)
+    {
+      const char* name = s.name.load(std::memory_order_relaxed);
+      if (!name)
+        continue;
+      std::fprintf(stderr, "[memo] %s: %" PRId64 " hits, %" PRId64 " misses\n", name,
+                   s.hits.load(std::memory_order_relaxed),
+                   s.misses.load(std::memory_order_relaxed));
+    }
+  }
+
+  // Slice storage
+  MARE_COMPILER_RT_API auto __mare_alloc(int64_t bytes) -> void*
+  {
+    if (bytes <= 0)
+      return nullptr;
+
+    // aligned_alloc wants a multiple of the alignment
+    const size_t align = MARE_ALLOC_ALIGN;
+    const size_t size  = (static_cast<size_t>(bytes) + align - 1) & ~(align - 1);
+    void*        ptr   = std::aligned_alloc(align, size);
+    if (!ptr)
+    {
+      std::fprintf(stderr, "[mare] out of memory allocating %" PRId64 " bytes\n", bytes);
+      std::abort();
+    }
+
+    return std::memset(ptr, 0, size);
+  }
+
+  MARE_COMPILER_RT_API void __mare_free(void* ptr) { std::free(ptr); }
+
+  // Coroutine frames
+  MARE_COMPILER_RT_API auto __mare_coro_alloc(int64_t bytes) -> void*
+  {
+    using namespace Mare::RT::Coro;
+
+    for (uint32_t i = 0; i < cache.count; ++i)
+    {
+      Header* h = cache.frames[i];
+      if (h->bytes == bytes)
+      {
+        cache.frames[i] = cache.frames[--cache.count];
+        return h + 1;
+      }
+    }
+
+    auto* h = static_cast<Header*>(std::malloc(sizeof(Header) + static_cast<size_t>(bytes)));
+    if (!h)
+    {
+      std::fprintf(stderr, "[mare] out of memory allocating a %" PRId64 " byte frame\n", bytes);
+      std::abort();
+    }
+
+    h->bytes = bytes;
+    return h + 1;
+  }
+
+  MARE_COMPILER_RT_API void __mare_coro_free(void* frame)
+  {
+    using namespace Mare::RT::Coro;
+
+    Header* h = static_cast<Header*>(frame) - 1;
+    if (cache.count < MARE_CORO_CACHED_FRAMES)
+      cache.frames[cache.count++] = h;
+    else
+      std::free(h);
+  }
+
+  // Threads
+  MARE_COMPILER_RT_API auto __mare_spawn(int64_t (*entry)(void*), void* env) -> int64_t
+  {
+    using namespace Mare::RT::Threads;
+
+    auto* task   = new Task;
+    task->thread = std::thread([task, entry, env] { task->result = entry(env); });
+    return reinterpret_cast<int64_t>(task);
+  }
+
+  MARE_COMPILER_RT_API auto __mare_join(int64_t handle) -> int64_t
+  {
+    using namespace Mare::RT::Threads;
+
+    auto* task = reinterpret_cast<Task*>(handle);
+    task->thread.join();
+
+    const int64_t result = task->result;
+    delete task;
+    return result;
+  }
+
+  MARE_COMPILER_RT_API void __mare_parallel_for(void (*chunk)(void*, int64_t, int64_t), void* ctx,
+                                                int64_t lo, int64_t hi)
+  {
+    using namespace Mare::RT::Pool;
+
+    if (hi <= lo)
+      return;
+    if (hi == lo + 1)
+      return chunk(ctx, lo, hi);
+    Scheduler::get().parallelFor(chunk, ctx, lo, hi);
+  }
+
+  MARE_COMPILER_RT_API auto __mare_cpu_count() -> int64_t
+  {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1; // 0 means unknown
+  }
+
 } // extern "C"
@@ -22,6 +22,61 @@ using F64Fn2 = F64 (*)(F64, F64);
 using F32Fn  = F32 (*)(F32);
 using F32Fn2 = F32 (*)(F32, F32);
 
+// ----------------------------
+// Memoization Limits (@memo)
+// ----------------------------
+
+// Must match __MARE_MEMO_* in Compiler/Include/Compiler.hpp
+#define MARE_MEMO_MAX_TABLES 64
+#define MARE_MEMO_MAX_ARITY  8
+#define MARE_MEMO_CAPACITY   1024 // Entries per table (power of two)
+#define MARE_MEMO_PROBES     8    // Linear probe distance before evicting
+
+// ----------------------------
+// Parallel Loops (`pfor`)
+// ----------------------------
+
+// A loop is split into pieces of about n / (threads * MARE_PFOR_PIECES)
+// iterations, enough for idle threads to steal from the busy ones.
+#define MARE_PFOR_PIECES 8
+
+// ----------------------------
+// Formatted Printing (`print`)
+// ----------------------------
+
+// Must match __MARE_PRINT_* in Compiler/Include/Compiler.hpp
+#define MARE_PRINT_TEXT      0 // Text[0, Arg)
+#define MARE_PRINT_I64       1
+#define MARE_PRINT_U64       2
+#define MARE_PRINT_HEX       3
+#define MARE_PRINT_F64       4 // Arg digits after the point; the shortest form if negative
+#define MARE_PRINT_STR       5
+#define MARE_PRINT_BOOL      6
+#define MARE_PRINT_F32       7 // In the low 32 bits; Arg as for MARE_PRINT_F64
+#define MARE_PRINT_PRECISION 100
+#define MARE_PRINT_BUFFER    512 // Bytes formatted before each write
+
+// One step of a print plan; the compiler lays out a constant plan per call site.
+struct MarePrintStep
+{
+  int32_t     Kind;
+  int32_t     Arg;
+  const char* Text;
+};
+
+// ----------------------------
+// Slice Storage
+// ----------------------------
+
+// Must match __MARE_ALLOC_ALIGN__ in Compiler/Include/Compiler.hpp
+#define MARE_ALLOC_ALIGN 64 // Cache line; every vector width we emit divides it
+
+// ----------------------------
+// Coroutine Frames (`gen fn`)
+// ----------------------------
+
+#define MARE_CORO_CACHED_FRAMES 8 // Freed frames kept per thread for reuse
+
 // ------------------------------------------
 // Mare Runtime ABI - Header
 // ------------------------------------------
@@ -43,6 +98,8 @@ extern "C"
   MARE_COMPILER_RT_API void __mare_printi16(int16_t x);
   MARE_COMPILER_RT_API void __mare_printi32(int32_t x);
   MARE_COMPILER_RT_API void __mare_printi64(int64_t x);
+  MARE_COMPILER_RT_API void __mare_print(const MarePrintStep* plan, int64_t steps,
+                                         const uint64_t* args);
   MARE_COMPILER_RT_API auto __mare_putchard(F64 x) -> F64;
 
   // ------------------------------
@@ -89,6 +146,51 @@ extern "C"
   MARE_COMPILER_RT_API auto __mare_fmodd(F64 x, F64 y) -> F64;
   MARE_COMPILER_RT_API auto __mare_fmodf(F32 x, F32 y) -> F32;
 
+  // ------------------------------
+  // Memoization (@memo)
+  // ------------------------------
+
+  // Arguments and results are passed as raw 64-bit slots. Tables live in a
+  // thread-local buffer; hit/miss counters are shared by all threads.
+  MARE_COMPILER_RT_API auto __mare_memo_lookup(uint32_t table, const uint64_t* key, uint32_t arity,
+                                               uint64_t* out) -> uint8_t;
+  MARE_COMPILER_RT_API void __mare_memo_store(uint32_t table, const char* name,
+                                              const uint64_t* key, uint32_t arity, uint64_t value);
+  MARE_COMPILER_RT_API auto __mare_memo_hits(char* name) -> int64_t;
+  MARE_COMPILER_RT_API auto __mare_memo_misses(char* name) -> int64_t;
+  MARE_COMPILER_RT_API void __mare_memo_report();
+
+  // ------------------------------
+  // Slice Storage (`new T[n]`)
+  // ------------------------------
+
+  // Zero-filled, MARE_ALLOC_ALIGN aligned; aborts when out of memory.
+  MARE_COMPILER_RT_API auto __mare_alloc(int64_t bytes) -> void*;
+  MARE_COMPILER_RT_API void __mare_free(void* ptr);
+
+  // ------------------------------
+  // Coroutine Frames (`gen fn`)
+  // ------------------------------
+
+  // Called only when LLVM could not elide the frame; aborts when out of memory.
+  MARE_COMPILER_RT_API auto __mare_coro_alloc(int64_t bytes) -> void*;
+  MARE_COMPILER_RT_API void __mare_coro_free(void* frame);
+
+  // ------------------------------
+  // Threads (`spawn`, `join`, `pfor`)
+  // ------------------------------
+
+  // spawn runs entry(env) on a new thread and returns its handle; join waits
+  // for it, releases the handle and returns what entry returned.
+  MARE_COMPILER_RT_API auto __mare_spawn(int64_t (*entry)(void*), void* env) -> int64_t;
+  MARE_COMPILER_RT_API auto __mare_join(int64_t handle) -> int64_t;
+  MARE_COMPILER_RT_API auto __mare_cpu_count() -> int64_t;
+
+  // Runs chunk(ctx, a, b) over pieces [a, b) of [lo, hi) on a work-stealing pool
+  // of one thread per core, the caller included; returns when all are done.
+  MARE_COMPILER_RT_API void __mare_parallel_for(void (*chunk)(void*, int64_t, int64_t), void* ctx,
+                                                int64_t lo, int64_t hi);
+
 #ifdef __cplusplus
 }
 #endif